@@ -0,0 +1,460 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Benchmark/CombatBenchmarkCommandlet.h"
+
+#include "AIController.h"
+#include "EngineUtils.h"
+#include "Slash.h"
+#include "Character/SlashCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Debug/BenchmarkTimers.h"
+#include "Dom/JsonObject.h"
+#include "Enemy/CombatCoordinatorSubsystem.h"
+#include "Enemy/CombatRangeSubsystem.h"
+#include "Enemy/Enemy.h"
+#include "Engine/Engine.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/IConsoleManager.h"
+#include "Items/Weapon/Weapon.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Replay/CombatReplaySubsystem.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace CombatBenchmark
+{
+	/// Value at a fraction of a sorted array
+	double Percentile(const TArray<double>& Sorted, double Fraction)
+	{
+		return Sorted.Num() > 0 ? Sorted[FMath::Clamp(FMath::CeilToInt32(Fraction * Sorted.Num()) - 1, 0, Sorted.Num() - 1)] : 0;
+	}
+
+	/// Time per tick and calls per tick of a benchmark timer
+	TSharedRef<FJsonObject> MakeTimerReport(const FBenchmarkTimer& Timer, int32 NumTicks)
+	{
+		TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+		Report->SetNumberField(TEXT("ms_per_tick"), Timer.GetMilliseconds() / NumTicks);
+		Report->SetNumberField(TEXT("calls_per_tick"), static_cast<double>(Timer.Calls) / NumTicks);
+		return Report;
+	}
+
+	template <typename ClassType>
+	TSubclassOf<ClassType> LoadClassSetting(const FString& Params, const TCHAR* Switch, const TCHAR* DefaultPath)
+	{
+		FString Path = DefaultPath;
+		FParse::Value(*Params, Switch, Path);
+		TSubclassOf<ClassType> Class = LoadClass<ClassType>(nullptr, *Path);
+		if (!Class)
+		{
+			UE_LOG(LogSlash, Error, TEXT("Combat benchmark could not load class %s"), *Path);
+		}
+		return Class;
+	}
+}
+
+UCombatBenchmarkCommandlet::UCombatBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UCombatBenchmarkCommandlet::Main(const FString& Params)
+{
+	if (!ParseSettings(Params)) return 1;
+
+	// Movement and animation are timed on the game thread, as if every mesh were on screen
+	for (const TCHAR* Name : { TEXT("a.ParallelAnimEvaluation"), TEXT("a.ParallelAnimUpdate") })
+	{
+		if (IConsoleVariable* ConsoleVariable = IConsoleManager::Get().FindConsoleVariable(Name))
+		{
+			ConsoleVariable->Set(0, ECVF_SetByCommandline);
+		}
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Results;
+	for (const int32 NumEnemies : Settings.EnemyCounts)
+	{
+		const TSharedPtr<FJsonObject> Result = RunBenchmark(NumEnemies);
+		if (!Result) return 1;
+		Results.Add(MakeShared<FJsonValueObject>(Result));
+	}
+
+	const TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+	Report->SetStringField(TEXT("map"), Settings.MapName);
+	Report->SetStringField(TEXT("enemy_class"), Settings.EnemyClass->GetPathName());
+	Report->SetStringField(TEXT("bot_class"), Settings.BotClass->GetPathName());
+	Report->SetStringField(TEXT("weapon_class"), Settings.WeaponClass->GetPathName());
+	Report->SetStringField(TEXT("build_configuration"), LexToString(FApp::GetBuildConfiguration()));
+	Report->SetNumberField(TEXT("bots"), Settings.NumBots);
+	Report->SetNumberField(TEXT("ticks"), Settings.NumTicks);
+	Report->SetNumberField(TEXT("warmup_ticks"), Settings.NumWarmupTicks);
+	Report->SetNumberField(TEXT("delta_time"), Settings.DeltaTime);
+	Report->SetNumberField(TEXT("seed"), Settings.Seed);
+	Report->SetBoolField(TEXT("replay"), Settings.bRecordReplay);
+	Report->SetArrayField(TEXT("results"), Results);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	if (!FJsonSerializer::Serialize(Report, Writer) || !FFileHelper::SaveStringToFile(Json, *Settings.OutputPath))
+	{
+		UE_LOG(LogSlash, Error, TEXT("Combat benchmark could not write report to %s"), *Settings.OutputPath);
+		return 1;
+	}
+	UE_LOG(LogSlash, Display, TEXT("Combat benchmark report written to %s"), *Settings.OutputPath);
+	return bReplayOverBudget ? 1 : 0;
+}
+
+bool UCombatBenchmarkCommandlet::ParseSettings(const FString& Params)
+{
+	FParse::Value(*Params, TEXT("Map="), Settings.MapName);
+	if (FString Counts; FParse::Value(*Params, TEXT("Counts="), Counts, false))
+	{
+		TArray<FString> CountStrings;
+		Counts.ParseIntoArray(CountStrings, TEXT(","));
+		Settings.EnemyCounts.Reset();
+		for (const FString& Count : CountStrings)
+		{
+			Settings.EnemyCounts.Add(FMath::Max(FCString::Atoi(*Count), 0));
+		}
+	}
+	FParse::Value(*Params, TEXT("Bots="), Settings.NumBots);
+	FParse::Value(*Params, TEXT("Ticks="), Settings.NumTicks);
+	FParse::Value(*Params, TEXT("WarmupTicks="), Settings.NumWarmupTicks);
+	FParse::Value(*Params, TEXT("Seed="), Settings.Seed);
+	FParse::Value(*Params, TEXT("DeltaTime="), Settings.DeltaTime);
+	Settings.bRecordReplay = FParse::Param(*Params, TEXT("Replay"));
+	FParse::Value(*Params, TEXT("ReplayBudgetMs="), Settings.ReplayBudgetMs);
+	Settings.NumTicks = FMath::Max(Settings.NumTicks, 1);
+	Settings.DeltaTime = FMath::Max(Settings.DeltaTime, UE_KINDA_SMALL_NUMBER);
+
+	Settings.OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmark"), TEXT("CombatBenchmark.json"));
+	FParse::Value(*Params, TEXT("Output="), Settings.OutputPath);
+
+	Settings.EnemyClass = CombatBenchmark::LoadClassSetting<AEnemy>(Params, TEXT("EnemyClass="), TEXT("/Game/Blueprints/Enemy/Paladin/BP_Paladin.BP_Paladin_C"));
+	Settings.BotClass = CombatBenchmark::LoadClassSetting<ASlashCharacter>(Params, TEXT("BotClass="), TEXT("/Game/Blueprints/Character/BP_SlashCharacter.BP_SlashCharacter_C"));
+	Settings.WeaponClass = CombatBenchmark::LoadClassSetting<AWeapon>(Params, TEXT("WeaponClass="), TEXT("/Game/Blueprints/Items/Weapons/BP_Sword.BP_Sword_C"));
+	return Settings.EnemyClass && Settings.BotClass && Settings.WeaponClass;
+}
+
+UWorld* UCombatBenchmarkCommandlet::LoadWorld() const
+{
+	UPackage* Package = LoadPackage(nullptr, *Settings.MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (!World)
+	{
+		UE_LOG(LogSlash, Error, TEXT("Combat benchmark could not load map %s"), *Settings.MapName);
+		return nullptr;
+	}
+
+	World->AddToRoot();
+	// Set before initializing so game only world subsystems are created
+	World->WorldType = EWorldType::Game;
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues().AllowAudioPlayback(false));
+	}
+	World->UpdateWorldComponents(true, false);
+
+	const FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+	return World;
+}
+
+void UCombatBenchmarkCommandlet::DestroyWorld(UWorld* World) const
+{
+	World->BeginTearingDown();
+	for (FActorIterator It(World); It; ++It)
+	{
+		It->RouteEndPlay(EEndPlayReason::LevelTransition);
+	}
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+TSharedPtr<FJsonObject> UCombatBenchmarkCommandlet::RunBenchmark(int32 NumEnemies)
+{
+	// Same random decisions every run, as long as the number of enemies is the same
+	FMath::RandInit(Settings.Seed);
+	FMath::SRandInit(Settings.Seed);
+
+	UWorld* World = LoadWorld();
+	if (!World) return nullptr;
+
+	FRunActors Actors;
+	SpawnActors(World, NumEnemies, Actors);
+
+	for (int32 Tick = 0; Tick < Settings.NumWarmupTicks; ++Tick)
+	{
+		DriveBots(Actors, Tick);
+		TickWorld(World, Actors);
+	}
+
+	UCombatReplaySubsystem* Replay = Settings.bRecordReplay ? World->GetSubsystem<UCombatReplaySubsystem>() : nullptr;
+	if (Replay)
+	{
+		const FString ReplayPath = FPaths::Combine(FPaths::GetPath(Settings.OutputPath), FString::Printf(TEXT("CombatBenchmark_%d.slrp"), NumEnemies));
+		if (!Replay->StartRecording(ReplayPath))
+		{
+			DestroyWorld(World);
+			return nullptr;
+		}
+	}
+
+	TArray<double> FrameTimes;
+	FrameTimes.Reserve(Settings.NumTicks);
+	SlashBenchmark::ResetTimers();
+	SlashBenchmark::bTimersEnabled = true;
+	for (int32 Tick = 0; Tick < Settings.NumTicks; ++Tick)
+	{
+		DriveBots(Actors, Settings.NumWarmupTicks + Tick);
+		FrameTimes.Add(TickWorld(World, Actors));
+	}
+	SlashBenchmark::bTimersEnabled = false;
+	if (Replay)
+	{
+		Replay->StopRecording();
+	}
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+	int32 NumEnemiesAlive = 0;
+	for (const TWeakObjectPtr<AEnemy>& Enemy : Actors.Enemies)
+	{
+		NumEnemiesAlive += Enemy.IsValid() && !Enemy->GetCombatIdentity().IsDead() && !Enemy->IsHidden();
+	}
+
+	double TotalFrameTime = 0;
+	for (const double FrameTime : FrameTimes)
+	{
+		TotalFrameTime += FrameTime;
+	}
+	FrameTimes.Sort();
+	const TSharedRef<FJsonObject> FrameReport = MakeShared<FJsonObject>();
+	FrameReport->SetNumberField(TEXT("mean"), TotalFrameTime / FrameTimes.Num());
+	FrameReport->SetNumberField(TEXT("p50"), CombatBenchmark::Percentile(FrameTimes, 0.5));
+	FrameReport->SetNumberField(TEXT("p95"), CombatBenchmark::Percentile(FrameTimes, 0.95));
+	FrameReport->SetNumberField(TEXT("p99"), CombatBenchmark::Percentile(FrameTimes, 0.99));
+	FrameReport->SetNumberField(TEXT("max"), FrameTimes.Last());
+
+	const TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+	Result->SetNumberField(TEXT("enemies"), NumEnemies);
+	Result->SetNumberField(TEXT("enemies_alive_at_end"), NumEnemiesAlive);
+	Result->SetObjectField(TEXT("frame_ms"), FrameReport);
+	Result->SetObjectField(TEXT("enemy_tick"), CombatBenchmark::MakeTimerReport(SlashBenchmark::EnemyTick, Settings.NumTicks));
+	Result->SetObjectField(TEXT("enemy_ai_batch"), CombatBenchmark::MakeTimerReport(SlashBenchmark::EnemyAIBatch, Settings.NumTicks));
+	Result->SetObjectField(TEXT("weapon_swing"), CombatBenchmark::MakeTimerReport(SlashBenchmark::WeaponSwing, Settings.NumTicks));
+	Result->SetObjectField(TEXT("weapon_trace_wait"), CombatBenchmark::MakeTimerReport(SlashBenchmark::WeaponTraceWait, Settings.NumTicks));
+	Result->SetObjectField(TEXT("damage_resolve"), CombatBenchmark::MakeTimerReport(SlashBenchmark::DamageResolve, Settings.NumTicks));
+	Result->SetNumberField(TEXT("weapon_hits"), SlashBenchmark::NumWeaponHits);
+	Result->SetObjectField(TEXT("character_movement"), CombatBenchmark::MakeTimerReport(SlashBenchmark::CharacterMovement, Settings.NumTicks));
+	Result->SetObjectField(TEXT("animation"), CombatBenchmark::MakeTimerReport(SlashBenchmark::Animation, Settings.NumTicks));
+	if (Replay)
+	{
+		const int32 NumCharacters = Actors.Enemies.Num() + Actors.Bots.Num();
+		const double RecordMs = SlashBenchmark::ReplayRecord.GetMilliseconds() / Settings.NumTicks;
+		const double BudgetMs = Settings.ReplayBudgetMs * FMath::Max(NumCharacters / 200.0, 1.0);
+		const TSharedRef<FJsonObject> ReplayReport = CombatBenchmark::MakeTimerReport(SlashBenchmark::ReplayRecord, Settings.NumTicks);
+		ReplayReport->SetNumberField(TEXT("budget_ms_per_tick"), BudgetMs);
+		ReplayReport->SetBoolField(TEXT("within_budget"), RecordMs <= BudgetMs);
+		Result->SetObjectField(TEXT("replay_record"), ReplayReport);
+		if (RecordMs > BudgetMs)
+		{
+			UE_LOG(LogSlash, Error, TEXT("Combat benchmark %d enemies: recording the replay took %.3f ms per frame, over the %.3f ms budget"),
+				NumEnemies, RecordMs, BudgetMs);
+			bReplayOverBudget = true;
+		}
+	}
+	if (const UCombatCoordinatorSubsystem* CombatCoordinator = World->GetSubsystem<UCombatCoordinatorSubsystem>())
+	{
+		// Counted from the start of the run, including warmup
+		const TSharedRef<FJsonObject> TokenReport = MakeShared<FJsonObject>();
+		TokenReport->SetNumberField(TEXT("granted"), CombatCoordinator->GetNumGranted());
+		TokenReport->SetNumberField(TEXT("denied"), CombatCoordinator->GetNumDenied());
+		TokenReport->SetNumberField(TEXT("granted_after_waiting"), CombatCoordinator->GetNumGrantedWaiting());
+		TokenReport->SetNumberField(TEXT("peak_attackers"), CombatCoordinator->GetPeakAttackers());
+		Result->SetObjectField(TEXT("attack_tokens"), TokenReport);
+	}
+	if (const UCombatRangeSubsystem* CombatRange = World->GetSubsystem<UCombatRangeSubsystem>())
+	{
+		const TSharedRef<FJsonObject> RangeReport = MakeShared<FJsonObject>();
+		RangeReport->SetNumberField(TEXT("checks"), CombatRange->GetNumChecks());
+		RangeReport->SetNumberField(TEXT("events"), CombatRange->GetNumEvents());
+		Result->SetObjectField(TEXT("combat_range"), RangeReport);
+	}
+	// Peak over the whole process so far, so it only grows along a sweep
+	Result->SetNumberField(TEXT("peak_used_physical_mb"), MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0));
+	Result->SetNumberField(TEXT("used_physical_mb"), MemoryStats.UsedPhysical / (1024.0 * 1024.0));
+
+	UE_LOG(LogSlash, Display, TEXT("Combat benchmark %d enemies: frame mean %.2f ms, p95 %.2f ms, p99 %.2f ms, peak memory %.0f MB"),
+		NumEnemies, TotalFrameTime / FrameTimes.Num(), CombatBenchmark::Percentile(FrameTimes, 0.95),
+		CombatBenchmark::Percentile(FrameTimes, 0.99), MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0));
+
+	DestroyWorld(World);
+	return Result;
+}
+
+void UCombatBenchmarkCommandlet::SpawnActors(UWorld* World, int32 NumEnemies, FRunActors& OutActors) const
+{
+	FVector Origin = FVector::ZeroVector;
+	if (TActorIterator<APlayerStart> PlayerStart(World); PlayerStart)
+	{
+		Origin = PlayerStart->GetActorLocation();
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	// Enemies on a square grid centred on the origin
+	const int32 GridSize = FMath::CeilToInt32(FMath::Sqrt(static_cast<float>(NumEnemies)));
+	const double GridOffset = (GridSize - 1) * Settings.EnemySpacing / 2;
+	const float EnemyHalfHeight = Settings.EnemyClass.GetDefaultObject()->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	OutActors.Enemies.Reserve(NumEnemies);
+	for (int32 i = 0; i < NumEnemies; ++i)
+	{
+		const FVector GridLocation = Origin + FVector((i % GridSize) * Settings.EnemySpacing - GridOffset, (i / GridSize) * Settings.EnemySpacing - GridOffset, 0);
+		const FRotator Rotation(0, (i * 37) % 360, 0);
+		if (AEnemy* Enemy = World->SpawnActor<AEnemy>(Settings.EnemyClass, FindGroundLocation(World, GridLocation, EnemyHalfHeight), Rotation, SpawnParameters))
+		{
+			Enemy->GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+			OutActors.Enemies.Add(Enemy);
+		}
+	}
+
+	// Bots circle evenly spread around the middle of the grid
+	const float BotHalfHeight = Settings.BotClass.GetDefaultObject()->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const double SpreadRadius = GridOffset / 2;
+	for (int32 i = 0; i < Settings.NumBots; ++i)
+	{
+		const double Angle = UE_TWO_PI * i / Settings.NumBots;
+		const FVector Center = Origin + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0) * SpreadRadius;
+		const FVector Start = Center + FVector(Settings.BotCircleRadius, 0, 0);
+		ASlashCharacter* Bot = World->SpawnActor<ASlashCharacter>(Settings.BotClass, FindGroundLocation(World, Start, BotHalfHeight), FRotator::ZeroRotator, SpawnParameters);
+		if (!Bot) continue;
+
+		// AI controllers take movement input without a local player
+		Bot->AIControllerClass = AAIController::StaticClass();
+		Bot->SpawnDefaultController();
+		Bot->GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+#if WITH_EDITOR || !UE_BUILD_SHIPPING
+		if (AWeapon* Weapon = World->SpawnActor<AWeapon>(Settings.WeaponClass))
+		{
+			Bot->DebugEquip(Weapon);
+		}
+#endif
+		OutActors.Bots.Add(Bot);
+		OutActors.BotCenters.Add(Center);
+	}
+}
+
+FVector UCombatBenchmarkCommandlet::FindGroundLocation(UWorld* World, const FVector& Location, float HalfHeight) const
+{
+	constexpr double TraceHeight = 2000;
+	if (FHitResult Hit; World->LineTraceSingleByObjectType(Hit, Location + FVector(0, 0, TraceHeight), Location - FVector(0, 0, TraceHeight),
+		FCollisionObjectQueryParams(ECC_WorldStatic)))
+	{
+		return Hit.ImpactPoint + FVector(0, 0, HalfHeight + 2);
+	}
+	return Location + FVector(0, 0, HalfHeight);
+}
+
+void UCombatBenchmarkCommandlet::DriveBots(const FRunActors& Actors, int32 Tick) const
+{
+	for (int32 i = 0; i < Actors.Bots.Num(); ++i)
+	{
+		ASlashCharacter* Bot = Actors.Bots[i].Get();
+		if (!Bot || Bot->GetActionState() == EActionState::Dead) continue;
+
+		// Walk around the circle, steering back onto it when pushed off
+		const FVector& Center = Actors.BotCenters[i];
+		const FVector ToBot = (Bot->GetActorLocation() - Center).GetSafeNormal2D();
+		const FVector Tangent(-ToBot.Y, ToBot.X, 0);
+		const double RadiusError = (FVector::Dist2D(Bot->GetActorLocation(), Center) - Settings.BotCircleRadius) / Settings.BotCircleRadius;
+		Bot->AddMovementInput((Tangent - ToBot * RadiusError).GetSafeNormal2D());
+
+#if WITH_EDITOR || !UE_BUILD_SHIPPING
+		// Bots swing out of step with each other, at the same times whatever the delta time
+		const double Offset = i * Settings.BotAttackStagger;
+		if (FMath::FloorToInt32((Tick * Settings.DeltaTime + Offset) / Settings.BotAttackInterval)
+			!= FMath::FloorToInt32(((Tick - 1) * Settings.DeltaTime + Offset) / Settings.BotAttackInterval))
+		{
+			Bot->DebugAttack();
+		}
+#endif
+	}
+}
+
+double UCombatBenchmarkCommandlet::TickWorld(UWorld* World, const FRunActors& Actors) const
+{
+	// Components ticked below instead of by the world, so their time can be measured
+	TArray<UCharacterMovementComponent*> Movements;
+	TArray<USkeletalMeshComponent*> Meshes;
+	auto TakeOverTicks = [&Movements, &Meshes](ACharacter* Character)
+	{
+		if (!Character || Character->IsHidden()) return;
+		if (UCharacterMovementComponent* Movement = Character->GetCharacterMovement(); Movement->IsComponentTickEnabled())
+		{
+			Movement->SetComponentTickEnabled(false);
+			Movements.Add(Movement);
+		}
+		if (USkeletalMeshComponent* Mesh = Character->GetMesh(); Mesh->IsComponentTickEnabled())
+		{
+			Mesh->SetComponentTickEnabled(false);
+			Meshes.Add(Mesh);
+		}
+	};
+	for (const TWeakObjectPtr<AEnemy>& Enemy : Actors.Enemies)
+	{
+		TakeOverTicks(Enemy.Get());
+	}
+	for (const TWeakObjectPtr<ASlashCharacter>& Bot : Actors.Bots)
+	{
+		TakeOverTicks(Bot.Get());
+	}
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	// Also ticks the world's subsystems and other tickable objects
+	World->Tick(LEVELTICK_All, Settings.DeltaTime);
+	// Characters that died or were pooled during the world tick stop moving and animating on their own
+	for (UCharacterMovementComponent* Movement : Movements)
+	{
+		if (IsValid(Movement) && Movement->IsActive() && !Movement->GetOwner()->IsHidden())
+		{
+			SCOPE_BENCHMARK_TIMER(CharacterMovement);
+			Movement->TickComponent(Settings.DeltaTime, LEVELTICK_All, &Movement->PrimaryComponentTick);
+		}
+	}
+	for (USkeletalMeshComponent* Mesh : Meshes)
+	{
+		if (IsValid(Mesh) && !Mesh->GetOwner()->IsHidden())
+		{
+			SCOPE_BENCHMARK_TIMER(Animation);
+			Mesh->TickComponent(Settings.DeltaTime, LEVELTICK_All, &Mesh->PrimaryComponentTick);
+		}
+	}
+	const double FrameTime = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	for (UCharacterMovementComponent* Movement : Movements)
+	{
+		if (IsValid(Movement) && Movement->IsActive() && !Movement->GetOwner()->IsHidden())
+		{
+			Movement->SetComponentTickEnabled(true);
+		}
+	}
+	for (USkeletalMeshComponent* Mesh : Meshes)
+	{
+		if (IsValid(Mesh) && !Mesh->GetOwner()->IsHidden())
+		{
+			Mesh->SetComponentTickEnabled(true);
+		}
+	}
+	return FrameTime;
+}
@@ -6,6 +6,7 @@
 #include "Components/CapsuleComponent.h"
 #include "GeometryCollection/GeometryCollectionComponent.h"
 #include "Items/Treasure/Treasure.h"
+#include "Pooling/ActorPoolSubsystem.h"
 
 ABreakableActor::ABreakableActor()
 {
@@ -50,7 +51,7 @@ void ABreakableActor::HandleOnChaosBreakEvent(const FChaosBreakEvent& BreakEvent
 		FVector Location = GetActorLocation();
 		Location.Z += 75;
 		const int32 Selection = FMath::RandRange(0, TreasureClasses.Num() - 1);
-		World->SpawnActor<ATreasure>(TreasureClasses[Selection], Location, GetActorRotation());
+		UActorPoolSubsystem::AcquireActor<ATreasure>(World, TreasureClasses[Selection], FTransform(GetActorRotation(), Location));
 	}
 	CapsuleComponent->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
 	SetLifeSpan(3);
@@ -62,5 +63,13 @@ void ABreakableActor::BeginPlay()
 	Super::BeginPlay();
 
 	GeometryCollectionComponent->OnChaosBreakEvent.AddDynamic(this, &ABreakableActor::HandleOnChaosBreakEvent);
+
+	if (UActorPoolSubsystem* ActorPool = GetWorld()->GetSubsystem<UActorPoolSubsystem>())
+	{
+		for (const TSubclassOf<ATreasure>& TreasureClass : TreasureClasses)
+		{
+			ActorPool->Prewarm(TreasureClass, TreasurePrewarmCount);
+		}
+	}
 }
 
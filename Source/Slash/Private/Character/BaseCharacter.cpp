@@ -8,10 +8,13 @@
 #include "Components/AttributeComponent.h"
 #include "Components/BoxComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "Debug/CombatTelemetry.h"
+#include "FX/EffectPlayerSubsystem.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Items/Weapon/Weapon.h"
-#include "Kismet/GameplayStatics.h"
 #include "Particles/ParticleSystem.h"
+#include "Replay/CombatReplaySubsystem.h"
+#include "Spatial/SpatialHashSubsystem.h"
 
 ABaseCharacter::ABaseCharacter()
 {
@@ -37,7 +40,40 @@ ABaseCharacter::ABaseCharacter()
 void ABaseCharacter::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	CacheMontageSections();
+	RegisterInSpatialHash();
+	ReplaySubsystem = GetWorld()->GetSubsystem<UCombatReplaySubsystem>();
+	if (ReplaySubsystem)
+	{
+		ReplaySubsystem->RegisterCharacter(this);
+	}
+}
+
+void ABaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterFromSpatialHash();
+	if (ReplaySubsystem)
+	{
+		ReplaySubsystem->UnregisterCharacter(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void ABaseCharacter::RegisterInSpatialHash()
+{
+	if (USpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<USpatialHashSubsystem>())
+	{
+		SpatialHash->RegisterActor(this, ESpatialHashCategory::Character);
+	}
+}
+
+void ABaseCharacter::UnregisterFromSpatialHash()
+{
+	if (USpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<USpatialHashSubsystem>())
+	{
+		SpatialHash->UnregisterActor(this);
+	}
 }
 
 bool ABaseCharacter::IsAlive()
@@ -45,6 +81,16 @@ bool ABaseCharacter::IsAlive()
 	return Attributes && Attributes->IsAlive();
 }
 
+UAttributeComponent* ABaseCharacter::GetAttributes() const
+{
+	return Attributes;
+}
+
+bool ABaseCharacter::IsOutOfHealth() const
+{
+	return Attributes && Attributes->GetHealth() <= 0;
+}
+
 bool ABaseCharacter::CanAttack()
 {
 	return false;
@@ -52,29 +98,46 @@ bool ABaseCharacter::CanAttack()
 
 void ABaseCharacter::Attack()
 {
-	if (CombatTarget && CombatTarget->ActorHasTag(DeadTag))
+	if (CombatTarget && IdentityOf(CombatTarget).IsDead())
 	{
 		CombatTarget = nullptr;
 	}
 }
 
-int32 ABaseCharacter::PlayRandomMontageSection(TObjectPtr<UAnimMontage> Montage)
+void ABaseCharacter::CacheMontageSections()
 {
-	// TODO: Refactor this to caller to optimize
-	if (TObjectPtr<UAnimInstance> AnimInstance = GetMesh()->GetAnimInstance(); AnimInstance && Montage)
+	AttackSections.Cache(AttackMontage);
+	HitReactSections.Cache(HitReactMontage);
+	DeathSections.Cache(DeathMontage);
+	DodgeSections.Cache(DodgeMontage);
+}
+
+int32 ABaseCharacter::PlayRandomMontageSection(const FMontageSections& Sections)
+{
+	if (Sections.Num() == 0) return -1;
+
+	// Pick animation instance at random
+	const int32 Selection = FMath::RandRange(0, Sections.Num() - 1);
+	return PlayMontageSection(Sections, Selection) ? Selection : -1;
+}
+
+bool ABaseCharacter::PlayMontageSection(const FMontageSections& Sections, int32 SectionIndex)
+{
+	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+	if (!AnimInstance || !Sections.IsValidIndex(SectionIndex)) return false;
+
+	// Starting at the section plays it without looking it up by name
+	AnimInstance->Montage_Play(Sections.Montage, 1, EMontagePlayReturnType::MontageLength, Sections.StartTimes[SectionIndex]);
+	if (ReplaySubsystem)
 	{
-		// Pick animation instance at random
-		const int32 Selection = FMath::RandRange(0, Montage->GetNumSections() - 1);
-		AnimInstance->Montage_Play(Montage);
-		AnimInstance->Montage_JumpToSection(Montage->GetSectionName(Selection), Montage);
-		return Selection;
+		ReplaySubsystem->RecordMontage(this, Sections.Montage, Sections.Names[SectionIndex]);
 	}
-	return -1;
+	return true;
 }
 
 void ABaseCharacter::PlayAttackMontage()
 {
-	PlayRandomMontageSection(AttackMontage);
+	PlayRandomMontageSection(AttackSections);
 }
 
 void ABaseCharacter::StopAttackMontage()
@@ -87,7 +150,7 @@ void ABaseCharacter::StopAttackMontage()
 
 void ABaseCharacter::PlayDeathMontage()
 {
-	const int32 Selection = PlayRandomMontageSection(DeathMontage);
+	const int32 Selection = PlayRandomMontageSection(DeathSections);
 	if (Selection < static_cast<int32>(EDeathPose::MAX))
 	{
 		DeathPose = static_cast<EDeathPose>(Selection);
@@ -96,7 +159,7 @@ void ABaseCharacter::PlayDeathMontage()
 
 void ABaseCharacter::PlayDodgeMontage()
 {
-	PlayRandomMontageSection(DodgeMontage);
+	PlayRandomMontageSection(DodgeSections);
 }
 
 void ABaseCharacter::AttackEnd()
@@ -113,11 +176,25 @@ void ABaseCharacter::HandleDamage(float DamageAmount)
 	{
 		Attributes->ReceiveDamage(DamageAmount);
 	}
+#if SLASH_TELEMETRY
+	if (FirstDamagedTime < 0 && DamageAmount > 0)
+	{
+		FirstDamagedTime = GetWorld()->GetTimeSeconds();
+	}
+#endif
 }
 
 void ABaseCharacter::Die()
 {
 	Tags.Add(DeadTag);
+	CombatIdentity.SetFlags(ECombatFlags::Dead, true);
+	SLASH_TELEMETRY_COUNT(Deaths, 1);
+#if SLASH_TELEMETRY
+	if (FirstDamagedTime >= 0)
+	{
+		SLASH_TELEMETRY_SAMPLE(TimeToKill, SlashTelemetry::GetClassKey(GetClass()), GetWorld()->GetTimeSeconds() - FirstDamagedTime);
+	}
+#endif
 	PlayDeathMontage();
 	SetWeaponCollision(ECollisionEnabled::NoCollision);
 	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
@@ -125,55 +202,50 @@ void ABaseCharacter::Die()
 	GetCharacterMovement()->Deactivate();
 }
 
-void ABaseCharacter::PlayHitReactMontage(const FName& SectionName)
+void ABaseCharacter::ResetCharacter()
 {
-	if (TObjectPtr<UAnimInstance> AnimInstance = GetMesh()->GetAnimInstance(); AnimInstance && HitReactMontage)
+	Tags.Remove(DeadTag);
+	CombatIdentity.SetFlags(ECombatFlags::Dead, false);
+#if SLASH_TELEMETRY
+	FirstDamagedTime = -1;
+#endif
+	CombatTarget = nullptr;
+	if (Attributes)
+	{
+		Attributes->ResetAttributes();
+	}
+	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
-		AnimInstance->Montage_Play(HitReactMontage);
-		AnimInstance->Montage_JumpToSection(SectionName, HitReactMontage);
+		AnimInstance->StopAllMontages(0);
 	}
+	// Collision as configured on the class defaults, before Die turned it off
+	const ABaseCharacter* Defaults = GetClass()->GetDefaultObject<ABaseCharacter>();
+	GetCapsuleComponent()->SetCollisionEnabled(Defaults->GetCapsuleComponent()->GetCollisionEnabled());
+	GetMesh()->SetCollisionEnabled(Defaults->GetMesh()->GetCollisionEnabled());
+	GetCharacterMovement()->Activate();
+	SetWeaponCollision(ECollisionEnabled::NoCollision);
+}
+
+void ABaseCharacter::PlayHitReactMontage(EHitDirection Direction)
+{
+	// Montages without a section for the direction play from their first section, as jumping to a missing one did
+	const int32 Section = HitReactSections.GetDirectionSection(Direction);
+	PlayMontageSection(HitReactSections, Section != INDEX_NONE ? Section : 0);
 }
 
 void ABaseCharacter::DirectionalHitReact(const FVector& ImpactPoint)
 {
-	const FVector Forward = GetActorForwardVector();
 	// Level impact with actor's Z location so debug information is visually accurate
 	const FVector ImpactLeveled = FVector(ImpactPoint.X, ImpactPoint.Y, GetActorLocation().Z);
 	const FVector ToImpact = (ImpactLeveled - GetActorLocation()).GetSafeNormal();
-	// Get angle in degrees
-	double Angle = FMath::RadiansToDegrees(FMath::Acos(FVector::DotProduct(Forward, ToImpact)));
-
-	// LHR: if negative, to left, if positive, to right of actor's forward
-	const FVector CrossProduct = FVector::CrossProduct(Forward, ToImpact);
-
-	if (CrossProduct.Z < 0)
-	{
-		Angle *= -1;
-	}
-
-	FName SectionName;
-	if (Angle < 45 && Angle >= -45)
-	{
-		SectionName = FName("FromFront");
-	} else if (Angle >= -135 && Angle < -45)
-	{
-		SectionName = FName("FromLeft");
-	} else if (Angle >= 45 && Angle < 135)
-	{
-		SectionName = FName("FromRight");
-	} else
-	{
-		SectionName = FName("FromBack");
-	}
-
-	PlayHitReactMontage(SectionName);
+	PlayHitReactMontage(MontageSections::GetHitDirection(GetActorForwardVector(), ToImpact));
 }
 
 void ABaseCharacter::PlayHitSound(const FVector& ImpactPoint)
 {
 	if (HitSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, HitSound, ImpactPoint);
+		UEffectPlayerSubsystem::PlaySoundAtLocation(this, HitSound, ImpactPoint);
 	}
 }
 
@@ -181,7 +253,7 @@ void ABaseCharacter::SpawnHitParticles(const FVector& ImpactPoint)
 {
 	if (HitParticles)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(this, HitParticles, ImpactPoint);
+		UEffectPlayerSubsystem::PlaySystemAtLocation(this, HitParticles, ImpactPoint);
 	}
 }
 
@@ -192,7 +264,7 @@ FVector ABaseCharacter::GetTranslationWarpTarget()
 	const FVector CombatTargetLocation = CombatTarget->GetActorLocation();
 	const FVector MyLocation = GetActorLocation();
 	const FVector TargetToMe = MyLocation - CombatTargetLocation;
-	if (TargetToMe.Length() < WarpTargetDistance)
+	if (TargetToMe.SizeSquared() < FMath::Square(WarpTargetDistance))
 	{
 		return MyLocation;
 	} else
@@ -240,22 +312,17 @@ void ABaseCharacter::GetHit_Implementation(const FVector& ImpactPoint, AActor* H
 
 void ABaseCharacter::SetWeaponCollision(ECollisionEnabled::Type CollisionType)
 {
-	if (EquippedWeapon && EquippedWeapon->GetCollisionBox())
+	if (EquippedWeapon)
 	{
-		EquippedWeapon->GetCollisionBox()->SetCollisionEnabled(CollisionType);
+		// The hit window notifies open and close a swing, which traces the blade in between
 		if (CollisionType == ECollisionEnabled::NoCollision)
 		{
-			// If not in the middle of an attack and when collision notified to be enabled,
-			// just disable overlap events to prevent double hitting enemies outside the
-			// hit collision window. This is precautionary and can instead be avoided by
-			// configuring the hit window and box on the weapon to be more accurate
-			EquippedWeapon->GetCollisionBox()->SetGenerateOverlapEvents(false);
-		} else
+			EquippedWeapon->EndSwing();
+		}
+		else
 		{
-			EquippedWeapon->GetCollisionBox()->SetGenerateOverlapEvents(true);
+			EquippedWeapon->BeginSwing();
 		}
-		// Clear collision ignore actors for attack at the beginning and end of each attack
-		EquippedWeapon->CollisionIgnoreActors.Empty();
 	}
 }
 
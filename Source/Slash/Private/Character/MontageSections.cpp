@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/MontageSections.h"
+
+#include "Slash.h"
+#include "Animation/AnimMontage.h"
+#include "HAL/IConsoleManager.h"
+
+namespace MontageSections
+{
+	const FName DirectionSectionNames[static_cast<int32>(EHitDirection::MAX)] = {
+		FName("FromFront"),
+		FName("FromLeft"),
+		FName("FromRight"),
+		FName("FromBack"),
+	};
+}
+
+void FMontageSections::Cache(UAnimMontage* InMontage)
+{
+	Montage = InMontage;
+	Names.Reset();
+	StartTimes.Reset();
+	if (Montage)
+	{
+		const int32 NumSections = Montage->GetNumSections();
+		Names.Reserve(NumSections);
+		StartTimes.Reserve(NumSections);
+		for (int32 Section = 0; Section < NumSections; ++Section)
+		{
+			float StartTime, EndTime;
+			Montage->GetSectionStartAndEndTime(Section, StartTime, EndTime);
+			Names.Add(Montage->GetSectionName(Section));
+			StartTimes.Add(StartTime);
+		}
+	}
+	for (int32 Direction = 0; Direction < static_cast<int32>(EHitDirection::MAX); ++Direction)
+	{
+		DirectionSections[Direction] = Find(MontageSections::DirectionSectionNames[Direction]);
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+namespace MontageSections
+{
+	/// Hit direction measured as an angle in degrees, as hit reactions were picked before GetHitDirection
+	static EHitDirection GetHitDirectionFromAngle(const FVector& Forward, const FVector& ToImpact)
+	{
+		double Angle = FMath::RadiansToDegrees(FMath::Acos(FVector::DotProduct(Forward, ToImpact)));
+		if (FVector::CrossProduct(Forward, ToImpact).Z < 0)
+		{
+			Angle *= -1;
+		}
+
+		if (Angle < 45 && Angle >= -45) return EHitDirection::Front;
+		if (Angle >= -135 && Angle < -45) return EHitDirection::Left;
+		if (Angle >= 45 && Angle < 135) return EHitDirection::Right;
+		return EHitDirection::Back;
+	}
+}
+
+static FAutoConsoleCommandWithArgs MontageVerifyHitDirectionsCommand(
+	TEXT("Slash.Montage.VerifyHitDirections"),
+	TEXT("Check hit directions picked without trig match those measured in degrees, and time both: Slash.Montage.VerifyHitDirections [Samples]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumSamples = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000, 8);
+
+		// Impacts all around a character, facing a random way each, skipping the exact 45 degree boundaries
+		FRandomStream Random(NumSamples);
+		TArray<FVector> Forwards, ToImpacts;
+		Forwards.Reserve(NumSamples);
+		ToImpacts.Reserve(NumSamples);
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			const double Facing = Random.FRandRange(0, UE_TWO_PI);
+			const double Angle = Facing + (Sample + 0.5) * UE_TWO_PI / NumSamples;
+			Forwards.Emplace(FMath::Cos(Facing), FMath::Sin(Facing), 0);
+			ToImpacts.Emplace(FMath::Cos(Angle), FMath::Sin(Angle), 0);
+		}
+
+		int32 NumMismatches = 0;
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			const EHitDirection Expected = MontageSections::GetHitDirectionFromAngle(Forwards[Sample], ToImpacts[Sample]);
+			const EHitDirection Picked = MontageSections::GetHitDirection(Forwards[Sample], ToImpacts[Sample]);
+			if (Picked != Expected && ++NumMismatches <= 10)
+			{
+				UE_LOG(LogSlash, Warning, TEXT("Hit direction of %s facing %s is %d, measured in degrees %d"),
+					*ToImpacts[Sample].ToString(), *Forwards[Sample].ToString(), static_cast<int32>(Picked), static_cast<int32>(Expected));
+			}
+		}
+
+		// Summed so neither loop is optimized away
+		int32 Checksum = 0;
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			Checksum += static_cast<int32>(MontageSections::GetHitDirectionFromAngle(Forwards[Sample], ToImpacts[Sample]));
+		}
+		const double AngleMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			Checksum -= static_cast<int32>(MontageSections::GetHitDirection(Forwards[Sample], ToImpacts[Sample]));
+		}
+		const double PickedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		UE_LOG(LogSlash, Display, TEXT("Hit directions: %d of %d samples mismatched, %.2f ns per hit without trig, %.2f ns in degrees (checksum %d)"),
+			NumMismatches, NumSamples, PickedMs * 1e6 / NumSamples, AngleMs * 1e6 / NumSamples, Checksum);
+	}));
+#endif
@@ -10,6 +10,8 @@
 #include "Asset/AssetMacros.h"
 #include "Camera/CameraComponent.h"
 #include "Components/AttributeComponent.h"
+#include "Debug/CombatTelemetry.h"
+#include "Enemy/EnemyPerceptionSubsystem.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "HUD/SlashHUD.h"
@@ -22,6 +24,9 @@ ASlashCharacter::ASlashCharacter()
 {
 	PrimaryActorTick.bCanEverTick = true;
 
+	CombatIdentity.Faction = ECombatFaction::Player;
+	CombatIdentity.SetFlags(ECombatFlags::Engageable, true);
+
 	// Disable controller rotation on character to prevent sliding behavior, only used for camera
 	bUseControllerRotationPitch = false;
 	bUseControllerRotationYaw = false;
@@ -88,11 +93,8 @@ void ASlashCharacter::Tick(float DeltaTime)
 	Super::Tick(DeltaTime);
 	if (Attributes)
 	{
-		Attributes -> RegenStamina(DeltaTime);
-		if (SlashOverlay)
-		{
-			SlashOverlay->SetStaminaPercent(Attributes->GetStaminaPercent());
-		}
+		// The overlay follows stamina through the attributes' change broadcasts
+		Attributes->RegenStamina(DeltaTime);
 	}
 }
 
@@ -103,6 +105,12 @@ void ASlashCharacter::BeginPlay()
 	Tags.Add(SlashCharacterTag);
 	Tags.Add(EngageableActorTagName);
 
+	// Let enemies see us
+	if (UEnemyPerceptionSubsystem* PerceptionSubsystem = GetWorld()->GetSubsystem<UEnemyPerceptionSubsystem>())
+	{
+		PerceptionSubsystem->RegisterStimulus(this);
+	}
+
 	if (APlayerController* PlayerController = Cast<APlayerController>(GetController()))
 	{
 		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
@@ -114,10 +122,7 @@ void ASlashCharacter::BeginPlay()
 		{
 			if (SlashOverlay = SlashHUD->GetSlashOverlay(); SlashOverlay)
 			{
-				SetHUDHealth();
-				SlashOverlay->SetStaminaPercent(1);
-				SlashOverlay->SetGold(0);
-				SlashOverlay->SetSouls(0);
+				SlashOverlay->BindAttributes(Attributes);
 			}
 		}
 	}
@@ -169,6 +174,7 @@ void ASlashCharacter::Dodge()
 		Attributes->UseStamina(Attributes->GetDodgeCost());
 	}
 	ActionState = EActionState::Dodge;
+	SLASH_TELEMETRY_COUNT(Dodges, 1);
 }
 
 void ASlashCharacter::EKeypressed()
@@ -176,10 +182,8 @@ void ASlashCharacter::EKeypressed()
 	// Attach weapon to SlashCharacter's right hand socket
 	if (TObjectPtr<AWeapon> Weapon = Cast<AWeapon>(OverlappingItem))
 	{
-		Weapon->Equip(GetMesh(), PrimaryWeaponSocketName, this, this);
-		CharacterState = ECharacterState::EquippedOneHandedWeapon;
+		EquipWeapon(Weapon);
 		OverlappingItem = nullptr;
-		EquippedWeapon = Weapon;
 	} else
 	{
 		// Play animation montage and change state for un/equipping weapons
@@ -197,6 +201,13 @@ void ASlashCharacter::EKeypressed()
 	}
 }
 
+void ASlashCharacter::EquipWeapon(AWeapon* Weapon)
+{
+	Weapon->Equip(GetMesh(), PrimaryWeaponSocketName, this, this);
+	CharacterState = ECharacterState::EquippedOneHandedWeapon;
+	EquippedWeapon = Weapon;
+}
+
 bool ASlashCharacter::CanAttack()
 {
 	return ActionState == EActionState::Unoccupied && CharacterState != ECharacterState::Unequipped;
@@ -212,13 +223,15 @@ void ASlashCharacter::Attack()
 	}
 }
 
+void ASlashCharacter::CacheMontageSections()
+{
+	Super::CacheMontageSections();
+	EquipSections.Cache(EquipMontage);
+}
+
 void ASlashCharacter::PlayEquipMontage(const FName& SectionName)
 {
-	if (TObjectPtr<UAnimInstance> AnimInstance = GetMesh()->GetAnimInstance(); AnimInstance && EquipMontage)
-	{
-		AnimInstance->Montage_Play(EquipMontage);
-		AnimInstance->Montage_JumpToSection(SectionName, EquipMontage);
-	}
+	PlayMontageSection(EquipSections, EquipSections.Find(SectionName));
 }
 
 void ASlashCharacter::AttackEnd()
@@ -280,18 +293,9 @@ void ASlashCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComp
 	}
 }
 
-void ASlashCharacter::SetHUDHealth()
-{
-	if (SlashOverlay && Attributes)
-	{
-		SlashOverlay->SetHealthPercent(Attributes->GetHealthPercent());
-	}
-}
-
 float ASlashCharacter::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
 	HandleDamage(DamageAmount);
-	SetHUDHealth();
 	return DamageAmount;
 }
 
@@ -319,10 +323,7 @@ void ASlashCharacter::AddSouls(ASoul* Soul)
 	if (Attributes)
 	{
 		Attributes->AddSouls(Soul->GetSouls());
-		if (SlashOverlay)
-		{
-			SlashOverlay->SetSouls(Attributes->GetSouls());
-		}
+		SLASH_TELEMETRY_COUNT(SoulsEarned, Soul->GetSouls());
 	}
 }
 
@@ -331,10 +332,7 @@ void ASlashCharacter::AddGold(ATreasure* Treasure)
 	if (Attributes)
 	{
 		Attributes->AddGold(Treasure->GetGold());
-		if (SlashOverlay)
-		{
-			SlashOverlay->SetGold(Attributes->GetGold());
-		}
+		SLASH_TELEMETRY_COUNT(GoldEarned, Treasure->GetGold());
 	}
 }
 
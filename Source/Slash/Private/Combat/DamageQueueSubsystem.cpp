@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Combat/DamageQueueSubsystem.h"
+
+#include "Slash.h"
+#include "Character/BaseCharacter.h"
+#include "Components/AttributeComponent.h"
+#include "Debug/BenchmarkTimers.h"
+#include "Debug/SlashStats.h"
+#include "Interfaces/HitInterface.h"
+#include "Items/Weapon/Weapon.h"
+#include "Items/Weapon/WeaponTraceSubsystem.h"
+#include "Kismet/GameplayStatics.h"
+#include "Replay/CombatReplaySubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Damage Resolve"), STAT_Damage_Resolve, STATGROUP_SlashDamage);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits This Frame"), STAT_Damage_NumHits, STATGROUP_SlashDamage);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reactions This Frame"), STAT_Damage_NumReactions, STATGROUP_SlashDamage);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Deaths"), STAT_Damage_NumDeaths, STATGROUP_SlashDamage);
+
+static TAutoConsoleVariable<bool> CVarDamageQueue(
+	TEXT("Slash.Damage.Queue"),
+	true,
+	TEXT("Resolve weapon hits together at the end of the frame.  Off resolves each hit as soon as it is found."));
+
+static TAutoConsoleVariable<bool> CVarDamageLogEvents(
+	TEXT("Slash.Damage.LogEvents"),
+	false,
+	TEXT("Log every weapon hit resolved, in the order resolved."));
+
+void UDamageQueueSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	// Fired once every actor and tickable subsystem has ticked, after weapons' sweeps in TG_PostUpdateWork
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UDamageQueueSubsystem::OnWorldPostActorTick);
+}
+
+void UDamageQueueSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	Queued.Empty();
+	Super::Deinitialize();
+}
+
+void UDamageQueueSubsystem::QueueHit(UWorld* World, AActor* Target, AWeapon* Weapon, float Damage, const FVector& ImpactPoint)
+{
+	AActor* Hitter = Weapon->GetOwner();
+	FQueuedHit Hit{ Target, Hitter, Weapon, Weapon->GetInstigatorController(), Target->GetUniqueID(), Hitter ? Hitter->GetUniqueID() : 0,
+		Target->GetFName(), Hitter ? Hitter->GetFName() : NAME_None, ImpactPoint, Damage };
+
+	UDamageQueueSubsystem* DamageQueue = World ? World->GetSubsystem<UDamageQueueSubsystem>() : nullptr;
+	if (!DamageQueue || !CVarDamageQueue.GetValueOnGameThread())
+	{
+		TArray<FQueuedHit> Hits;
+		Hits.Add(MoveTemp(Hit));
+		ResolveHits(World, Hits);
+		return;
+	}
+
+	DamageQueue->Queued.Add(MoveTemp(Hit));
+}
+
+void UDamageQueueSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld()) return;
+
+	// Hits of sweeps traced on the game thread this frame are resolved with the rest
+	if (UWeaponTraceSubsystem* WeaponTraces = World->GetSubsystem<UWeaponTraceSubsystem>())
+	{
+		WeaponTraces->FlushQueuedSweeps();
+	}
+
+	NumResolved = Queued.Num();
+	SET_DWORD_STAT(STAT_Damage_NumHits, NumResolved);
+	if (Queued.Num() == 0) return;
+
+	// Resolving can queue more hits, e.g. from Blueprint reactions, which wait for the next frame
+	TArray<FQueuedHit> Hits = MoveTemp(Queued);
+	Queued.Reset();
+	ResolveHits(World, Hits);
+}
+
+void UDamageQueueSubsystem::ResolveHits(UWorld* World, TArray<FQueuedHit>& Hits)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Damage_Resolve);
+	SCOPE_BENCHMARK_TIMER(DamageResolve);
+	const bool bLogEvents = CVarDamageLogEvents.GetValueOnGameThread();
+
+	// Stable, so hits of one hitter on one target keep the order they were queued in
+	Hits.StableSort([](const FQueuedHit& A, const FQueuedHit& B)
+	{
+		if (A.TargetId != B.TargetId) return A.TargetId < B.TargetId;
+		return A.HitterId < B.HitterId;
+	});
+
+	UCombatReplaySubsystem* Replay = World ? World->GetSubsystem<UCombatReplaySubsystem>() : nullptr;
+
+	// Health changes.  The first hit on each target is the one reacted to
+	TArray<int32, TInlineAllocator<16>> FirstHits;
+	for (int32 i = 0; i < Hits.Num(); ++i)
+	{
+		FQueuedHit& Hit = Hits[i];
+		AActor* Target = Hit.Target.Get();
+		if (!Target || ABaseCharacter::IdentityOf(Target).IsDead())
+		{
+			Hit.Target = nullptr;
+			continue;
+		}
+
+		UGameplayStatics::ApplyDamage(Target, Hit.Damage, Hit.Instigator.Get(), Hit.Weapon.Get(), UDamageType::StaticClass());
+		if (Replay)
+		{
+			Replay->RecordHit(Hit.Hitter.Get(), Target, Hit.Damage, Hit.ImpactPoint);
+		}
+		if (FirstHits.Num() == 0 || Hits[FirstHits.Last()].Target != Hit.Target)
+		{
+			FirstHits.Add(i);
+		}
+		if (bLogEvents)
+		{
+			const ABaseCharacter* Character = Cast<ABaseCharacter>(Target);
+			const UAttributeComponent* Attributes = Character ? Character->FindComponentByClass<UAttributeComponent>() : nullptr;
+			UE_LOG(LogSlash, Display, TEXT("Damage: frame %llu, %s hit %s for %.1f, health %.1f"), GFrameCounter,
+				*Hit.HitterName.ToString(), *Hit.TargetName.ToString(), Hit.Damage, Attributes ? Attributes->GetHealth() : 0.f);
+		}
+	}
+
+	// Hit reactions of targets still standing, then deaths of the rest
+	TArray<int32, TInlineAllocator<16>> Deaths;
+	int32 NumReactions = 0;
+	for (const int32 HitIndex : FirstHits)
+	{
+		const FQueuedHit& Hit = Hits[HitIndex];
+		AActor* Target = Hit.Target.Get();
+		if (!Target || !Target->Implements<UHitInterface>()) continue;
+
+		const ABaseCharacter* Character = Cast<ABaseCharacter>(Target);
+		if (Character && Character->IsOutOfHealth())
+		{
+			Deaths.Add(HitIndex);
+			continue;
+		}
+		IHitInterface::Execute_GetHit(Target, Hit.ImpactPoint, Hit.Hitter.Get());
+		++NumReactions;
+	}
+	for (const int32 HitIndex : Deaths)
+	{
+		const FQueuedHit& Hit = Hits[HitIndex];
+		if (AActor* Target = Hit.Target.Get())
+		{
+			// Getting hit out of health dies, which drops the target's souls
+			IHitInterface::Execute_GetHit(Target, Hit.ImpactPoint, Hit.Hitter.Get());
+			if (bLogEvents)
+			{
+				UE_LOG(LogSlash, Display, TEXT("Damage: frame %llu, %s died"), GFrameCounter, *Hit.TargetName.ToString());
+			}
+		}
+	}
+	INC_DWORD_STAT_BY(STAT_Damage_NumReactions, NumReactions);
+	INC_DWORD_STAT_BY(STAT_Damage_NumDeaths, Deaths.Num());
+
+	// Field requests at every impact, terrain included
+	for (const FQueuedHit& Hit : Hits)
+	{
+		AWeapon* Weapon = Hit.Weapon.Get();
+		if (Weapon && Hit.Target.IsValid())
+		{
+			Weapon->CreateFields(Hit.ImpactPoint);
+		}
+	}
+}
+
+bool UDamageQueueSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -3,9 +3,20 @@
 
 #include "Components/AttributeComponent.h"
 
+namespace AttributeChange
+{
+	constexpr uint8 Health = 1 << 0;
+	constexpr uint8 Stamina = 1 << 1;
+	constexpr uint8 Gold = 1 << 2;
+	constexpr uint8 Souls = 1 << 3;
+}
+
 UAttributeComponent::UAttributeComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
+	// Only ticks to broadcast changes, after the frame's gameplay
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
 }
 
 
@@ -17,30 +28,46 @@ void UAttributeComponent::BeginPlay()
 
 void UAttributeComponent::RegenStamina(float DeltaTime)
 {
+	if (Stamina >= MaxStamina) return;
+
+	const float OldStamina = Stamina;
 	Stamina = FMath::Clamp(Stamina + StaminaRegenRate * DeltaTime, 0, MaxStamina);
+	NoteChange(AttributeChange::Stamina, StaminaBeforeFrame, OldStamina, Stamina);
 }
 
 void UAttributeComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	BroadcastChanges();
 }
 
 void UAttributeComponent::ReceiveDamage(float Damage)
 {
+	const float OldHealth = Health;
 	Health = FMath::Clamp(Health - Damage, 0, MaxHealth);
+	NoteChange(AttributeChange::Health, HealthBeforeFrame, OldHealth, Health);
 }
 
-float UAttributeComponent::GetHealthPercent()
+float UAttributeComponent::GetHealthPercent() const
 {
 	return Health / MaxHealth;
 }
 
+void UAttributeComponent::SetHealth(float NewHealth)
+{
+	const float OldHealth = Health;
+	Health = FMath::Clamp(NewHealth, 0, MaxHealth);
+	NoteChange(AttributeChange::Health, HealthBeforeFrame, OldHealth, Health);
+}
+
 void UAttributeComponent::UseStamina(float Amount)
 {
+	const float OldStamina = Stamina;
 	Stamina = FMath::Clamp(Stamina - Amount, 0, MaxStamina);
+	NoteChange(AttributeChange::Stamina, StaminaBeforeFrame, OldStamina, Stamina);
 }
 
-float UAttributeComponent::GetStaminaPercent()
+float UAttributeComponent::GetStaminaPercent() const
 {
 	return Stamina / MaxStamina;
 }
@@ -50,13 +77,68 @@ bool UAttributeComponent::IsAlive()
 	return Health > 0;
 }
 
+void UAttributeComponent::ResetAttributes()
+{
+	NoteChange(AttributeChange::Health, HealthBeforeFrame, Health, MaxHealth);
+	NoteChange(AttributeChange::Stamina, StaminaBeforeFrame, Stamina, MaxStamina);
+	NoteChange(AttributeChange::Gold, GoldBeforeFrame, Gold, 0);
+	NoteChange(AttributeChange::Souls, SoulsBeforeFrame, Souls, 0);
+	Health = MaxHealth;
+	Stamina = MaxStamina;
+	Gold = 0;
+	Souls = 0;
+}
+
 void UAttributeComponent::AddGold(int32 Amount)
 {
+	NoteChange(AttributeChange::Gold, GoldBeforeFrame, Gold, Gold + Amount);
 	Gold += Amount;
 }
 
 void UAttributeComponent::AddSouls(int32 Amount)
 {
+	NoteChange(AttributeChange::Souls, SoulsBeforeFrame, Souls, Souls + Amount);
 	Souls += Amount;
 }
 
+template <typename T>
+void UAttributeComponent::NoteChange(uint8 Attribute, T& ValueBeforeFrame, T OldValue, T NewValue)
+{
+	if (OldValue == NewValue
+		|| !(OnHealthChanged.IsBound() || OnStaminaChanged.IsBound() || OnGoldChanged.IsBound() || OnSoulsChanged.IsBound())) return;
+
+	if (!(ChangedAttributes & Attribute))
+	{
+		ChangedAttributes |= Attribute;
+		ValueBeforeFrame = OldValue;
+	}
+	if (!IsComponentTickEnabled())
+	{
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UAttributeComponent::BroadcastChanges()
+{
+	const uint8 Changed = ChangedAttributes;
+	ChangedAttributes = 0;
+	SetComponentTickEnabled(false);
+
+	// Attributes changed back to where they began the frame aren't broadcast
+	if ((Changed & AttributeChange::Health) && HealthBeforeFrame != Health)
+	{
+		OnHealthChanged.Broadcast(this, HealthBeforeFrame, Health);
+	}
+	if ((Changed & AttributeChange::Stamina) && StaminaBeforeFrame != Stamina)
+	{
+		OnStaminaChanged.Broadcast(this, StaminaBeforeFrame, Stamina);
+	}
+	if ((Changed & AttributeChange::Gold) && GoldBeforeFrame != Gold)
+	{
+		OnGoldChanged.Broadcast(this, GoldBeforeFrame, Gold);
+	}
+	if ((Changed & AttributeChange::Souls) && SoulsBeforeFrame != Souls)
+	{
+		OnSoulsChanged.Broadcast(this, SoulsBeforeFrame, Souls);
+	}
+}
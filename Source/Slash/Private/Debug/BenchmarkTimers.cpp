@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Debug/BenchmarkTimers.h"
+
+namespace SlashBenchmark
+{
+	bool bTimersEnabled = false;
+
+	FBenchmarkTimer EnemyTick;
+	FBenchmarkTimer EnemyAIBatch;
+	FBenchmarkTimer WeaponSwing;
+	FBenchmarkTimer WeaponTraceWait;
+	FBenchmarkTimer DamageResolve;
+	FBenchmarkTimer ReplayRecord;
+	FBenchmarkTimer CharacterMovement;
+	FBenchmarkTimer Animation;
+	int64 NumWeaponHits = 0;
+
+	void ResetTimers()
+	{
+		EnemyTick.Reset();
+		EnemyAIBatch.Reset();
+		WeaponSwing.Reset();
+		WeaponTraceWait.Reset();
+		DamageResolve.Reset();
+		ReplayRecord.Reset();
+		CharacterMovement.Reset();
+		Animation.Reset();
+		NumWeaponHits = 0;
+	}
+}
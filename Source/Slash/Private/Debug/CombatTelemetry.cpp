@@ -0,0 +1,271 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Debug/CombatTelemetry.h"
+
+#include <atomic>
+#include "Slash.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonObject.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Tasks/Task.h"
+
+namespace SlashTelemetry
+{
+	bool bEnabled = false;
+
+	/// Buckets of a histogram, each BucketWidth wide from Min
+	struct FHistogramLayout
+	{
+		const TCHAR* Name;
+		double Min;
+		double BucketWidth;
+		/// Whether keys are classes from GetClassKey
+		bool bKeyedByClass;
+	};
+
+	constexpr FHistogramLayout HistogramLayouts[] = {
+		{ TEXT("DamagePerHit"), 0, 10, false },
+		{ TEXT("HitsPerSwing"), 0, 1, false },
+		{ TEXT("TimeToKill"), 0, 2, true },
+	};
+	static_assert(UE_ARRAY_COUNT(HistogramLayouts) == static_cast<int32>(EHistogram::MAX), "Every histogram needs a layout");
+
+	constexpr const TCHAR* CounterNames[] = {
+		TEXT("Hits"),
+		TEXT("Swings"),
+		TEXT("Deaths"),
+		TEXT("Dodges"),
+		TEXT("SoulsEarned"),
+		TEXT("GoldEarned"),
+	};
+	static_assert(UE_ARRAY_COUNT(CounterNames) == static_cast<int32>(ECounter::MAX), "Every counter needs a name");
+
+	/// Counts of one thread.  Only that thread writes them, while a flush may read them from another
+	struct FShard
+	{
+		struct FHistogram
+		{
+			std::atomic<uint64> Buckets[NumBuckets];
+			std::atomic<uint64> Count;
+			std::atomic<double> Sum;
+		};
+
+		std::atomic<int64> Counters[static_cast<int32>(ECounter::MAX)];
+		FHistogram Histograms[static_cast<int32>(EHistogram::MAX)][MaxKeys];
+	};
+
+	/// Totals over every thread's shard
+	struct FTotals
+	{
+		struct FHistogram
+		{
+			uint64 Buckets[NumBuckets] = {};
+			uint64 Count = 0;
+			double Sum = 0;
+		};
+
+		int64 Counters[static_cast<int32>(ECounter::MAX)] = {};
+		FHistogram Histograms[static_cast<int32>(EHistogram::MAX)][MaxKeys];
+	};
+
+	/// Every shard made so far, kept for the rest of the process as threads are pooled
+	static TArray<TUniquePtr<FShard>> Shards;
+	static FCriticalSection ShardsLock;
+	static thread_local FShard* ThreadShard = nullptr;
+
+	/// Classes named by histogram keys, indexed by key
+	static TArray<FName> ClassNames;
+	static std::atomic<bool> bFlushing = false;
+	static FTSTicker::FDelegateHandle FlushTickerHandle;
+	static double LastFlushTime = 0;
+
+	/// Add to a value only its own thread writes, which needs no read-modify-write
+	template <typename T>
+	static FORCEINLINE void AddOwned(std::atomic<T>& Value, T Amount)
+	{
+		Value.store(Value.load(std::memory_order_relaxed) + Amount, std::memory_order_relaxed);
+	}
+
+	static FShard& GetThreadShard()
+	{
+		if (!ThreadShard)
+		{
+			FScopeLock Lock(&ShardsLock);
+			ThreadShard = Shards.Add_GetRef(MakeUnique<FShard>()).Get();
+		}
+		return *ThreadShard;
+	}
+
+	static void SumShards(FTotals& Totals)
+	{
+		FScopeLock Lock(&ShardsLock);
+		for (const TUniquePtr<FShard>& Shard : Shards)
+		{
+			for (int32 Counter = 0; Counter < static_cast<int32>(ECounter::MAX); ++Counter)
+			{
+				Totals.Counters[Counter] += Shard->Counters[Counter].load(std::memory_order_relaxed);
+			}
+			for (int32 Histogram = 0; Histogram < static_cast<int32>(EHistogram::MAX); ++Histogram)
+			{
+				for (int32 Key = 0; Key < MaxKeys; ++Key)
+				{
+					const FShard::FHistogram& From = Shard->Histograms[Histogram][Key];
+					FTotals::FHistogram& To = Totals.Histograms[Histogram][Key];
+					for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+					{
+						To.Buckets[Bucket] += From.Buckets[Bucket].load(std::memory_order_relaxed);
+					}
+					To.Count += From.Count.load(std::memory_order_relaxed);
+					To.Sum += From.Sum.load(std::memory_order_relaxed);
+				}
+			}
+		}
+	}
+
+	static FString GetKeyName(const FHistogramLayout& Layout, int32 Key, const TArray<FName>& KeyClassNames)
+	{
+		if (!Layout.bKeyedByClass) return FString();
+		return KeyClassNames.IsValidIndex(Key) ? KeyClassNames[Key].ToString() : FString(TEXT("Other"));
+	}
+
+	/// Sum every shard and write the totals, on a background task
+	static void WriteTotals(const TArray<FName>& KeyClassNames, double Time)
+	{
+		FTotals Totals;
+		SumShards(Totals);
+
+		FString Csv = TEXT("kind,name,key,bucket_min,bucket_max,value\n");
+		const TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+		Report->SetNumberField(TEXT("time"), Time);
+
+		const TSharedRef<FJsonObject> CounterReport = MakeShared<FJsonObject>();
+		for (int32 Counter = 0; Counter < static_cast<int32>(ECounter::MAX); ++Counter)
+		{
+			Csv += FString::Printf(TEXT("counter,%s,,,,%lld\n"), CounterNames[Counter], Totals.Counters[Counter]);
+			CounterReport->SetNumberField(CounterNames[Counter], Totals.Counters[Counter]);
+		}
+		Report->SetObjectField(TEXT("counters"), CounterReport);
+
+		const TSharedRef<FJsonObject> HistogramReport = MakeShared<FJsonObject>();
+		for (int32 Histogram = 0; Histogram < static_cast<int32>(EHistogram::MAX); ++Histogram)
+		{
+			const FHistogramLayout& Layout = HistogramLayouts[Histogram];
+			TArray<TSharedPtr<FJsonValue>> KeyReports;
+			for (int32 Key = 0; Key < MaxKeys; ++Key)
+			{
+				const FTotals::FHistogram& Totalled = Totals.Histograms[Histogram][Key];
+				if (Totalled.Count == 0) continue;
+
+				const FString KeyName = GetKeyName(Layout, Key, KeyClassNames);
+				TArray<TSharedPtr<FJsonValue>> Buckets;
+				for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+				{
+					const double BucketMin = Layout.Min + Bucket * Layout.BucketWidth;
+					Csv += FString::Printf(TEXT("histogram,%s,%s,%g,%g,%llu\n"), Layout.Name, *KeyName, BucketMin,
+						BucketMin + Layout.BucketWidth, Totalled.Buckets[Bucket]);
+					Buckets.Add(MakeShared<FJsonValueNumber>(Totalled.Buckets[Bucket]));
+				}
+				const TSharedRef<FJsonObject> KeyReport = MakeShared<FJsonObject>();
+				KeyReport->SetStringField(TEXT("key"), KeyName);
+				KeyReport->SetNumberField(TEXT("count"), Totalled.Count);
+				KeyReport->SetNumberField(TEXT("mean"), Totalled.Sum / Totalled.Count);
+				KeyReport->SetArrayField(TEXT("buckets"), Buckets);
+				KeyReports.Add(MakeShared<FJsonValueObject>(KeyReport));
+			}
+			const TSharedRef<FJsonObject> LayoutReport = MakeShared<FJsonObject>();
+			LayoutReport->SetNumberField(TEXT("min"), Layout.Min);
+			LayoutReport->SetNumberField(TEXT("bucket_width"), Layout.BucketWidth);
+			LayoutReport->SetArrayField(TEXT("keys"), KeyReports);
+			HistogramReport->SetObjectField(Layout.Name, LayoutReport);
+		}
+		Report->SetObjectField(TEXT("histograms"), HistogramReport);
+
+		FString Json;
+		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+		const FString BasePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Telemetry"), TEXT("CombatTelemetry"));
+		if (!FFileHelper::SaveStringToFile(Csv, *(BasePath + TEXT(".csv")))
+			|| !FJsonSerializer::Serialize(Report, Writer)
+			|| !FFileHelper::SaveStringToFile(Json, *(BasePath + TEXT(".json"))))
+		{
+			UE_LOG(LogSlash, Warning, TEXT("Combat telemetry could not be written to %s"), *BasePath);
+		}
+	}
+
+	void AddCount(ECounter Counter, int64 Amount)
+	{
+		AddOwned(GetThreadShard().Counters[static_cast<int32>(Counter)], Amount);
+	}
+
+	void AddSample(EHistogram Histogram, int32 Key, double Value)
+	{
+		const FHistogramLayout& Layout = HistogramLayouts[static_cast<int32>(Histogram)];
+		const int32 Bucket = FMath::Clamp(FMath::FloorToInt32((Value - Layout.Min) / Layout.BucketWidth), 0, NumBuckets - 1);
+		FShard::FHistogram& Sampled = GetThreadShard().Histograms[static_cast<int32>(Histogram)][FMath::Clamp(Key, 0, MaxKeys - 1)];
+		AddOwned(Sampled.Buckets[Bucket], uint64(1));
+		AddOwned(Sampled.Count, uint64(1));
+		AddOwned(Sampled.Sum, Value);
+	}
+
+	int32 GetClassKey(const UClass* Class)
+	{
+		const FName ClassName = Class ? Class->GetFName() : NAME_None;
+		const int32 Key = ClassNames.Find(ClassName);
+		if (Key != INDEX_NONE) return Key;
+		// Classes past the last key are counted together as "Other"
+		return ClassNames.Num() < MaxKeys - 1 ? ClassNames.Add(ClassName) : MaxKeys - 1;
+	}
+
+	void Flush()
+	{
+		bool bExpected = false;
+		if (!bFlushing.compare_exchange_strong(bExpected, true)) return;
+
+		LastFlushTime = FPlatformTime::Seconds();
+		UE::Tasks::Launch(UE_SOURCE_LOCATION, [KeyClassNames = ClassNames, Time = LastFlushTime]
+		{
+			WriteTotals(KeyClassNames, Time);
+			bFlushing = false;
+		});
+	}
+}
+
+static TAutoConsoleVariable<float> CVarTelemetryFlushInterval(
+	TEXT("Slash.Telemetry.FlushInterval"),
+	30,
+	TEXT("Seconds between writes of combat telemetry to Saved/Telemetry while it is enabled."));
+
+static FAutoConsoleVariableRef CVarTelemetryEnabled(
+	TEXT("Slash.Telemetry.Enabled"),
+	SlashTelemetry::bEnabled,
+	TEXT("Gather combat telemetry and write it to Saved/Telemetry periodically, and once more when disabled."),
+	FConsoleVariableDelegate::CreateLambda([](IConsoleVariable*)
+	{
+		using namespace SlashTelemetry;
+		if (bEnabled && !FlushTickerHandle.IsValid())
+		{
+			LastFlushTime = FPlatformTime::Seconds();
+			FlushTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float)
+			{
+				if (FPlatformTime::Seconds() - LastFlushTime >= CVarTelemetryFlushInterval.GetValueOnGameThread())
+				{
+					Flush();
+				}
+				return true;
+			}));
+		}
+		else if (!bEnabled && FlushTickerHandle.IsValid())
+		{
+			FTSTicker::GetCoreTicker().RemoveTicker(FlushTickerHandle);
+			FlushTickerHandle.Reset();
+			Flush();
+		}
+	}));
+
+static FAutoConsoleCommand TelemetryFlushCommand(
+	TEXT("Slash.Telemetry.Flush"),
+	TEXT("Write the combat telemetry gathered so far to Saved/Telemetry."),
+	FConsoleCommandDelegate::CreateStatic(&SlashTelemetry::Flush));
@@ -0,0 +1,392 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Enemy/AmbientEnemySubsystem.h"
+
+#include "EngineUtils.h"
+#include "NavigationSystem.h"
+#include "Slash.h"
+#include "Async/ParallelFor.h"
+#include "Components/AttributeComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Debug/SlashStats.h"
+#include "Enemy/Enemy.h"
+#include "Enemy/EnemyStateTree.h"
+#include "Enemy/EnemyTypes.h"
+#include "Enemy/PatrolRoute.h"
+#include "Kismet/GameplayStatics.h"
+#include "Pooling/ActorPoolSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ambient Tick"), STAT_Ambient_Tick, STATGROUP_SlashAmbient);
+DECLARE_CYCLE_STAT(TEXT("Move Pass"), STAT_Ambient_Move, STATGROUP_SlashAmbient);
+DECLARE_CYCLE_STAT(TEXT("Arrival Pass"), STAT_Ambient_Arrival, STATGROUP_SlashAmbient);
+DECLARE_CYCLE_STAT(TEXT("Promotion Pass"), STAT_Ambient_Promotion, STATGROUP_SlashAmbient);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Entities"), STAT_Ambient_NumEntities, STATGROUP_SlashAmbient);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Simulated Entities"), STAT_Ambient_NumSimulated, STATGROUP_SlashAmbient);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Promoted Actors"), STAT_Ambient_NumActors, STATGROUP_SlashAmbient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Promotions"), STAT_Ambient_NumPromoted, STATGROUP_SlashAmbient);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Demotions"), STAT_Ambient_NumDemoted, STATGROUP_SlashAmbient);
+
+static TAutoConsoleVariable<float> CVarAmbientPromoteDistance(
+	TEXT("Slash.Ambient.PromoteDistance"),
+	5000,
+	TEXT("Distance from the player within which ambient enemy entities become actors."));
+
+static TAutoConsoleVariable<float> CVarAmbientDemoteDistance(
+	TEXT("Slash.Ambient.DemoteDistance"),
+	6500,
+	TEXT("Distance from the player beyond which ambient enemy actors not in combat become entities again.  Kept above the promote distance so enemies don't flip at the edge."));
+
+static TAutoConsoleVariable<int32> CVarAmbientMaxChangesPerUpdate(
+	TEXT("Slash.Ambient.MaxChangesPerUpdate"),
+	16,
+	TEXT("Most ambient enemies promoted, and most demoted, per promotion pass.  The rest wait for the next pass."));
+
+static TAutoConsoleVariable<float> CVarAmbientUpdateInterval(
+	TEXT("Slash.Ambient.UpdateInterval"),
+	0.25,
+	TEXT("Seconds between ambient enemy promotion passes."));
+
+namespace AmbientEnemy
+{
+	/// Fewer entities than this are moved on the game thread alone, not worth waking workers for
+	constexpr int32 MinParallelEntities = 256;
+	/// Height above and below an entity searched for the navmesh when promoting it
+	constexpr double NavProjectionHeight = 500;
+}
+
+void UAmbientEnemySubsystem::Deinitialize()
+{
+	Locations.Empty();
+	Yaws.Empty();
+	ClassIndices.Empty();
+	RouteIndices.Empty();
+	Waypoints.Empty();
+	States.Empty();
+	Healths.Empty();
+	Souls.Empty();
+	WaitTimes.Empty();
+	Arrived.Empty();
+	InRange.Empty();
+	Actors.Empty();
+	Classes.Empty();
+	Routes.Empty();
+	NumActors = 0;
+	Super::Deinitialize();
+}
+
+void UAmbientEnemySubsystem::AddEntity(TSubclassOf<AEnemy> EnemyClass, const FVector& Location, float Yaw, APatrolRoute* PatrolRoute)
+{
+	if (!EnemyClass) return;
+
+	const int32 ClassIndex = FindOrAddClass(EnemyClass);
+	const int32 RouteIndex = FindOrAddRoute(PatrolRoute);
+	const AEnemy* Defaults = EnemyClass->GetDefaultObject<AEnemy>();
+	const UAttributeComponent* DefaultAttributes = Defaults->FindComponentByClass<UAttributeComponent>();
+
+	Locations.Add(Location);
+	Yaws.Add(Yaw);
+	ClassIndices.Add(ClassIndex);
+	RouteIndices.Add(RouteIndex);
+	// Join the route at the closest waypoint, as placed enemies do
+	Waypoints.Add(RouteIndex != INDEX_NONE ? PatrolRoute->GetClosestWaypoint(Location) : INDEX_NONE);
+	States.Add(EEnemyState::Patrolling);
+	Healths.Add(DefaultAttributes ? DefaultAttributes->GetHealth() : 0);
+	// Random soul amount, as placed enemies get on BeginPlay
+	Souls.Add(FMath::RandRange(1, 10));
+	WaitTimes.Add(0);
+	Arrived.Add(false);
+	InRange.Add(false);
+	Actors.AddDefaulted();
+}
+
+int32 UAmbientEnemySubsystem::FindOrAddClass(TSubclassOf<AEnemy> EnemyClass)
+{
+	const int32 Existing = Classes.IndexOfByPredicate([EnemyClass](const FEntityClass& Entry) { return Entry.Class == EnemyClass; });
+	if (Existing != INDEX_NONE) return Existing;
+
+	const AEnemy* Defaults = EnemyClass->GetDefaultObject<AEnemy>();
+	return Classes.Add({
+		EnemyClass,
+		Defaults->PatrollingSpeed,
+		Defaults->PatrolWaitMin,
+		Defaults->PatrolWaitMax,
+		FMath::Square(Defaults->PatrolRadius),
+		Defaults->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() });
+}
+
+int32 UAmbientEnemySubsystem::FindOrAddRoute(APatrolRoute* PatrolRoute)
+{
+	if (!PatrolRoute || PatrolRoute->GetNumWaypoints() == 0) return INDEX_NONE;
+
+	const int32 Existing = Routes.IndexOfByPredicate([PatrolRoute](const FEntityRoute& Entry) { return Entry.Route == PatrolRoute; });
+	if (Existing != INDEX_NONE) return Existing;
+
+	FEntityRoute& Route = Routes.AddDefaulted_GetRef();
+	Route.Route = PatrolRoute;
+	Route.Waypoints.Reserve(PatrolRoute->GetNumWaypoints());
+	for (int32 Waypoint = 0; Waypoint < PatrolRoute->GetNumWaypoints(); ++Waypoint)
+	{
+		Route.Waypoints.Add(PatrolRoute->GetWaypointLocation(Waypoint));
+	}
+	return Routes.Num() - 1;
+}
+
+void UAmbientEnemySubsystem::RemoveEntity(int32 Entity)
+{
+	Locations.RemoveAtSwap(Entity, 1, false);
+	Yaws.RemoveAtSwap(Entity, 1, false);
+	ClassIndices.RemoveAtSwap(Entity, 1, false);
+	RouteIndices.RemoveAtSwap(Entity, 1, false);
+	Waypoints.RemoveAtSwap(Entity, 1, false);
+	States.RemoveAtSwap(Entity, 1, false);
+	Healths.RemoveAtSwap(Entity, 1, false);
+	Souls.RemoveAtSwap(Entity, 1, false);
+	WaitTimes.RemoveAtSwap(Entity, 1, false);
+	Arrived.RemoveAtSwap(Entity, 1, false);
+	InRange.RemoveAtSwap(Entity, 1, false);
+	Actors.RemoveAtSwap(Entity, 1, false);
+}
+
+void UAmbientEnemySubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Ambient_Tick);
+
+	double StartTime = FPlatformTime::Seconds();
+	MoveEntities(DeltaTime);
+	const double MoveEndTime = FPlatformTime::Seconds();
+	MoveMs = (MoveEndTime - StartTime) * 1000;
+
+	AdvanceArrivedEntities();
+	ArrivalMs = (FPlatformTime::Seconds() - MoveEndTime) * 1000;
+
+	TimeUntilPromotionUpdate -= DeltaTime;
+	if (TimeUntilPromotionUpdate <= 0)
+	{
+		TimeUntilPromotionUpdate = CVarAmbientUpdateInterval.GetValueOnGameThread();
+		StartTime = FPlatformTime::Seconds();
+		UpdatePromotions();
+		PromotionMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+	}
+
+	SET_DWORD_STAT(STAT_Ambient_NumEntities, Locations.Num());
+	SET_DWORD_STAT(STAT_Ambient_NumSimulated, Locations.Num() - NumActors);
+	SET_DWORD_STAT(STAT_Ambient_NumActors, NumActors);
+}
+
+void UAmbientEnemySubsystem::MoveEntities(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Ambient_Move);
+
+	// Every entity only touches its own slots, route and class data is read only
+	ParallelFor(Locations.Num(), [this, DeltaTime](int32 Entity)
+	{
+		if (!Actors[Entity].IsExplicitlyNull() || States[Entity] != EEnemyState::Patrolling || RouteIndices[Entity] == INDEX_NONE) return;
+		if (WaitTimes[Entity] > 0)
+		{
+			WaitTimes[Entity] -= DeltaTime;
+			return;
+		}
+
+		const FEntityClass& Class = Classes[ClassIndices[Entity]];
+		const FVector& Goal = Routes[RouteIndices[Entity]].Waypoints[Waypoints[Entity]];
+		const FVector ToGoal = FVector(Goal.X - Locations[Entity].X, Goal.Y - Locations[Entity].Y, 0);
+		const double DistanceSquared = ToGoal.SizeSquared();
+		if (DistanceSquared <= Class.PatrolRadiusSquared)
+		{
+			Arrived[Entity] = true;
+			return;
+		}
+
+		const double Distance = FMath::Sqrt(DistanceSquared);
+		Locations[Entity] += ToGoal * (FMath::Min(Class.Speed * DeltaTime, Distance) / Distance);
+		Yaws[Entity] = FMath::RadiansToDegrees(FMath::Atan2(ToGoal.Y, ToGoal.X));
+	}, Locations.Num() < AmbientEnemy::MinParallelEntities ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void UAmbientEnemySubsystem::AdvanceArrivedEntities()
+{
+	SCOPE_CYCLE_COUNTER(STAT_Ambient_Arrival);
+
+	// Routes pick random waypoints from the shared random stream, so this stays on the game thread
+	for (int32 Entity = 0; Entity < Arrived.Num(); ++Entity)
+	{
+		if (!Arrived[Entity]) continue;
+		Arrived[Entity] = false;
+
+		const FEntityClass& Class = Classes[ClassIndices[Entity]];
+		const FEntityRoute& Route = Routes[RouteIndices[Entity]];
+		const APatrolRoute* PatrolRoute = Route.Route.Get();
+		Waypoints[Entity] = PatrolRoute ? PatrolRoute->GetNextWaypoint(Waypoints[Entity]) : (Waypoints[Entity] + 1) % Route.Waypoints.Num();
+		WaitTimes[Entity] = FMath::FRandRange(Class.WaitMin, Class.WaitMax);
+	}
+}
+
+void UAmbientEnemySubsystem::UpdatePromotions()
+{
+	SCOPE_CYCLE_COUNTER(STAT_Ambient_Promotion);
+
+	// Promoted actors move themselves, follow them and drop the ones that died or were taken away
+	for (int32 Entity = Actors.Num() - 1; Entity >= 0; --Entity)
+	{
+		if (Actors[Entity].IsExplicitlyNull()) continue;
+
+		const AEnemy* Enemy = Actors[Entity].Get();
+		if (!Enemy || Enemy->EnemyState == EEnemyState::Dead || UActorPoolSubsystem::IsPooled(Enemy))
+		{
+			--NumActors;
+			RemoveEntity(Entity);
+			continue;
+		}
+		Locations[Entity] = Enemy->GetActorLocation();
+	}
+
+	const APawn* Player = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+	if (!Player) return;
+
+	const FVector PlayerLocation = Player->GetActorLocation();
+	const double PromoteDistanceSquared = FMath::Square(CVarAmbientPromoteDistance.GetValueOnGameThread());
+	const double DemoteDistanceSquared = FMath::Square(FMath::Max(CVarAmbientDemoteDistance.GetValueOnGameThread(), CVarAmbientPromoteDistance.GetValueOnGameThread()));
+	ParallelFor(Locations.Num(), [&](int32 Entity)
+	{
+		const double DistanceSquared = FVector::DistSquared(Locations[Entity], PlayerLocation);
+		InRange[Entity] = DistanceSquared <= (Actors[Entity].IsExplicitlyNull() ? PromoteDistanceSquared : DemoteDistanceSquared);
+	}, Locations.Num() < AmbientEnemy::MinParallelEntities ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	const int32 MaxChanges = FMath::Max(CVarAmbientMaxChangesPerUpdate.GetValueOnGameThread(), 1);
+	int32 NumPromotedNow = 0;
+	int32 NumDemotedNow = 0;
+	for (int32 Entity = 0; Entity < Locations.Num(); ++Entity)
+	{
+		const bool bPromoted = !Actors[Entity].IsExplicitlyNull();
+		if (InRange[Entity] && !bPromoted && NumPromotedNow < MaxChanges)
+		{
+			Promote(Entity);
+			++NumPromotedNow;
+		}
+		else if (!InRange[Entity] && bPromoted && NumDemotedNow < MaxChanges)
+		{
+			// Enemies in combat finish their fight as actors, however far it takes them
+			const AEnemy* Enemy = Actors[Entity].Get();
+			if (!Enemy->GetStateTree().IsInCombat(Enemy->EnemyState))
+			{
+				Demote(Entity);
+				++NumDemotedNow;
+			}
+		}
+	}
+}
+
+void UAmbientEnemySubsystem::Promote(int32 Entity)
+{
+	const FEntityClass& Class = Classes[ClassIndices[Entity]];
+	const FTransform Transform(FRotator(0, Yaws[Entity], 0), FindActorLocation(Entity));
+	AEnemy* Enemy = UActorPoolSubsystem::AcquireActor<AEnemy>(GetWorld(), Class.Class, Transform);
+	if (!Enemy) return;
+
+	APatrolRoute* PatrolRoute = RouteIndices[Entity] != INDEX_NONE ? Routes[RouteIndices[Entity]].Route.Get() : nullptr;
+	Enemy->RestoreAmbientState(PatrolRoute, Waypoints[Entity], Healths[Entity], Souls[Entity]);
+	Actors[Entity] = Enemy;
+	++NumActors;
+	++NumPromoted;
+	INC_DWORD_STAT(STAT_Ambient_NumPromoted);
+}
+
+void UAmbientEnemySubsystem::Demote(int32 Entity)
+{
+	AEnemy* Enemy = Actors[Entity].Get();
+	Locations[Entity] = Enemy->GetActorLocation();
+	Yaws[Entity] = Enemy->GetActorRotation().Yaw;
+	States[Entity] = Enemy->EnemyState;
+	if (Enemy->Attributes)
+	{
+		Healths[Entity] = Enemy->Attributes->GetHealth();
+		Souls[Entity] = Enemy->Attributes->GetSouls();
+	}
+	RouteIndices[Entity] = FindOrAddRoute(Enemy->PatrolRoute);
+	Waypoints[Entity] = RouteIndices[Entity] != INDEX_NONE && Enemy->PatrolRoute->IsValidWaypoint(Enemy->PatrolWaypoint)
+		? Enemy->PatrolWaypoint
+		: Enemy->PatrolRoute ? Enemy->PatrolRoute->GetClosestWaypoint(Locations[Entity]) : INDEX_NONE;
+	WaitTimes[Entity] = 0;
+
+	UActorPoolSubsystem::ReleaseActor(Enemy);
+	Actors[Entity] = nullptr;
+	--NumActors;
+	++NumDemoted;
+	INC_DWORD_STAT(STAT_Ambient_NumDemoted);
+}
+
+FVector UAmbientEnemySubsystem::FindActorLocation(int32 Entity) const
+{
+	// Entities walk straight lines at the height they started, put the actor back on the ground
+	const float HalfHeight = Classes[ClassIndices[Entity]].HalfHeight;
+	const UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (FNavLocation NavLocation; NavigationSystem
+		&& NavigationSystem->ProjectPointToNavigation(Locations[Entity], NavLocation, FVector(100, 100, AmbientEnemy::NavProjectionHeight + HalfHeight)))
+	{
+		return NavLocation.Location + FVector(0, 0, HalfHeight);
+	}
+	return Locations[Entity];
+}
+
+void UAmbientEnemySubsystem::DumpStats() const
+{
+	UE_LOG(LogSlash, Display, TEXT("Ambient enemies: %d entities, %d simulated, %d actors, %d promoted and %d demoted so far"),
+		Locations.Num(), Locations.Num() - NumActors, NumActors, NumPromoted, NumDemoted);
+	UE_LOG(LogSlash, Display, TEXT("Ambient passes: move %.3f ms, arrival %.3f ms, last promotion %.3f ms"),
+		MoveMs, ArrivalMs, PromotionMs);
+}
+
+TStatId UAmbientEnemySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAmbientEnemySubsystem, STATGROUP_Tickables);
+}
+
+bool UAmbientEnemySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorld AmbientStatsCommand(
+	TEXT("Slash.Ambient.Stats"),
+	TEXT("Log ambient enemy entity and actor counts and pass timings."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UAmbientEnemySubsystem* AmbientEnemies = World ? World->GetSubsystem<UAmbientEnemySubsystem>() : nullptr)
+		{
+			AmbientEnemies->DumpStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs AmbientSpawnCommand(
+	TEXT("Slash.Ambient.Spawn"),
+	TEXT("Add ambient enemies around the player, patrolling the closest route: Slash.Ambient.Spawn [Count] [Radius] [EnemyClassPath]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UAmbientEnemySubsystem* AmbientEnemies = World ? World->GetSubsystem<UAmbientEnemySubsystem>() : nullptr;
+		const APawn* Player = UGameplayStatics::GetPlayerPawn(World, 0);
+		if (!AmbientEnemies || !Player) return;
+
+		const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000;
+		const double Radius = Args.Num() > 1 ? FCString::Atod(*Args[1]) : 20000;
+		const TSubclassOf<AEnemy> EnemyClass = Args.Num() > 2 ? LoadClass<AEnemy>(nullptr, *Args[2]) : AEnemy::StaticClass();
+		if (!EnemyClass) return;
+
+		APatrolRoute* ClosestRoute = nullptr;
+		double ClosestDistanceSquared = TNumericLimits<double>::Max();
+		for (TActorIterator<APatrolRoute> It(World); It; ++It)
+		{
+			if (const double DistanceSquared = FVector::DistSquared(It->GetActorLocation(), Player->GetActorLocation()); DistanceSquared < ClosestDistanceSquared)
+			{
+				ClosestRoute = *It;
+				ClosestDistanceSquared = DistanceSquared;
+			}
+		}
+
+		const FVector Center = Player->GetActorLocation();
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const FVector2D Offset = FMath::RandPointInCircle(Radius);
+			AmbientEnemies->AddEntity(EnemyClass, Center + FVector(Offset, 0), FMath::FRandRange(-180.f, 180.f), ClosestRoute);
+		}
+	}));
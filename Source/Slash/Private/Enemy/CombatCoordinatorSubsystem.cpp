@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Enemy/CombatCoordinatorSubsystem.h"
+
+#include "Debug/SlashStats.h"
+#include "Enemy/Enemy.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tokens Granted"), STAT_Combat_NumGranted, STATGROUP_SlashCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tokens Denied"), STAT_Combat_NumDenied, STATGROUP_SlashCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemies Attacking"), STAT_Combat_NumHolders, STATGROUP_SlashCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemies Waiting"), STAT_Combat_NumWaiting, STATGROUP_SlashCombat);
+
+static TAutoConsoleVariable<int32> CVarCombatAttackTokensPerTarget(
+	TEXT("Slash.Combat.AttackTokensPerTarget"),
+	2,
+	TEXT("Number of enemies that may attack the same target at once.  0 lets every enemy in attack radius attack."));
+
+bool UCombatCoordinatorSubsystem::RequestAttackToken(AEnemy* Enemy, AActor* Target)
+{
+	if (!Enemy || !Target) return false;
+
+	// Tokens and places in line for another target are given up first
+	if (const TObjectKey<AActor>* CurrentTarget = EnemyTargets.Find(Enemy); CurrentTarget && *CurrentTarget != TObjectKey<AActor>(Target))
+	{
+		ReleaseAttackToken(Enemy);
+	}
+
+	FTargetTokens& Tokens = TargetTokens.FindOrAdd(Target);
+	if (Tokens.Holders.Contains(Enemy)) return true;
+	if (Tokens.Queue.Contains(Enemy)) return false;
+
+	// Tokens of enemies destroyed while holding them go to the enemies already waiting
+	FGrantedEnemies Granted;
+	GrantWaiting(Tokens, Granted);
+
+	EnemyTargets.Add(Enemy, Target);
+	const int32 MaxTokens = CVarCombatAttackTokensPerTarget.GetValueOnGameThread();
+	// Waiting enemies go first, even if a token is free
+	if (Tokens.Queue.Num() == 0 && (MaxTokens <= 0 || Tokens.Holders.Num() < MaxTokens))
+	{
+		Tokens.Holders.Add(Enemy);
+		++NumGranted;
+		INC_DWORD_STAT(STAT_Combat_NumGranted);
+		UpdateCounters();
+		NotifyGranted(Granted);
+		return true;
+	}
+
+	Tokens.Queue.Add(Enemy);
+	++NumDenied;
+	INC_DWORD_STAT(STAT_Combat_NumDenied);
+	UpdateCounters();
+	NotifyGranted(Granted);
+	return false;
+}
+
+void UCombatCoordinatorSubsystem::ReleaseAttackToken(AEnemy* Enemy)
+{
+	TObjectKey<AActor> Target;
+	if (!EnemyTargets.RemoveAndCopyValue(Enemy, Target)) return;
+
+	FGrantedEnemies Granted;
+	if (FTargetTokens* Tokens = TargetTokens.Find(Target))
+	{
+		Tokens->Queue.Remove(Enemy);
+		if (Tokens->Holders.Remove(Enemy) > 0)
+		{
+			GrantWaiting(*Tokens, Granted);
+		}
+		if (Tokens->Holders.Num() == 0 && Tokens->Queue.Num() == 0)
+		{
+			TargetTokens.Remove(Target);
+		}
+	}
+	UpdateCounters();
+	NotifyGranted(Granted);
+}
+
+bool UCombatCoordinatorSubsystem::HasAttackToken(const AEnemy* Enemy) const
+{
+	const TObjectKey<AActor>* Target = EnemyTargets.Find(Enemy);
+	const FTargetTokens* Tokens = Target ? TargetTokens.Find(*Target) : nullptr;
+	return Tokens && Tokens->Holders.Contains(Enemy);
+}
+
+void UCombatCoordinatorSubsystem::GrantWaiting(FTargetTokens& Tokens, FGrantedEnemies& OutGranted)
+{
+	RemoveStale(Tokens);
+	const int32 MaxTokens = CVarCombatAttackTokensPerTarget.GetValueOnGameThread();
+	while (Tokens.Queue.Num() > 0 && (MaxTokens <= 0 || Tokens.Holders.Num() < MaxTokens))
+	{
+		AEnemy* Enemy = Tokens.Queue[0].Get();
+		Tokens.Queue.RemoveAt(0, 1, false);
+		Tokens.Holders.Add(Enemy);
+		++NumGranted;
+		++NumGrantedWaiting;
+		INC_DWORD_STAT(STAT_Combat_NumGranted);
+		OutGranted.Add(Enemy);
+	}
+}
+
+void UCombatCoordinatorSubsystem::NotifyGranted(const FGrantedEnemies& Granted)
+{
+	// Enemies may request or release tokens again in response, so nothing may be held across these calls
+	for (AEnemy* Enemy : Granted)
+	{
+		if (IsValid(Enemy))
+		{
+			Enemy->OnAttackTokenGranted();
+		}
+	}
+}
+
+void UCombatCoordinatorSubsystem::RemoveStale(FTargetTokens& Tokens)
+{
+	Tokens.Holders.RemoveAllSwap([](const TWeakObjectPtr<AEnemy>& Enemy) { return !Enemy.IsValid(); }, false);
+	// Keep the order of waiting enemies
+	Tokens.Queue.RemoveAll([](const TWeakObjectPtr<AEnemy>& Enemy) { return !Enemy.IsValid(); });
+}
+
+void UCombatCoordinatorSubsystem::UpdateCounters()
+{
+	NumHolders = 0;
+	NumWaiting = 0;
+	for (const TPair<TObjectKey<AActor>, FTargetTokens>& Entry : TargetTokens)
+	{
+		NumHolders += Entry.Value.Holders.Num();
+		NumWaiting += Entry.Value.Queue.Num();
+	}
+	PeakAttackers = FMath::Max(PeakAttackers, NumHolders);
+	SET_DWORD_STAT(STAT_Combat_NumHolders, NumHolders);
+	SET_DWORD_STAT(STAT_Combat_NumWaiting, NumWaiting);
+}
+
+bool UCombatCoordinatorSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
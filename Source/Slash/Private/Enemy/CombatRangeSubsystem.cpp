@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Enemy/CombatRangeSubsystem.h"
+
+#include "Debug/SlashStats.h"
+#include "Enemy/Enemy.h"
+
+DECLARE_CYCLE_STAT(TEXT("Range Tick"), STAT_Combat_RangeTick, STATGROUP_SlashCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ranges Watched"), STAT_Combat_NumWatched, STATGROUP_SlashCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Range Checks"), STAT_Combat_NumRangeChecks, STATGROUP_SlashCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Range Events"), STAT_Combat_NumRangeEvents, STATGROUP_SlashCombat);
+
+static TAutoConsoleVariable<bool> CVarCombatRangeEvents(
+	TEXT("Slash.Combat.RangeEvents"),
+	true,
+	TEXT("If true, enemies in combat act when they cross their combat and attack radii instead of checking them every frame.\n")
+	TEXT("Read when a world starts."));
+
+static TAutoConsoleVariable<float> CVarCombatRangeHysteresis(
+	TEXT("Slash.Combat.RangeHysteresis"),
+	50,
+	TEXT("Distance past its combat or attack radius an enemy has to go to leave it."));
+
+namespace CombatRange
+{
+	/// Enemy movement after which its due check is moved up in the target's heap
+	constexpr double RequeueTravel = 25;
+	/// Stale checks allowed in a target's heap per watch before it is rebuilt
+	constexpr int32 MaxChecksPerWatch = 4;
+
+	constexpr auto DueSooner = [](const auto& A, const auto& B) { return A.DueOdometer < B.DueOdometer; };
+}
+
+bool UCombatRangeSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return Super::ShouldCreateSubsystem(Outer) && CVarCombatRangeEvents.GetValueOnGameThread();
+}
+
+void UCombatRangeSubsystem::Deinitialize()
+{
+	for (int32 WatchIndex = Watches.GetMaxIndex() - 1; WatchIndex >= 0; --WatchIndex)
+	{
+		if (Watches.IsValidIndex(WatchIndex))
+		{
+			ReleaseWatch(WatchIndex);
+		}
+	}
+	Targets.Empty();
+	Queued.Empty();
+	Super::Deinitialize();
+}
+
+ECombatRange UCombatRangeSubsystem::Watch(AEnemy* Enemy, AActor* Target, double AttackRadius, double CombatRadius)
+{
+	if (!Enemy) return ECombatRange::Outside;
+	if (const int32* ExistingIndex = WatchIndices.Find(Enemy))
+	{
+		if (Watches[*ExistingIndex].Target == TObjectKey<AActor>(Target))
+		{
+			return Watches[*ExistingIndex].Range;
+		}
+		Unwatch(Enemy);
+	}
+	USceneComponent* RootComponent = Enemy->GetRootComponent();
+	if (!Target || !RootComponent) return ECombatRange::Outside;
+
+	FRangeWatch NewWatch;
+	NewWatch.Enemy = Enemy;
+	NewWatch.Target = Target;
+	NewWatch.RootComponent = RootComponent;
+	NewWatch.AttackRadius = AttackRadius;
+	NewWatch.CombatRadius = CombatRadius;
+	// Enemies act on their range a tick after starting to watch, as they would have measuring it every frame
+	NewWatch.bNotify = true;
+	const int32 WatchIndex = Watches.Add(MoveTemp(NewWatch));
+	Watches[WatchIndex].MovedHandle = RootComponent->TransformUpdated.AddUObject(this, &UCombatRangeSubsystem::OnEnemyMoved, WatchIndex);
+	WatchIndices.Add(Enemy, WatchIndex);
+
+	FWatchedTarget* WatchedTarget = Targets.Find(Target);
+	if (!WatchedTarget)
+	{
+		WatchedTarget = &Targets.Add(Target);
+		WatchedTarget->Actor = Target;
+		WatchedTarget->LastLocation = Target->GetActorLocation();
+	}
+	WatchedTarget->WatchIndices.Add(WatchIndex);
+
+	CheckRange(WatchIndex, *WatchedTarget);
+	QueueCheck(WatchIndex);
+	return Watches[WatchIndex].Range;
+}
+
+void UCombatRangeSubsystem::Unwatch(AEnemy* Enemy)
+{
+	const int32* WatchIndexPtr = WatchIndices.Find(Enemy);
+	if (!WatchIndexPtr) return;
+	const int32 WatchIndex = *WatchIndexPtr;
+	const TObjectKey<AActor> Target = Watches[WatchIndex].Target;
+	ReleaseWatch(WatchIndex);
+
+	if (FWatchedTarget* WatchedTarget = Targets.Find(Target))
+	{
+		WatchedTarget->WatchIndices.RemoveSwap(WatchIndex, false);
+		if (WatchedTarget->WatchIndices.Num() == 0)
+		{
+			Targets.Remove(Target);
+		}
+	}
+}
+
+void UCombatRangeSubsystem::ReleaseWatch(int32 WatchIndex)
+{
+	const FRangeWatch& Watch = Watches[WatchIndex];
+	if (USceneComponent* RootComponent = Watch.RootComponent.Get())
+	{
+		RootComponent->TransformUpdated.Remove(Watch.MovedHandle);
+	}
+	WatchIndices.Remove(Watch.Enemy);
+	Watches.RemoveAt(WatchIndex);
+}
+
+void UCombatRangeSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Combat_RangeTick);
+	FRangeEvents Events;
+
+	for (auto It = Targets.CreateIterator(); It; ++It)
+	{
+		FWatchedTarget& WatchedTarget = It.Value();
+		const AActor* Target = WatchedTarget.Actor.Get();
+		if (!Target)
+		{
+			// Destroyed targets are out of range of every enemy watching them
+			for (const int32 WatchIndex : WatchedTarget.WatchIndices)
+			{
+				Events.Emplace(Watches[WatchIndex].Enemy, ECombatRange::Outside);
+				ReleaseWatch(WatchIndex);
+			}
+			It.RemoveCurrent();
+			continue;
+		}
+
+		const FVector Location = Target->GetActorLocation();
+		WatchedTarget.Odometer += FVector::Dist(Location, WatchedTarget.LastLocation);
+		WatchedTarget.LastLocation = Location;
+
+		if (WatchedTarget.Checks.Num() > CombatRange::MaxChecksPerWatch * WatchedTarget.WatchIndices.Num())
+		{
+			// Rather than keep checks moved up or replaced, check everyone again and start over
+			WatchedTarget.Checks.Reset();
+			for (const int32 WatchIndex : WatchedTarget.WatchIndices)
+			{
+				QueueCheck(WatchIndex);
+			}
+			continue;
+		}
+		while (WatchedTarget.Checks.Num() > 0 && WatchedTarget.Checks.HeapTop().DueOdometer < WatchedTarget.Odometer)
+		{
+			const FRangeCheck Check = WatchedTarget.Checks.HeapTop();
+			WatchedTarget.Checks.HeapPopDiscard(CombatRange::DueSooner, false);
+			if (Watches.IsValidIndex(Check.WatchIndex) && Watches[Check.WatchIndex].Generation == Check.Generation)
+			{
+				QueueCheck(Check.WatchIndex);
+			}
+		}
+	}
+
+	for (const int32 WatchIndex : Queued)
+	{
+		if (!Watches.IsValidIndex(WatchIndex) || !Watches[WatchIndex].bQueued) continue;
+		Watches[WatchIndex].bQueued = false;
+		FWatchedTarget* WatchedTarget = Targets.Find(Watches[WatchIndex].Target);
+		if (!WatchedTarget) continue;
+
+		if (FRangeWatch& Watch = Watches[WatchIndex]; CheckRange(WatchIndex, *WatchedTarget) || Watch.bNotify)
+		{
+			Watch.bNotify = false;
+			Events.Emplace(Watch.Enemy, Watch.Range);
+		}
+	}
+	Queued.Reset();
+
+	NumEvents += Events.Num();
+	INC_DWORD_STAT_BY(STAT_Combat_NumRangeEvents, Events.Num());
+	// Enemies may watch other targets or stop watching in response
+	for (const TPair<TObjectKey<AEnemy>, ECombatRange>& Event : Events)
+	{
+		if (AEnemy* Enemy = Event.Key.ResolveObjectPtr())
+		{
+			Enemy->OnCombatRangeChanged(Event.Value);
+		}
+	}
+	SET_DWORD_STAT(STAT_Combat_NumWatched, WatchIndices.Num());
+}
+
+bool UCombatRangeSubsystem::CheckRange(int32 WatchIndex, FWatchedTarget& WatchedTarget)
+{
+	FRangeWatch& Watch = Watches[WatchIndex];
+	const AEnemy* Enemy = Watch.Enemy.ResolveObjectPtr();
+	const AActor* Target = WatchedTarget.Actor.Get();
+	if (!Enemy || !Target) return false;
+
+	++NumChecks;
+	INC_DWORD_STAT(STAT_Combat_NumRangeChecks);
+	const FVector Location = Enemy->GetActorLocation();
+	const double Distance = FVector::Dist(Location, Target->GetActorLocation());
+	const double Hysteresis = FMath::Max(CVarCombatRangeHysteresis.GetValueOnGameThread(), 0.f);
+	const double AttackExit = Watch.AttackRadius + Hysteresis;
+	const double CombatExit = Watch.CombatRadius + Hysteresis;
+
+	// Slack is how far the distance can change before it reaches a radius that would change the range
+	const ECombatRange OldRange = Watch.Range;
+	if (Distance <= Watch.AttackRadius || (OldRange == ECombatRange::Attack && Distance <= AttackExit))
+	{
+		Watch.Range = ECombatRange::Attack;
+		Watch.Slack = AttackExit - Distance;
+	}
+	else if (Distance <= Watch.CombatRadius || (OldRange != ECombatRange::Outside && Distance <= CombatExit))
+	{
+		Watch.Range = ECombatRange::Combat;
+		Watch.Slack = FMath::Min(Distance - Watch.AttackRadius, CombatExit - Distance);
+	}
+	else
+	{
+		Watch.Range = ECombatRange::Outside;
+		Watch.Slack = Distance - Watch.CombatRadius;
+	}
+
+	Watch.CheckedLocation = Location;
+	Watch.CheckedOdometer = WatchedTarget.Odometer;
+	Watch.RequeuedTravel = 0;
+	PushCheck(WatchedTarget, WatchIndex, WatchedTarget.Odometer + Watch.Slack);
+	return Watch.Range != OldRange;
+}
+
+void UCombatRangeSubsystem::QueueCheck(int32 WatchIndex)
+{
+	if (FRangeWatch& Watch = Watches[WatchIndex]; !Watch.bQueued)
+	{
+		Watch.bQueued = true;
+		Queued.Add(WatchIndex);
+	}
+}
+
+void UCombatRangeSubsystem::PushCheck(FWatchedTarget& WatchedTarget, int32 WatchIndex, double DueOdometer)
+{
+	const uint32 Generation = ++NextGeneration;
+	Watches[WatchIndex].Generation = Generation;
+	WatchedTarget.Checks.HeapPush({ DueOdometer, WatchIndex, Generation }, CombatRange::DueSooner);
+}
+
+void UCombatRangeSubsystem::OnEnemyMoved(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport, int32 WatchIndex)
+{
+	if (!Watches.IsValidIndex(WatchIndex) || Watches[WatchIndex].bQueued) return;
+	FRangeWatch& Watch = Watches[WatchIndex];
+	FWatchedTarget* WatchedTarget = Targets.Find(Watch.Target);
+	if (!WatchedTarget) return;
+
+	// Distance to the target can't have changed by more than both of them moved
+	const double Travel = FVector::Dist(Component->GetComponentLocation(), Watch.CheckedLocation);
+	const double RemainingSlack = Watch.Slack - Travel - (WatchedTarget->Odometer - Watch.CheckedOdometer);
+	if (RemainingSlack < 0)
+	{
+		QueueCheck(WatchIndex);
+	}
+	else if (Travel - Watch.RequeuedTravel >= CombatRange::RequeueTravel)
+	{
+		// Less of the slack is left for the target to use up
+		Watch.RequeuedTravel = Travel;
+		PushCheck(*WatchedTarget, WatchIndex, WatchedTarget->Odometer + RemainingSlack);
+	}
+}
+
+TStatId UCombatRangeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatRangeSubsystem, STATGROUP_Tickables);
+}
+
+bool UCombatRangeSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
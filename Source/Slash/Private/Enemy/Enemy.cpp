@@ -6,18 +6,33 @@
 #include "AIController.h"
 #include "Character/CharacterTypes.h"
 #include "Components/AttributeComponent.h"
+#include "Debug/BenchmarkTimers.h"
+#include "Debug/SlashStats.h"
+#include "Enemy/CombatCoordinatorSubsystem.h"
+#include "Enemy/CombatRangeSubsystem.h"
+#include "Enemy/EnemyAISubsystem.h"
+#include "Enemy/EnemyPerceptionSubsystem.h"
+#include "Enemy/EnemyStateTree.h"
+#include "Enemy/PatrolRoute.h"
+#include "Enemy/PursuitFieldSubsystem.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "HUD/HealthBarComponent.h"
+#include "HUD/HealthBarSubsystem.h"
 #include "Items/Soul.h"
 #include "Items/Weapon/Weapon.h"
 #include "Kismet/GameplayStatics.h"
 #include "Navigation/PathFollowingComponent.h"
-#include "Perception/PawnSensingComponent.h"
+#include "Pooling/ActorPoolSubsystem.h"
+#include "Replay/CombatReplaySubsystem.h"
+#include "Scheduling/GameplaySchedulerSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Per-Actor AI Tick"), STAT_EnemyAI_ActorTick, STATGROUP_SlashEnemyAI);
 
 AEnemy::AEnemy()
 {
 	PrimaryActorTick.bCanEverTick = true;
 
+	CombatIdentity.Faction = ECombatFaction::Enemy;
+
 	// Enemy mesh should be WorldDynamic to have collision with player weapons
 	GetMesh()->SetCollisionObjectType(ECC_WorldDynamic);
 
@@ -31,10 +46,6 @@ AEnemy::AEnemy()
 		GetMesh()->SetRelativeLocation(FVector(0, 0, -90));
 	}
 
-	HealthBar = CreateDefaultSubobject<UHealthBarComponent>("HealthBar");
-	HealthBar->SetupAttachment(GetRootComponent());
-	HealthBar->SetWidgetSpace(EWidgetSpace::Screen);
-
 	// Limit walk speed to be slower than character
 	GetCharacterMovement()->MaxWalkSpeed = 150; // Default to walking speed only
 	GetCharacterMovement()->bOrientRotationToMovement = true;
@@ -42,25 +53,86 @@ AEnemy::AEnemy()
 	bUseControllerRotationPitch = false;
 	bUseControllerRotationRoll = false;
 
-	// Pawn sensing
-	PawnSensingComponent = CreateDefaultSubobject<UPawnSensingComponent>("PawnSensingComponent");
-	PawnSensingComponent->SightRadius = 4000;
-	PawnSensingComponent->SetPeripheralVisionAngle(45);
-	PawnSensingComponent->bOnlySensePlayers = false;
+	AILOD = EEnemyAILOD::Full;
+	CombatRange = ECombatRange::Outside;
+	// Enemies spawned by the spawn director need an AI controller too
+	AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
 
 	// Default soul
 	SoulClass = ASoul::StaticClass();
 }
 
+FEnemyStateTree AEnemy::MakeStateTree()
+{
+	FEnemyStateTree Tree(TEXT("Enemy"));
+	constexpr int32 Root = FEnemyStateTree::Root;
+
+	const int32 Alive = Tree.AddBranch(TEXT("Alive"), Root);
+	const int32 Idle = Tree.AddBranch(TEXT("Idle"), Alive, nullptr, &AEnemy::ClearPatrolTimer);
+	const int32 Patrolling = Tree.AddState(EEnemyState::Patrolling, Idle, &AEnemy::StartPatrolling);
+	// Attack tokens are only held while attacking, and places in line while waiting
+	const int32 Combat = Tree.AddBranch(TEXT("Combat"), Alive, nullptr, &AEnemy::ReleaseAttackToken);
+	Tree.AddState(EEnemyState::NoState, Combat, &AEnemy::ReleaseAttackToken);
+	Tree.AddState(EEnemyState::Chasing, Combat, &AEnemy::ChaseTarget, &AEnemy::StopPursuit);
+	const int32 Attacking = Tree.AddState(EEnemyState::Attacking, Combat, &AEnemy::StartAttackTimer, &AEnemy::ClearAttackTimer);
+	const int32 Engaged = Tree.AddState(EEnemyState::Engaged, Combat, &AEnemy::PlayAttackMontage);
+	const int32 Waiting = Tree.AddState(EEnemyState::Waiting, Combat, &AEnemy::WaitForAttackToken, &AEnemy::ClearWaitTimer);
+	Tree.AddState(EEnemyState::Dead, Root, &AEnemy::BeginDeath);
+	Tree.SetCombatBranch(Combat);
+
+	Tree.AddTransition(Alive, EEnemyEvent::Died, nullptr, nullptr, EEnemyState::Dead);
+	// Hits restart the attack, or the chase, on whoever dealt them
+	Tree.AddTransition(Alive, EEnemyEvent::Damaged, &AEnemy::TakeAttackToken, &AEnemy::InterruptAttack, EEnemyState::Attacking, true);
+	Tree.AddTransition(Alive, EEnemyEvent::Damaged, &AEnemy::IsInAttackRadius, &AEnemy::InterruptAttack, EEnemyState::Waiting, true);
+	Tree.AddTransition(Alive, EEnemyEvent::Damaged, nullptr, &AEnemy::InterruptAttack, EEnemyState::Chasing, true);
+	// No longer in a position to attack, pass the token on
+	Tree.AddTransition(Alive, EEnemyEvent::AttackTokenGranted, nullptr, &AEnemy::ReleaseAttackToken, {});
+
+	Tree.AddTransition(Idle, EEnemyEvent::PawnSeen, &AEnemy::IsSeenPawnEngageable, &AEnemy::EngageSeenPawn, EEnemyState::Chasing);
+	Tree.AddTransition(Patrolling, EEnemyEvent::PatrolGoalReached, nullptr, &AEnemy::SelectNextPatrolTarget, {});
+
+	Tree.AddTransition(Combat, EEnemyEvent::RangeChanged, &AEnemy::IsOutsideCombatRadius, &AEnemy::LoseInterest, EEnemyState::Patrolling);
+	Tree.AddTransition(Combat, EEnemyEvent::RangeChanged, &AEnemy::IsOutsideAttackRadius, nullptr, EEnemyState::Chasing);
+	Tree.AddTransition(Combat, EEnemyEvent::RangeChanged, &AEnemy::TakeAttackToken, nullptr, EEnemyState::Attacking);
+	Tree.AddTransition(Combat, EEnemyEvent::RangeChanged, nullptr, nullptr, EEnemyState::Waiting);
+
+	Tree.AddTransition(Attacking, EEnemyEvent::AttackTimerFinished, &AEnemy::HasCombatTarget, nullptr, EEnemyState::Engaged);
+	Tree.AddTransition(Attacking, EEnemyEvent::AttackTimerFinished, nullptr, &AEnemy::LoseInterest, EEnemyState::Patrolling);
+	Tree.AddTransition(Waiting, EEnemyEvent::AttackTokenGranted, &AEnemy::IsInAttackRadius, &AEnemy::StopMovement, EEnemyState::Attacking);
+
+	// Swings are finished before acting on the range, though the target can still be lost meanwhile
+	Tree.AddTransition(Engaged, EEnemyEvent::RangeChanged, &AEnemy::IsOutsideCombatRadius, &AEnemy::LoseInterest, {});
+	Tree.AddTransition(Engaged, EEnemyEvent::RangeChanged, nullptr, nullptr, {});
+	Tree.AddTransition(Engaged, EEnemyEvent::AttackEnded, nullptr, nullptr, EEnemyState::NoState);
+	return Tree;
+}
+
+const FEnemyStateTree& AEnemy::GetStateTree() const
+{
+	static const FEnemyStateTree StateTree = MakeStateTree();
+	return StateTree;
+}
+
+void AEnemy::SendStateTreeEvent(EEnemyEvent Event)
+{
+	GetStateTree().SendEvent(*this, Event);
+}
+
 
 void AEnemy::Tick(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAI_ActorTick);
+	SCOPE_BENCHMARK_TIMER(EnemyTick);
 	Super::Tick(DeltaTime);
-	if (IsDead()) return;
-	if (EnemyState > EEnemyState::Patrolling)
+	// Only ticks when batched AI is disabled, see UEnemyAISubsystem
+	if (IsDead() || AILOD == EEnemyAILOD::Dormant) return;
+	if (IsInCombat())
 	{
-		// Escalated enough to check combat target
-		CheckCombatTarget();
+		// Range to the combat target is measured every frame, unless told when it changes
+		if (!CombatRangeSubsystem)
+		{
+			SendStateTreeEvent(EEnemyEvent::RangeChanged);
+		}
 	}
 	else
 	{
@@ -70,31 +142,24 @@ void AEnemy::Tick(float DeltaTime)
 
 void AEnemy::GetHit_Implementation(const FVector& ImpactPoint, AActor* Hitter)
 {
+	// Reacting to the hit is left to the Damaged event, sent from TakeDamage first
 	Super::GetHit_Implementation(ImpactPoint, Hitter);
 	ShowHealthBar();
-	ClearPatrolTimer();
-	ClearAttackTimer();
-	if (IsEngaged())
-	{
-		StopAttackMontage();
-	}
-	if (IsInAttackRadius() && !IsDead())
-	{
-		StartAttackTimer();
-	}
 }
 
 float AEnemy::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
-	HandleDamage(DamageAmount);
-	CombatTarget = EventInstigator->GetPawn();
-	if (IsInAttackRadius())
+	if (EnemyAISubsystem)
 	{
-		EnemyState = EEnemyState::Attacking;
-	} else
+		EnemyAISubsystem->WakeEnemy(this);
+	}
+	HandleDamage(DamageAmount);
+	// Queued hits can outlive the controller that dealt them
+	if (EventInstigator)
 	{
-		ChaseTarget();
+		SetCombatTarget(EventInstigator->GetPawn());
 	}
+	SendStateTreeEvent(EEnemyEvent::Damaged);
 	return DamageAmount;
 }
 
@@ -106,12 +171,13 @@ void AEnemy::BeginPlay()
 
 	HideHealthBar();
 	AIController = Cast<AAIController>(GetController());
-	MoveToTarget(PatrolTarget);
-
-	if (PawnSensingComponent)
+	if (PatrolRoute)
 	{
-		PawnSensingComponent->OnSeePawn.AddDynamic(this, &AEnemy::OnPawnSeen);
+		// Join the route at the closest waypoint
+		SetPatrolWaypoint(PatrolRoute->GetClosestWaypoint(GetActorLocation()));
 	}
+	RegisterWithSubsystems();
+	MoveToPatrolGoal();
 
 	if (Attributes)
 	{
@@ -120,45 +186,192 @@ void AEnemy::BeginPlay()
 	}
 
 	SpawnDefaultWeapon();
+
+	if (UActorPoolSubsystem* ActorPool = GetWorld()->GetSubsystem<UActorPoolSubsystem>())
+	{
+		ActorPool->Prewarm(SoulClass, SoulPrewarmCount);
+	}
+}
+
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterFromSubsystems();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AEnemy::RegisterWithSubsystems()
+{
+	UWorld* World = GetWorld();
+	if (!World) return;
+	Scheduler = World->GetSubsystem<UGameplaySchedulerSubsystem>();
+	PursuitSubsystem = World->GetSubsystem<UPursuitFieldSubsystem>();
+	CombatCoordinator = World->GetSubsystem<UCombatCoordinatorSubsystem>();
+	CombatRangeSubsystem = World->GetSubsystem<UCombatRangeSubsystem>();
+	HealthBars = World->GetSubsystem<UHealthBarSubsystem>();
+	if ((EnemyAISubsystem = World->GetSubsystem<UEnemyAISubsystem>()))
+	{
+		EnemyAISubsystem->RegisterEnemy(this);
+	}
+	if ((PerceptionSubsystem = World->GetSubsystem<UEnemyPerceptionSubsystem>()))
+	{
+		PerceptionSubsystem->RegisterSensor(this, SightRadius, PeripheralVisionAngle, SensingInterval,
+			FOnPerceptionChanged::CreateUObject(this, &AEnemy::OnPerceptionChanged));
+	}
+}
+
+template <void (AEnemy::*Function)()>
+void AEnemy::SetEnemyTimer(FScheduledTimerHandle& Handle, FTimerHandle& FallbackHandle, float Delay)
+{
+	if (Scheduler)
+	{
+		Scheduler->SetTimer<AEnemy, Function>(Handle, this, Delay);
+	}
+	else
+	{
+		// The timer manager clears timers set with no delay instead of firing them
+		GetWorldTimerManager().SetTimer(FallbackHandle, this, Function, FMath::Max(Delay, UE_KINDA_SMALL_NUMBER));
+	}
+}
+
+void AEnemy::ClearEnemyTimer(FScheduledTimerHandle& Handle, FTimerHandle& FallbackHandle)
+{
+	if (Scheduler)
+	{
+		Scheduler->ClearTimer(Handle);
+	}
+	GetWorldTimerManager().ClearTimer(FallbackHandle);
+}
+
+void AEnemy::UnregisterFromSubsystems()
+{
+	ClearAttackTimer();
+	ClearPatrolTimer();
+	ClearWaitTimer();
+	if (Scheduler)
+	{
+		Scheduler->ClearTimer(DeathTimer);
+	}
+	if (CombatCoordinator)
+	{
+		CombatCoordinator->ReleaseAttackToken(this);
+	}
+	if (CombatRangeSubsystem)
+	{
+		CombatRangeSubsystem->Unwatch(this);
+	}
+	if (EnemyAISubsystem)
+	{
+		EnemyAISubsystem->UnregisterEnemy(this);
+	}
+	if (PerceptionSubsystem)
+	{
+		PerceptionSubsystem->UnregisterSensor(this);
+	}
+	if (PursuitSubsystem)
+	{
+		PursuitSubsystem->StopPursuit(this);
+	}
+	if (HealthBars)
+	{
+		HealthBars->HideHealthBar(this);
+	}
+}
+
+void AEnemy::OnAcquiredFromPool()
+{
+	ResetCharacter();
+	GetCharacterMovement()->MaxWalkSpeed = PatrollingSpeed;
+	if (Attributes)
+	{
+		Attributes->AddSouls(FMath::RandRange(1, 10));
+	}
+	HideHealthBar();
+	if (EquippedWeapon)
+	{
+		EquippedWeapon->SetActorHiddenInGame(false);
+	}
+
+	AIController = Cast<AAIController>(GetController());
+	PreviousPatrolWaypoint = INDEX_NONE;
+	PatrolWaypoint = PatrolRoute ? PatrolRoute->GetClosestWaypoint(GetActorLocation()) : INDEX_NONE;
+	// Back in the spatial hash first, perception only takes sensors it can find there
+	RegisterInSpatialHash();
+	RegisterWithSubsystems();
+	// Through SetEnemyState once registered, so the AI batch and replay see the reset too
+	SetEnemyState(EEnemyState::Patrolling);
+	ApplyAILOD(EEnemyAILOD::Full);
+	MoveToPatrolGoal();
+}
+
+void AEnemy::RestoreAmbientState(APatrolRoute* Route, int32 Waypoint, float Health, int32 Souls)
+{
+	if (Attributes)
+	{
+		Attributes->SetHealth(Health);
+		Attributes->AddSouls(Souls - Attributes->GetSouls());
+	}
+	PatrolRoute = Route;
+	PreviousPatrolWaypoint = INDEX_NONE;
+	SetPatrolWaypoint(Route && Route->IsValidWaypoint(Waypoint) ? Waypoint : INDEX_NONE);
+	if (EnemyState == EEnemyState::Patrolling)
+	{
+		ClearPatrolTimer();
+		MoveToPatrolGoal();
+	}
+}
+
+void AEnemy::OnReleasedToPool()
+{
+	// Dormant stops movement, path following and animation until acquired again
+	ApplyAILOD(EEnemyAILOD::Dormant);
+	UnregisterFromSubsystems();
+	UnregisterFromSpatialHash();
+	SetWeaponCollision(ECollisionEnabled::NoCollision);
+	if (EquippedWeapon)
+	{
+		EquippedWeapon->SetActorHiddenInGame(true);
+	}
+	HideHealthBar();
+	CombatTarget = nullptr;
 }
 
 void AEnemy::SpawnDefaultWeapon()
 {
 	if (UWorld* World = GetWorld(); World && WeaponClass)
 	{
-		AWeapon* DefaultWeapon = World->SpawnActor<AWeapon>(WeaponClass);
+		AWeapon* DefaultWeapon = UActorPoolSubsystem::AcquireActor<AWeapon>(World, WeaponClass, GetActorTransform(), this, this);
+		if (!DefaultWeapon) return;
 		DefaultWeapon->Equip(GetMesh(), PrimaryWeaponSocketName, this, this);
 		EquippedWeapon = DefaultWeapon;
 	}
 }
 
-bool AEnemy::CanAttack()
-{
-	return IsInAttackRadius() && !IsAttacking() && !IsEngaged() && !IsDead();
-}
-
 void AEnemy::Attack()
 {
 	Super::Attack();
-	if (!CombatTarget) return;
-	EnemyState = EEnemyState::Engaged;
-	PlayAttackMontage();
+	if (!CombatTarget)
+	{
+		// Dead combat targets are dropped when attacking
+		SetCombatTarget(nullptr);
+	}
+	SendStateTreeEvent(EEnemyEvent::AttackTimerFinished);
 }
 
 void AEnemy::AttackEnd()
 {
 	Super::AttackEnd();
-	EnemyState = EEnemyState::NoState;
-	CheckCombatTarget();
+	SendStateTreeEvent(EEnemyEvent::AttackEnded);
+	// Decide what to do next from where the combat target is now
+	SendStateTreeEvent(EEnemyEvent::RangeChanged);
 }
 
 void AEnemy::HandleDamage(float DamageAmount)
 {
 	Super::HandleDamage(DamageAmount);
 
-	if (Attributes && HealthBar)
+	if (Attributes && HealthBars)
 	{
-		HealthBar->SetHealthPercent(Attributes->GetHealthPercent());
+		HealthBars->SetHealthPercent(this, Attributes->GetHealthPercent());
 	}
 }
 
@@ -166,11 +379,10 @@ void AEnemy::SpawnSoul()
 {
 	if (UWorld* World = GetWorld(); World && SoulClass)
 	{
-		if (ASoul* Soul = Cast<ASoul>(UGameplayStatics::BeginDeferredActorSpawnFromClass(World, SoulClass, GetActorTransform())))
+		if (ASoul* Soul = UActorPoolSubsystem::AcquireActor<ASoul>(World, SoulClass, GetActorTransform()))
 		{
 			// Drop all souls
 			Soul->SetSouls(Attributes->GetSouls());
-			UGameplayStatics::FinishSpawningActor(Soul, GetActorTransform());
 		}
 	}
 }
@@ -178,41 +390,59 @@ void AEnemy::SpawnSoul()
 void AEnemy::Die()
 {
 	Super::Die();
-	EnemyState = EEnemyState::Dead;
-	ClearAttackTimer();
+	SendStateTreeEvent(EEnemyEvent::Died);
+}
+
+void AEnemy::BeginDeath()
+{
 	HideHealthBar();
-	SetLifeSpan(DeathLifeSpan);
+	if (CombatRangeSubsystem)
+	{
+		CombatRangeSubsystem->Unwatch(this);
+	}
+	if (Scheduler)
+	{
+		Scheduler->SetTimer<AEnemy, &AEnemy::DeathTimerFinished>(DeathTimer, this, DeathLifeSpan);
+	}
+	else
+	{
+		SetLifeSpan(DeathLifeSpan);
+	}
 	SpawnSoul();
 }
 
+void AEnemy::DeathTimerFinished()
+{
+	UActorPoolSubsystem::ReleaseActor(this);
+}
+
 void AEnemy::Destroyed()
 {
 	Super::Destroyed();
 	if (EquippedWeapon)
 	{
-		EquippedWeapon->Destroy();
+		UActorPoolSubsystem::ReleaseActor(EquippedWeapon);
 	}
 }
 
-void AEnemy::OnPawnSeen(APawn* Pawn)
+void AEnemy::OnPerceptionChanged(APawn* Pawn, bool bSeen)
 {
-	const bool bShouldChaseTarget =
-		EnemyState != EEnemyState::Dead
-		&& EnemyState != EEnemyState::Chasing
-		&& EnemyState < EEnemyState::Chasing
-		&& Pawn->ActorHasTag(EngageableActorTagName);
-
-	if (bShouldChaseTarget)
+	if (bSeen)
 	{
-		CombatTarget = Pawn;
-		ClearPatrolTimer();
-		ChaseTarget();
+		OnPawnSeen(Pawn);
 	}
 }
 
+void AEnemy::OnPawnSeen(APawn* Pawn)
+{
+	SeenPawn = Pawn;
+	SendStateTreeEvent(EEnemyEvent::PawnSeen);
+	SeenPawn = nullptr;
+}
+
 bool AEnemy::InTargetRange(TObjectPtr<AActor> Target, double Radius)
 {
-	return Target && (Target->GetActorLocation() - GetActorLocation()).Size() <= Radius;
+	return Target && FVector::DistSquared(Target->GetActorLocation(), GetActorLocation()) <= FMath::Square(Radius);
 }
 
 void AEnemy::MoveToTarget(TObjectPtr<AActor> Target)
@@ -224,109 +454,322 @@ void AEnemy::MoveToTarget(TObjectPtr<AActor> Target)
 	AIController->MoveTo(MoveRequest);
 }
 
-void AEnemy::CheckCombatTarget()
+void AEnemy::MoveToPatrolGoal()
 {
-	// Outside combat radius
-	if (IsOutsideCombatRadius())
+	if (!PatrolRoute)
+	{
+		MoveToTarget(PatrolTarget);
+		return;
+	}
+	if (!AIController || !PatrolRoute->IsValidWaypoint(PatrolWaypoint)) return;
+
+	FAIMoveRequest MoveRequest(PatrolRoute->GetWaypointLocation(PatrolWaypoint));
+	MoveRequest.SetAcceptanceRadius(AcceptanceRadius);
+	// Follow the route's baked path when still at the start of the leg, e.g. not coming back from a chase
+	if (PatrolRoute->IsValidWaypoint(PreviousPatrolWaypoint)
+		&& FVector::DistSquared(GetActorLocation(), PatrolRoute->GetWaypointLocation(PreviousPatrolWaypoint)) <= FMath::Square(PatrolRadius))
 	{
-		ClearAttackTimer();
-		LoseInterest();
-		if (!IsEngaged())
+		if (const FNavPathSharedPtr Path = PatrolRoute->MakeLegPath(PreviousPatrolWaypoint, PatrolWaypoint))
 		{
-			StartPatrolling();
+			AIController->RequestMove(MoveRequest, Path);
+			return;
 		}
 	}
-	else if (!IsInAttackRadius() && !IsChasing())
+	AIController->MoveTo(MoveRequest);
+}
+
+void AEnemy::CheckPatrolTarget()
+{
+	ApplyAIDecision(EvaluatePatrolDecision());
+}
+
+EEnemyAIDecision AEnemy::EvaluatePatrolDecision()
+{
+	// When within range of patrol target, switch targets
+	if (EnemyState != EEnemyState::Patrolling) return EEnemyAIDecision::None;
+	if (const TOptional<FVector> Goal = GetPatrolGoal();
+		Goal && FVector::DistSquared(*Goal, GetActorLocation()) <= FMath::Square(PatrolRadius))
+	{
+		return EEnemyAIDecision::NextPatrolTarget;
+	}
+	return EEnemyAIDecision::None;
+}
+
+void AEnemy::ApplyAIDecision(EEnemyAIDecision Decision)
+{
+	switch (Decision)
 	{
-		ClearAttackTimer();
-		if (!IsEngaged())
+	case EEnemyAIDecision::LoseInterest:
+	case EEnemyAIDecision::Chase:
+	case EEnemyAIDecision::Attack:
+		// What to do about the range is up to the state tree
+		SendStateTreeEvent(EEnemyEvent::RangeChanged);
+		break;
+	case EEnemyAIDecision::NextPatrolTarget:
+		SendStateTreeEvent(EEnemyEvent::PatrolGoalReached);
+		break;
+	default:
+		break;
+	}
+}
+
+void AEnemy::ApplyAILOD(EEnemyAILOD LOD)
+{
+	if (LOD == AILOD) return;
+	const bool bWasDormant = AILOD == EEnemyAILOD::Dormant;
+	const bool bDormant = LOD == EEnemyAILOD::Dormant;
+	AILOD = LOD;
+
+	// Dormant enemies stop moving, sensing and animating entirely
+	GetCharacterMovement()->SetComponentTickEnabled(!bDormant);
+	GetMesh()->bPauseAnims = bDormant;
+	GetMesh()->SetComponentTickEnabled(!bDormant);
+	// Montages keep ticking off screen so notifies such as AttackEnd still fire
+	GetMesh()->VisibilityBasedAnimTickOption = LOD == EEnemyAILOD::Full
+		? EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones
+		: EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+
+	if (PerceptionSubsystem)
+	{
+		PerceptionSubsystem->SetSensorEnabled(this, !bDormant);
+		PerceptionSubsystem->SetSensingInterval(this, LOD == EEnemyAILOD::Full
+			? SensingInterval
+			: SensingInterval * ReducedSensingIntervalScale);
+	}
+
+	if (AIController)
+	{
+		if (bDormant)
 		{
-			ChaseTarget();
+			AIController->StopMovement();
+		}
+		if (UPathFollowingComponent* PathFollowing = AIController->GetPathFollowingComponent())
+		{
+			PathFollowing->SetComponentTickEnabled(!bDormant);
 		}
 	}
-	else if (CanAttack())
+	if (bWasDormant && EnemyState == EEnemyState::Patrolling)
 	{
-		// Inside attack range, attack target
-		StartAttackTimer();
+		// Pick up the patrol where it was left
+		MoveToPatrolGoal();
 	}
+
+	// Only matters when decisions are made by this enemy's own tick
+	SetActorTickInterval(LOD == EEnemyAILOD::Reduced ? ReducedTickInterval : 0);
 }
 
-void AEnemy::CheckPatrolTarget()
+void AEnemy::SelectNextPatrolTarget()
 {
-	if (EnemyState != EEnemyState::Patrolling) return;
-	// Patrol between targets
-	// When within range of patrol target, switch targets
-	if (AIController && (InTargetRange(PatrolTarget, PatrolRadius)))
+	if (!AIController) return;
+	if (PatrolRoute)
+	{
+		if (PatrolRoute->GetNumWaypoints() > 1)
+		{
+			PreviousPatrolWaypoint = PatrolWaypoint;
+			SetPatrolWaypoint(PatrolRoute->GetNextWaypoint(PatrolWaypoint));
+			const float RandomDelay = FMath::RandRange(PatrolWaitMin, PatrolWaitMax);
+			StartPatrolTimer(RandomDelay);
+		}
+		return;
+	}
+	// Patrol between targets, picking at random from every target except the current one
+	// without building a temporary array of valid targets
+	int32 NumTargets = 0;
+	for (const TObjectPtr<AActor>& Target : PatrolTargets)
 	{
-		TArray<TObjectPtr<AActor>> ValidTargets;
-		for (auto Target : PatrolTargets)
+		NumTargets += Target != PatrolTarget;
+	}
+	if (NumTargets > 0)
+	{
+		int32 Selection = FMath::RandRange(0, NumTargets - 1);
+		for (const TObjectPtr<AActor>& Target : PatrolTargets)
 		{
-			if (Target != PatrolTarget)
+			if (Target != PatrolTarget && Selection-- == 0)
 			{
-				ValidTargets.Add(Target);
+				SetPatrolTarget(Target);
+				break;
 			}
 		}
+		// Add delay for patrolling
+		const int32 RandomDelay = FMath::RandRange(PatrolWaitMin, PatrolWaitMax);
+		StartPatrolTimer(RandomDelay);
+	}
+}
 
-		const int32 NumTargets = ValidTargets.Num();
-		if (NumTargets > 0)
-		{
-			const int32 Selection = FMath::RandRange(0, NumTargets - 1);
-			PatrolTarget = ValidTargets[Selection];
-			// Add delay for patrolling
-			const int32 RandomDelay = FMath::RandRange(PatrolWaitMin, PatrolWaitMax);
-			GetWorldTimerManager().SetTimer(PatrolTimer, this, &AEnemy::PatrolTimerFinished, RandomDelay);
-		}
+void AEnemy::OnAttackTokenGranted()
+{
+	SendStateTreeEvent(EEnemyEvent::AttackTokenGranted);
+}
+
+void AEnemy::OnCombatRangeChanged(ECombatRange Range)
+{
+	CombatRange = Range;
+	SendStateTreeEvent(EEnemyEvent::RangeChanged);
+}
+
+bool AEnemy::IsOutsideAttackRadius()
+{
+	return !IsInAttackRadius();
+}
+
+bool AEnemy::HasCombatTarget()
+{
+	return CombatTarget != nullptr;
+}
+
+bool AEnemy::IsSeenPawnEngageable()
+{
+	return SeenPawn && IdentityOf(SeenPawn).IsEngageable();
+}
+
+bool AEnemy::TakeAttackToken()
+{
+	return IsInAttackRadius() && (!CombatCoordinator || CombatCoordinator->RequestAttackToken(this, CombatTarget));
+}
+
+void AEnemy::EngageSeenPawn()
+{
+	SetCombatTarget(SeenPawn);
+}
+
+void AEnemy::InterruptAttack()
+{
+	if (IsEngaged())
+	{
+		StopAttackMontage();
+	}
+}
+
+void AEnemy::ReleaseAttackToken()
+{
+	if (CombatCoordinator)
+	{
+		CombatCoordinator->ReleaseAttackToken(this);
+	}
+}
+
+void AEnemy::StopPursuit()
+{
+	if (PursuitSubsystem)
+	{
+		PursuitSubsystem->StopPursuit(this);
+	}
+}
+
+void AEnemy::StopMovement()
+{
+	if (AIController)
+	{
+		AIController->StopMovement();
 	}
 }
 
+void AEnemy::WaitForAttackToken()
+{
+	GetCharacterMovement()->MaxWalkSpeed = PatrollingSpeed;
+	CircleCombatTarget();
+}
+
+void AEnemy::CircleCombatTarget()
+{
+	if (!IsWaiting() || !CombatTarget || !AIController) return;
+	// Stay inside the attack radius so waiting isn't cut short by chasing
+	const FVector TargetLocation = CombatTarget->GetActorLocation();
+	const FVector FromTarget = (GetActorLocation() - TargetLocation).GetSafeNormal2D();
+	const FVector Spot = TargetLocation
+		+ FromTarget.RotateAngleAxis(FMath::RandRange(-WaitingStepAngle, WaitingStepAngle), FVector::UpVector) * AttackRadius * WaitingRadiusScale;
+	FAIMoveRequest MoveRequest(Spot);
+	MoveRequest.SetAcceptanceRadius(AcceptanceRadius);
+	AIController->MoveTo(MoveRequest);
+	SetEnemyTimer<&AEnemy::CircleCombatTarget>(WaitTimer, WaitFallbackTimer, FMath::RandRange(WaitingStepMin, WaitingStepMax));
+}
+
 void AEnemy::HideHealthBar()
 {
-	if (HealthBar)
+	if (HealthBars)
 	{
-		HealthBar->SetVisibility(false);
+		HealthBars->HideHealthBar(this);
 	}
 }
 
 void AEnemy::ShowHealthBar()
 {
-	if (!IsDead() && HealthBar)
+	if (!IsDead() && HealthBars && Attributes)
 	{
-		HealthBar->SetVisibility(true);
+		HealthBars->ShowHealthBar(this, Attributes->GetHealthPercent());
 	}
 }
 
 void AEnemy::LoseInterest()
 {
-	CombatTarget = nullptr;
+	if (PerceptionSubsystem)
+	{
+		// Report the target as newly seen again if it is still in sight, so it can be chased again
+		PerceptionSubsystem->ForgetPawn(this, Cast<APawn>(CombatTarget));
+	}
+	SetCombatTarget(nullptr);
 	HideHealthBar();
 }
 
 void AEnemy::StartPatrolling()
 {
-	EnemyState = EEnemyState::Patrolling;
 	GetCharacterMovement()->MaxWalkSpeed = PatrollingSpeed;
 	// Go back to patrolling after small delay
-	GetWorldTimerManager().SetTimer(PatrolTimer, this, &AEnemy::PatrolTimerFinished, 1);
+	StartPatrolTimer(1);
 }
 
 void AEnemy::ChaseTarget()
 {
 	// Outside attack range but within combat radius, start chasing
-	EnemyState = EEnemyState::Chasing;
+	ReleaseAttackToken();
 	GetCharacterMovement()->MaxWalkSpeed = ChasingSpeed;
-	MoveToTarget(CombatTarget);
+	if (PursuitSubsystem && PursuitSubsystem->StartPursuit(this, CombatTarget))
+	{
+		// Steered by the target's shared flow field
+		SetPursuitSteering(true);
+	}
+	else
+	{
+		MoveToTarget(CombatTarget);
+	}
+}
+
+void AEnemy::SetPursuitSteering(bool bSteeredByField)
+{
+	if (!AIController) return;
+	if (bSteeredByField)
+	{
+		AIController->StopMovement();
+	}
+	else if (IsChasing())
+	{
+		MoveToTarget(CombatTarget);
+	}
 }
 
 bool AEnemy::IsOutsideCombatRadius()
 {
+	if (CombatRangeSubsystem)
+	{
+		return !CombatTarget || CombatRange == ECombatRange::Outside;
+	}
 	return !InTargetRange(CombatTarget, CombatRadius);
 }
 
 bool AEnemy::IsInAttackRadius()
 {
+	if (CombatRangeSubsystem)
+	{
+		return CombatTarget && CombatRange == ECombatRange::Attack;
+	}
 	return InTargetRange(CombatTarget, AttackRadius);
 }
 
+bool AEnemy::IsInCombat() const
+{
+	return GetStateTree().IsInCombat(EnemyState);
+}
+
 bool AEnemy::IsChasing()
 {
 	return EnemyState == EEnemyState::Chasing;
@@ -347,24 +790,125 @@ bool AEnemy::IsEngaged()
 	return EnemyState == EEnemyState::Engaged;
 }
 
+bool AEnemy::IsWaiting()
+{
+	return EnemyState == EEnemyState::Waiting;
+}
+
 void AEnemy::ClearPatrolTimer()
 {
-	GetWorldTimerManager().ClearTimer(PatrolTimer);
+	ClearEnemyTimer(PatrolTimer, PatrolFallbackTimer);
+}
+
+void AEnemy::StartPatrolTimer(float Delay)
+{
+	SetEnemyTimer<&AEnemy::PatrolTimerFinished>(PatrolTimer, PatrolFallbackTimer, Delay);
 }
 
 void AEnemy::StartAttackTimer()
 {
-	EnemyState = EEnemyState::Attacking;
-	const float AttackTime = FMath::RandRange(AttackMin, AttackMax);
-	GetWorldTimerManager().SetTimer(AttackTimer, this, &AEnemy::Attack, AttackTime);
+	SetEnemyTimer<&AEnemy::Attack>(AttackTimer, AttackFallbackTimer, FMath::RandRange(AttackMin, AttackMax));
 }
 
 void AEnemy::ClearAttackTimer()
 {
-	GetWorldTimerManager().ClearTimer(AttackTimer);
+	ClearEnemyTimer(AttackTimer, AttackFallbackTimer);
+}
+
+void AEnemy::ClearWaitTimer()
+{
+	ClearEnemyTimer(WaitTimer, WaitFallbackTimer);
 }
 
 void AEnemy::PatrolTimerFinished()
 {
-	MoveToTarget(PatrolTarget);
+	MoveToPatrolGoal();
+}
+
+void AEnemy::SetEnemyState(EEnemyState State)
+{
+	EnemyState = State;
+	if (EnemyAISubsystem)
+	{
+		EnemyAISubsystem->SetEnemyState(this, State);
+	}
+	if (ReplaySubsystem)
+	{
+		ReplaySubsystem->RecordEnemyState(this, State);
+	}
+}
+
+void AEnemy::SetCombatTarget(AActor* Target)
+{
+	if (CombatCoordinator && Target != CombatTarget)
+	{
+		CombatCoordinator->ReleaseAttackToken(this);
+	}
+	CombatTarget = Target;
+	if (CombatRangeSubsystem)
+	{
+		if (Target)
+		{
+			CombatRange = CombatRangeSubsystem->Watch(this, Target, AttackRadius, CombatRadius);
+		}
+		else
+		{
+			CombatRangeSubsystem->Unwatch(this);
+			CombatRange = ECombatRange::Outside;
+		}
+	}
+	if (EnemyAISubsystem)
+	{
+		EnemyAISubsystem->SetCombatTarget(this, Target);
+	}
+}
+
+void AEnemy::SetPatrolTarget(AActor* Target)
+{
+	PatrolTarget = Target;
+	UpdatePatrolGoal();
+}
+
+void AEnemy::SetPatrolRoute(APatrolRoute* Route)
+{
+	PatrolRoute = Route;
+	PreviousPatrolWaypoint = INDEX_NONE;
+	SetPatrolWaypoint(PatrolRoute ? PatrolRoute->GetClosestWaypoint(GetActorLocation()) : INDEX_NONE);
+	if (HasActorBegunPlay() && EnemyState == EEnemyState::Patrolling)
+	{
+		ClearPatrolTimer();
+		MoveToPatrolGoal();
+	}
+}
+
+void AEnemy::SetPatrolWaypoint(int32 Waypoint)
+{
+	PatrolWaypoint = Waypoint;
+	UpdatePatrolGoal();
+}
+
+void AEnemy::UpdatePatrolGoal()
+{
+	if (EnemyAISubsystem)
+	{
+		const TOptional<FVector> Goal = GetPatrolGoal();
+		EnemyAISubsystem->SetPatrolGoal(this, Goal.GetPtrOrNull());
+	}
+}
+
+TOptional<FVector> AEnemy::GetPatrolGoal() const
+{
+	if (PatrolRoute)
+	{
+		if (PatrolRoute->IsValidWaypoint(PatrolWaypoint))
+		{
+			return PatrolRoute->GetWaypointLocation(PatrolWaypoint);
+		}
+		return {};
+	}
+	if (PatrolTarget)
+	{
+		return PatrolTarget->GetActorLocation();
+	}
+	return {};
 }
@@ -0,0 +1,374 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Enemy/EnemyAISubsystem.h"
+
+#include "Debug/BenchmarkTimers.h"
+#include "Debug/SlashStats.h"
+#include "Enemy/CombatRangeSubsystem.h"
+#include "Enemy/Enemy.h"
+#include "Enemy/EnemyStateTree.h"
+#include "Enemy/EnemyTypes.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("Batched AI Tick"), STAT_EnemyAI_BatchedTick, STATGROUP_SlashEnemyAI);
+DECLARE_CYCLE_STAT(TEXT("Batched AI Gather"), STAT_EnemyAI_Gather, STATGROUP_SlashEnemyAI);
+DECLARE_CYCLE_STAT(TEXT("Batched AI Evaluate"), STAT_EnemyAI_Evaluate, STATGROUP_SlashEnemyAI);
+DECLARE_CYCLE_STAT(TEXT("Batched AI Dispatch"), STAT_EnemyAI_Dispatch, STATGROUP_SlashEnemyAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Registered Enemies"), STAT_EnemyAI_NumEnemies, STATGROUP_SlashEnemyAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Decisions Dispatched"), STAT_EnemyAI_NumDecisions, STATGROUP_SlashEnemyAI);
+DECLARE_CYCLE_STAT(TEXT("LOD Update"), STAT_EnemyAILOD_Update, STATGROUP_SlashAILOD);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Full"), STAT_EnemyAILOD_NumFull, STATGROUP_SlashAILOD);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Reduced"), STAT_EnemyAILOD_NumReduced, STATGROUP_SlashAILOD);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dormant"), STAT_EnemyAILOD_NumDormant, STATGROUP_SlashAILOD);
+
+static TAutoConsoleVariable<bool> CVarEnemyAIBatched(
+	TEXT("Slash.EnemyAI.Batched"),
+	true,
+	TEXT("If true, enemy AI decisions are evaluated in one batched pass by UEnemyAISubsystem.\n")
+	TEXT("If false, every enemy evaluates its own decisions in AEnemy::Tick."));
+
+static TAutoConsoleVariable<bool> CVarEnemyAILODEnabled(
+	TEXT("Slash.EnemyAI.LOD.Enabled"),
+	true,
+	TEXT("If true, enemies far from the player run at reduced detail or go dormant."));
+
+static TAutoConsoleVariable<float> CVarEnemyAILODFullDistance(
+	TEXT("Slash.EnemyAI.LOD.FullDistance"),
+	3000,
+	TEXT("Enemies within this distance of the player always run at full detail."));
+
+static TAutoConsoleVariable<float> CVarEnemyAILODDormantDistance(
+	TEXT("Slash.EnemyAI.LOD.DormantDistance"),
+	8000,
+	TEXT("Enemies beyond this distance of the player go dormant unless rendered recently."));
+
+static TAutoConsoleVariable<int32> CVarEnemyAILODReducedFrameInterval(
+	TEXT("Slash.EnemyAI.LOD.ReducedFrameInterval"),
+	4,
+	TEXT("Reduced detail enemies make decisions once every this many frames."));
+
+static TAutoConsoleVariable<float> CVarEnemyAILODUpdateInterval(
+	TEXT("Slash.EnemyAI.LOD.UpdateInterval"),
+	0.25,
+	TEXT("Seconds between picking enemy detail tiers."));
+
+void UEnemyAISubsystem::RegisterEnemy(AEnemy* Enemy)
+{
+	if (!Enemy || Enemy->EnemyAIIndex != INDEX_NONE) return;
+
+	Enemy->EnemyAIIndex = Enemies.Add(Enemy);
+	States.Add(Enemy->EnemyState);
+	InCombat.Add(Enemy->GetStateTree().IsInCombat(Enemy->EnemyState));
+	Locations.Add(Enemy->GetActorLocation());
+	CombatRadiiSquared.Add(FMath::Square(Enemy->CombatRadius));
+	AttackRadiiSquared.Add(FMath::Square(Enemy->AttackRadius));
+	PatrolRadiiSquared.Add(FMath::Square(Enemy->PatrolRadius));
+	CombatTargetIndices.Add(AcquireTarget(Enemy->CombatTarget));
+	const TOptional<FVector> PatrolGoal = Enemy->GetPatrolGoal();
+	PatrolGoals.Add(PatrolGoal.Get(FVector::ZeroVector));
+	HasPatrolGoals.Add(PatrolGoal.IsSet());
+	Decisions.Add(EEnemyAIDecision::None);
+	LODs.Add(EEnemyAILOD::Full);
+
+	Enemy->SetActorTickEnabled(!bBatchingApplied);
+}
+
+void UEnemyAISubsystem::UnregisterEnemy(AEnemy* Enemy)
+{
+	if (!Enemy || !Enemies.IsValidIndex(Enemy->EnemyAIIndex)) return;
+
+	const int32 Index = Enemy->EnemyAIIndex;
+	ReleaseTarget(CombatTargetIndices[Index]);
+
+	Enemies.RemoveAtSwap(Index, 1, false);
+	States.RemoveAtSwap(Index, 1, false);
+	InCombat.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	CombatRadiiSquared.RemoveAtSwap(Index, 1, false);
+	AttackRadiiSquared.RemoveAtSwap(Index, 1, false);
+	PatrolRadiiSquared.RemoveAtSwap(Index, 1, false);
+	CombatTargetIndices.RemoveAtSwap(Index, 1, false);
+	PatrolGoals.RemoveAtSwap(Index, 1, false);
+	HasPatrolGoals.RemoveAtSwap(Index, 1, false);
+	Decisions.RemoveAtSwap(Index, 1, false);
+	LODs.RemoveAtSwap(Index, 1, false);
+
+	// Last enemy was swapped into the removed slot
+	if (Enemies.IsValidIndex(Index) && Enemies[Index])
+	{
+		Enemies[Index]->EnemyAIIndex = Index;
+	}
+	Enemy->EnemyAIIndex = INDEX_NONE;
+}
+
+void UEnemyAISubsystem::SetEnemyState(const AEnemy* Enemy, EEnemyState State)
+{
+	if (Enemy && States.IsValidIndex(Enemy->EnemyAIIndex))
+	{
+		States[Enemy->EnemyAIIndex] = State;
+		InCombat[Enemy->EnemyAIIndex] = Enemy->GetStateTree().IsInCombat(State);
+	}
+}
+
+void UEnemyAISubsystem::SetCombatTarget(const AEnemy* Enemy, AActor* Target)
+{
+	if (Enemy && CombatTargetIndices.IsValidIndex(Enemy->EnemyAIIndex))
+	{
+		ReplaceTarget(CombatTargetIndices[Enemy->EnemyAIIndex], Target);
+	}
+}
+
+void UEnemyAISubsystem::SetPatrolGoal(const AEnemy* Enemy, const FVector* Goal)
+{
+	if (Enemy && PatrolGoals.IsValidIndex(Enemy->EnemyAIIndex))
+	{
+		PatrolGoals[Enemy->EnemyAIIndex] = Goal ? *Goal : FVector::ZeroVector;
+		HasPatrolGoals[Enemy->EnemyAIIndex] = Goal != nullptr;
+	}
+}
+
+void UEnemyAISubsystem::WakeEnemy(AEnemy* Enemy)
+{
+	if (Enemy && LODs.IsValidIndex(Enemy->EnemyAIIndex))
+	{
+		SetLOD(Enemy->EnemyAIIndex, EEnemyAILOD::Full);
+	}
+}
+
+bool UEnemyAISubsystem::IsBatchingEnabled()
+{
+	return CVarEnemyAIBatched.GetValueOnGameThread();
+}
+
+int32 UEnemyAISubsystem::AcquireTarget(AActor* Target)
+{
+	if (!Target) return INDEX_NONE;
+
+	if (const int32* Existing = TargetIndices.Find(Target))
+	{
+		++TargetRefCounts[*Existing];
+		return *Existing;
+	}
+
+	int32 Index;
+	if (FreeTargetIndices.Num() > 0)
+	{
+		Index = FreeTargetIndices.Pop(false);
+		Targets[Index] = Target;
+		TargetKeys[Index] = Target;
+		TargetLocations[Index] = Target->GetActorLocation();
+		TargetRefCounts[Index] = 1;
+	}
+	else
+	{
+		Index = Targets.Add(Target);
+		TargetKeys.Add(Target);
+		TargetLocations.Add(Target->GetActorLocation());
+		TargetRefCounts.Add(1);
+	}
+	TargetIndices.Add(Target, Index);
+	return Index;
+}
+
+void UEnemyAISubsystem::ReleaseTarget(int32 TargetIndex)
+{
+	if (!Targets.IsValidIndex(TargetIndex)) return;
+
+	if (--TargetRefCounts[TargetIndex] <= 0)
+	{
+		TargetIndices.Remove(TargetKeys[TargetIndex]);
+		Targets[TargetIndex].Reset();
+		TargetRefCounts[TargetIndex] = 0;
+		FreeTargetIndices.Add(TargetIndex);
+	}
+}
+
+void UEnemyAISubsystem::ReplaceTarget(int32& TargetIndex, AActor* Target)
+{
+	if (Targets.IsValidIndex(TargetIndex) && Targets[TargetIndex].Get() == Target) return;
+	ReleaseTarget(TargetIndex);
+	TargetIndex = AcquireTarget(Target);
+}
+
+void UEnemyAISubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAI_BatchedTick);
+	SCOPE_BENCHMARK_TIMER(EnemyAIBatch);
+
+	if (const bool bBatchingEnabled = IsBatchingEnabled(); bBatchingEnabled != bBatchingApplied)
+	{
+		SetEnemyTicksEnabled(!bBatchingEnabled);
+		bBatchingApplied = bBatchingEnabled;
+	}
+	SET_DWORD_STAT(STAT_EnemyAI_NumEnemies, Enemies.Num());
+	++FrameCounter;
+
+	GatherLocations();
+	if ((TimeUntilLODUpdate -= DeltaTime) <= 0)
+	{
+		UpdateLODs();
+		TimeUntilLODUpdate = CVarEnemyAILODUpdateInterval.GetValueOnGameThread();
+	}
+
+	if (!bBatchingApplied) return;
+	EvaluateDecisions();
+	DispatchDecisions();
+}
+
+void UEnemyAISubsystem::GatherLocations()
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAI_Gather);
+
+	for (int32 i = 0; i < Enemies.Num(); ++i)
+	{
+		if (const AEnemy* Enemy = Enemies[i])
+		{
+			Locations[i] = Enemy->GetActorLocation();
+		}
+	}
+	for (int32 i = 0; i < Targets.Num(); ++i)
+	{
+		if (const AActor* Target = Targets[i].Get())
+		{
+			TargetLocations[i] = Target->GetActorLocation();
+		}
+	}
+}
+
+void UEnemyAISubsystem::EvaluateDecisions()
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAI_Evaluate);
+
+	const uint32 ReducedFrameInterval = FMath::Max(CVarEnemyAILODReducedFrameInterval.GetValueOnGameThread(), 1);
+	// Enemies in combat are told when their range to the combat target changes instead
+	const bool bCombatRangeEvents = GetWorld()->GetSubsystem<UCombatRangeSubsystem>() != nullptr;
+
+	// Measures ranges for the combat transitions of the enemy state tree, and mirrors AEnemy::CheckPatrolTarget
+	const int32 NumEnemies = States.Num();
+	for (int32 i = 0; i < NumEnemies; ++i)
+	{
+		const EEnemyState State = States[i];
+		EEnemyAIDecision Decision = EEnemyAIDecision::None;
+
+		// Reduced enemies are spread out over frames by slot so they don't all decide on the same frame
+		if (const EEnemyAILOD LOD = LODs[i];
+			LOD == EEnemyAILOD::Dormant
+			|| (LOD == EEnemyAILOD::Reduced && (FrameCounter + i) % ReducedFrameInterval != 0))
+		{
+			Decisions[i] = Decision;
+			continue;
+		}
+
+		if (InCombat[i] && !bCombatRangeEvents)
+		{
+			const int32 TargetIndex = CombatTargetIndices[i];
+			const bool bHasTarget = TargetIndex != INDEX_NONE && Targets[TargetIndex].IsValid();
+			const double DistanceSquared = bHasTarget ? FVector::DistSquared(Locations[i], TargetLocations[TargetIndex]) : 0;
+			const bool bInAttackRadius = bHasTarget && DistanceSquared <= AttackRadiiSquared[i];
+
+			if (!bHasTarget || DistanceSquared > CombatRadiiSquared[i])
+			{
+				Decision = EEnemyAIDecision::LoseInterest;
+			}
+			else if (!bInAttackRadius && State != EEnemyState::Chasing)
+			{
+				Decision = EEnemyAIDecision::Chase;
+			}
+			else if (bInAttackRadius && State != EEnemyState::Attacking && State != EEnemyState::Engaged && State != EEnemyState::Waiting)
+			{
+				Decision = EEnemyAIDecision::Attack;
+			}
+		}
+		else if (State == EEnemyState::Patrolling)
+		{
+			if (HasPatrolGoals[i] && FVector::DistSquared(Locations[i], PatrolGoals[i]) <= PatrolRadiiSquared[i])
+			{
+				Decision = EEnemyAIDecision::NextPatrolTarget;
+			}
+		}
+
+		Decisions[i] = Decision;
+	}
+}
+
+void UEnemyAISubsystem::DispatchDecisions()
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAI_Dispatch);
+
+	int32 NumDispatched = 0;
+	// Enemies may change state or targets in response, but never register or unregister here
+	for (int32 i = 0; i < Decisions.Num(); ++i)
+	{
+		if (Decisions[i] != EEnemyAIDecision::None && Enemies[i])
+		{
+			Enemies[i]->ApplyAIDecision(Decisions[i]);
+			++NumDispatched;
+		}
+	}
+	INC_DWORD_STAT_BY(STAT_EnemyAI_NumDecisions, NumDispatched);
+}
+
+void UEnemyAISubsystem::UpdateLODs()
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAILOD_Update);
+
+	const APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	const bool bLODEnabled = CVarEnemyAILODEnabled.GetValueOnGameThread() && Player;
+	const FVector PlayerLocation = Player ? Player->GetActorLocation() : FVector::ZeroVector;
+	const double FullDistanceSquared = FMath::Square(CVarEnemyAILODFullDistance.GetValueOnGameThread());
+	const double DormantDistanceSquared = FMath::Square(CVarEnemyAILODDormantDistance.GetValueOnGameThread());
+
+	int32 NumPerLOD[3] = {0, 0, 0};
+	for (int32 i = 0; i < Enemies.Num(); ++i)
+	{
+		EEnemyAILOD LOD = EEnemyAILOD::Full;
+		// Enemies in combat stay at full detail, they are near the player anyway
+		if (bLODEnabled && !InCombat[i])
+		{
+			const double DistanceSquared = FVector::DistSquared(Locations[i], PlayerLocation);
+			if (DistanceSquared > FullDistanceSquared)
+			{
+				const bool bVisible = Enemies[i] && Enemies[i]->WasRecentlyRendered(0.5f);
+				LOD = bVisible || DistanceSquared <= DormantDistanceSquared ? EEnemyAILOD::Reduced : EEnemyAILOD::Dormant;
+			}
+		}
+		SetLOD(i, LOD);
+		++NumPerLOD[static_cast<int32>(LOD)];
+	}
+
+	SET_DWORD_STAT(STAT_EnemyAILOD_NumFull, NumPerLOD[static_cast<int32>(EEnemyAILOD::Full)]);
+	SET_DWORD_STAT(STAT_EnemyAILOD_NumReduced, NumPerLOD[static_cast<int32>(EEnemyAILOD::Reduced)]);
+	SET_DWORD_STAT(STAT_EnemyAILOD_NumDormant, NumPerLOD[static_cast<int32>(EEnemyAILOD::Dormant)]);
+}
+
+void UEnemyAISubsystem::SetLOD(int32 Index, EEnemyAILOD LOD)
+{
+	if (LODs[Index] == LOD) return;
+	LODs[Index] = LOD;
+	if (Enemies[Index])
+	{
+		Enemies[Index]->ApplyAILOD(LOD);
+	}
+}
+
+void UEnemyAISubsystem::SetEnemyTicksEnabled(bool bEnabled)
+{
+	for (AEnemy* Enemy : Enemies)
+	{
+		if (Enemy)
+		{
+			Enemy->SetActorTickEnabled(bEnabled);
+		}
+	}
+}
+
+TStatId UEnemyAISubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemyAISubsystem, STATGROUP_Tickables);
+}
+
+bool UEnemyAISubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,347 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Enemy/EnemyPerceptionSubsystem.h"
+
+#include "Slash.h"
+#include "Debug/SlashStats.h"
+#include "Spatial/SpatialHashSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Perception Tick"), STAT_Perception_Tick, STATGROUP_SlashPerception);
+DECLARE_CYCLE_STAT(TEXT("Range And Cone Pass"), STAT_Perception_Filter, STATGROUP_SlashPerception);
+DECLARE_CYCLE_STAT(TEXT("Line Of Sight Traces"), STAT_Perception_Traces, STATGROUP_SlashPerception);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sensors Updated"), STAT_Perception_NumDueSensors, STATGROUP_SlashPerception);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pairs Tested"), STAT_Perception_NumPairs, STATGROUP_SlashPerception);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Traces Issued"), STAT_Perception_NumTraces, STATGROUP_SlashPerception);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Traces Queued"), STAT_Perception_NumQueued, STATGROUP_SlashPerception);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Seen/Lost Events"), STAT_Perception_NumEvents, STATGROUP_SlashPerception);
+
+static TAutoConsoleVariable<int32> CVarPerceptionTraceBudget(
+	TEXT("Slash.Perception.TraceBudget"),
+	16,
+	TEXT("Maximum number of enemy line of sight traces per frame, the rest wait for later frames."));
+
+void UEnemyPerceptionSubsystem::RegisterSensor(APawn* Sensor, double SightRadius, double PeripheralVisionAngle, float SensingInterval, FOnPerceptionChanged OnPerceptionChanged)
+{
+	if (!Sensor || SensorIndices.Contains(Sensor)) return;
+	if (!SpatialHash)
+	{
+		SpatialHash = GetWorld()->GetSubsystem<USpatialHashSubsystem>();
+	}
+	const int32 SpatialHandle = SpatialHash ? SpatialHash->GetHandle(Sensor) : INDEX_NONE;
+	if (SpatialHandle == INDEX_NONE)
+	{
+		UE_LOG(LogSlash, Warning, TEXT("%s is not in the spatial hash and cannot sense"), *Sensor->GetName());
+		return;
+	}
+
+	const double CosPeripheralAngle = FMath::Cos(FMath::DegreesToRadians(PeripheralVisionAngle));
+	const int32 Index = Sensors.Add(Sensor);
+	SightRadiiSquared.Add(FMath::Square(SightRadius));
+	SignedCosSquared.Add(CosPeripheralAngle * FMath::Abs(CosPeripheralAngle));
+	SensingIntervals.Add(SensingInterval);
+	// Spread first updates out so sensors registered together don't sense on the same frame
+	TimesUntilSense.Add(FMath::FRandRange(0.f, SensingInterval));
+	SensorsEnabled.Add(true);
+	SensorsDue.Add(false);
+	SeenMasks.Add(0);
+	PendingMasks.Add(0);
+	Callbacks.Add(MoveTemp(OnPerceptionChanged));
+	SensorSpatialHandles.Add(SpatialHandle);
+	SensorIndices.Add(Sensor, Index);
+	SensorsBySpatialHandle.Add(SpatialHandle, Index);
+	MaxSightRadius = FMath::Max(MaxSightRadius, SightRadius);
+}
+
+void UEnemyPerceptionSubsystem::UnregisterSensor(APawn* Sensor)
+{
+	int32 Index;
+	if (!Sensor || !SensorIndices.RemoveAndCopyValue(Sensor, Index)) return;
+	SensorsBySpatialHandle.Remove(SensorSpatialHandles[Index]);
+
+	Sensors.RemoveAtSwap(Index, 1, false);
+	SightRadiiSquared.RemoveAtSwap(Index, 1, false);
+	SignedCosSquared.RemoveAtSwap(Index, 1, false);
+	SensingIntervals.RemoveAtSwap(Index, 1, false);
+	TimesUntilSense.RemoveAtSwap(Index, 1, false);
+	SensorsEnabled.RemoveAtSwap(Index, 1, false);
+	SensorsDue.RemoveAtSwap(Index, 1, false);
+	SeenMasks.RemoveAtSwap(Index, 1, false);
+	PendingMasks.RemoveAtSwap(Index, 1, false);
+	Callbacks.RemoveAtSwap(Index, 1, false);
+	SensorSpatialHandles.RemoveAtSwap(Index, 1, false);
+
+	// Last sensor was swapped into the removed slot
+	if (Sensors.IsValidIndex(Index))
+	{
+		SensorIndices.Add(Sensors[Index].GetEvenIfUnreachable(), Index);
+		SensorsBySpatialHandle.Add(SensorSpatialHandles[Index], Index);
+	}
+}
+
+void UEnemyPerceptionSubsystem::SetSensorEnabled(APawn* Sensor, bool bEnabled)
+{
+	if (const int32* Index = SensorIndices.Find(Sensor))
+	{
+		SensorsEnabled[*Index] = bEnabled;
+	}
+}
+
+void UEnemyPerceptionSubsystem::SetSensingInterval(APawn* Sensor, float SensingInterval)
+{
+	if (const int32* Index = SensorIndices.Find(Sensor))
+	{
+		SensingIntervals[*Index] = SensingInterval;
+		TimesUntilSense[*Index] = FMath::Min(TimesUntilSense[*Index], SensingInterval);
+	}
+}
+
+void UEnemyPerceptionSubsystem::ForgetPawn(APawn* Sensor, APawn* Pawn)
+{
+	const int32* Index = SensorIndices.Find(Sensor);
+	if (!Index || !Pawn) return;
+	for (int32 Stimulus = 0; Stimulus < Stimuli.Num(); ++Stimulus)
+	{
+		if (Stimuli[Stimulus].Get() == Pawn)
+		{
+			// Quietly, the sensor already knows
+			SeenMasks[*Index] &= ~(1ull << Stimulus);
+		}
+	}
+}
+
+void UEnemyPerceptionSubsystem::RegisterStimulus(APawn* Pawn)
+{
+	if (!Pawn) return;
+	int32 FreeSlot = INDEX_NONE;
+	for (int32 Stimulus = 0; Stimulus < Stimuli.Num(); ++Stimulus)
+	{
+		if (Stimuli[Stimulus].Get() == Pawn) return;
+		if (FreeSlot == INDEX_NONE && !Stimuli[Stimulus].IsValid())
+		{
+			FreeSlot = Stimulus;
+		}
+	}
+
+	if (FreeSlot == INDEX_NONE)
+	{
+		if (Stimuli.Num() >= MaxStimuli)
+		{
+			UE_LOG(LogSlash, Warning, TEXT("Too many perception stimuli, %s cannot be seen"), *Pawn->GetName());
+			return;
+		}
+		FreeSlot = Stimuli.AddDefaulted();
+		StimulusLocations.AddDefaulted();
+	}
+	else
+	{
+		// Slot of a destroyed pawn, drop anything remembered about it
+		const uint64 KeepMask = ~(1ull << FreeSlot);
+		for (int32 Sensor = 0; Sensor < Sensors.Num(); ++Sensor)
+		{
+			SeenMasks[Sensor] &= KeepMask;
+			PendingMasks[Sensor] &= KeepMask;
+		}
+	}
+	Stimuli[FreeSlot] = Pawn;
+	StimulusLocations[FreeSlot] = Pawn->GetActorLocation();
+}
+
+void UEnemyPerceptionSubsystem::UnregisterStimulus(APawn* Pawn)
+{
+	for (int32 Stimulus = 0; Stimulus < Stimuli.Num(); ++Stimulus)
+	{
+		if (Stimuli[Stimulus].Get() == Pawn)
+		{
+			Stimuli[Stimulus].Reset();
+			// Slot may be reused, nobody sees or waits on it anymore
+			const uint64 KeepMask = ~(1ull << Stimulus);
+			for (int32 Sensor = 0; Sensor < Sensors.Num(); ++Sensor)
+			{
+				SeenMasks[Sensor] &= KeepMask;
+				PendingMasks[Sensor] &= KeepMask;
+			}
+		}
+	}
+}
+
+void UEnemyPerceptionSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Perception_Tick);
+
+	if (UpdateDueSensors(DeltaTime) > 0)
+	{
+		SenseDueSensors();
+	}
+	ProcessTraces();
+}
+
+int32 UEnemyPerceptionSubsystem::UpdateDueSensors(float DeltaTime)
+{
+	int32 NumDue = 0;
+	for (int32 i = 0; i < Sensors.Num(); ++i)
+	{
+		const bool bDue = SensorsEnabled[i] && (TimesUntilSense[i] -= DeltaTime) <= 0;
+		if (bDue)
+		{
+			TimesUntilSense[i] = FMath::Max(TimesUntilSense[i] + SensingIntervals[i], 0.f);
+			++NumDue;
+		}
+		SensorsDue[i] = bDue;
+	}
+	INC_DWORD_STAT_BY(STAT_Perception_NumDueSensors, NumDue);
+	return NumDue;
+}
+
+void UEnemyPerceptionSubsystem::SenseDueSensors()
+{
+	if (!SpatialHash) return;
+	const FSpatialHashGrid& Grid = SpatialHash->GetGrid();
+
+	PairSensors.Reset();
+	PairStimuli.Reset();
+	PairOffsets.Reset();
+	PairForwards.Reset();
+
+	// Gather sensors near each stimulus through the spatial hash, stimuli are few and sensors are many
+	for (int32 Stimulus = 0; Stimulus < Stimuli.Num(); ++Stimulus)
+	{
+		const APawn* StimulusPawn = Stimuli[Stimulus].Get();
+		if (!StimulusPawn) continue;
+		const FVector StimulusLocation = StimulusLocations[Stimulus] = StimulusPawn->GetActorLocation();
+
+		NearbyHandles.Reset();
+		Grid.QueryRadius(StimulusLocation, MaxSightRadius, NearbyHandles, ESpatialHashCategory::Character);
+		for (const int32 Handle : NearbyHandles)
+		{
+			const int32* SensorIndex = SensorsBySpatialHandle.Find(Handle);
+			if (!SensorIndex || !SensorsDue[*SensorIndex]) continue;
+			const APawn* SensorPawn = Sensors[*SensorIndex].Get();
+			if (!SensorPawn || SensorPawn == StimulusPawn) continue;
+
+			PairSensors.Add(*SensorIndex);
+			PairStimuli.Add(Stimulus);
+			PairOffsets.Add(StimulusLocation - Grid.GetLocation(Handle));
+			PairForwards.Add(SensorPawn->GetActorForwardVector());
+		}
+	}
+
+	// Range and cone tests over the packed pairs, branch free so the loop can vectorize
+	const int32 NumPairs = PairSensors.Num();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_Perception_Filter);
+		PairPassed.SetNumUninitialized(NumPairs, false);
+		for (int32 Pair = 0; Pair < NumPairs; ++Pair)
+		{
+			const FVector& Offset = PairOffsets[Pair];
+			const int32 Sensor = PairSensors[Pair];
+			const double DistanceSquared = Offset.SizeSquared();
+			const double Dot = FVector::DotProduct(PairForwards[Pair], Offset);
+			// Dot >= Cos * Distance, both sides multiplied by their absolute value
+			PairPassed[Pair] = (DistanceSquared <= SightRadiiSquared[Sensor]) & (Dot * FMath::Abs(Dot) >= SignedCosSquared[Sensor] * DistanceSquared);
+		}
+	}
+	INC_DWORD_STAT_BY(STAT_Perception_NumPairs, NumPairs);
+
+	InConeMasks.SetNumZeroed(Sensors.Num(), false);
+	for (int32 Pair = 0; Pair < NumPairs; ++Pair)
+	{
+		if (!PairPassed[Pair]) continue;
+		const int32 Sensor = PairSensors[Pair];
+		const uint64 Bit = 1ull << PairStimuli[Pair];
+		InConeMasks[Sensor] |= Bit;
+		if (!(PendingMasks[Sensor] & Bit))
+		{
+			PendingMasks[Sensor] |= Bit;
+			PendingTraces.Add({Sensors[Sensor], PairStimuli[Pair]});
+		}
+	}
+
+	// Anything seen before but now out of range or cone is lost without needing a trace
+	for (int32 Sensor = 0; Sensor < Sensors.Num(); ++Sensor)
+	{
+		if (!SensorsDue[Sensor]) continue;
+		uint64 LostMask = SeenMasks[Sensor] & ~InConeMasks[Sensor];
+		while (LostMask)
+		{
+			const int32 Stimulus = FMath::CountTrailingZeros64(LostMask);
+			LostMask &= LostMask - 1;
+			SetSeen(Sensor, Stimulus, false);
+		}
+		InConeMasks[Sensor] = 0;
+	}
+}
+
+void UEnemyPerceptionSubsystem::ProcessTraces()
+{
+	SCOPE_CYCLE_COUNTER(STAT_Perception_Traces);
+
+	UWorld* World = GetWorld();
+	const int32 TraceBudget = CVarPerceptionTraceBudget.GetValueOnGameThread();
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(EnemyPerception), true);
+	int32 NumTraces = 0;
+
+	while (PendingHead < PendingTraces.Num() && NumTraces < TraceBudget)
+	{
+		const FPendingTrace Trace = PendingTraces[PendingHead++];
+		APawn* SensorPawn = Trace.Sensor.Get();
+		const int32* SensorIndex = SensorPawn ? SensorIndices.Find(SensorPawn) : nullptr;
+		if (!SensorIndex) continue;
+
+		const uint64 Bit = 1ull << Trace.Stimulus;
+		if (!(PendingMasks[*SensorIndex] & Bit)) continue;
+		PendingMasks[*SensorIndex] &= ~Bit;
+
+		APawn* StimulusPawn = Stimuli[Trace.Stimulus].Get();
+		if (!StimulusPawn || !SensorsEnabled[*SensorIndex]) continue;
+
+		Params.ClearIgnoredActors();
+		Params.AddIgnoredActor(SensorPawn);
+		Params.AddIgnoredActor(StimulusPawn);
+		const bool bBlocked = World->LineTraceTestByChannel(SensorPawn->GetPawnViewLocation(), StimulusPawn->GetActorLocation(), ECC_Visibility, Params);
+		++NumTraces;
+		SetSeen(*SensorIndex, Trace.Stimulus, !bBlocked);
+	}
+
+	if (PendingHead >= PendingTraces.Num())
+	{
+		PendingTraces.Reset();
+		PendingHead = 0;
+	}
+	else if (PendingHead * 2 > PendingTraces.Num())
+	{
+		// Compact the consumed front of the queue once it is the larger part
+		PendingTraces.RemoveAt(0, PendingHead, false);
+		PendingHead = 0;
+	}
+
+	INC_DWORD_STAT_BY(STAT_Perception_NumTraces, NumTraces);
+	INC_DWORD_STAT_BY(STAT_Perception_NumQueued, PendingTraces.Num() - PendingHead);
+}
+
+void UEnemyPerceptionSubsystem::SetSeen(int32 SensorIndex, int32 StimulusIndex, bool bSeen)
+{
+	const uint64 Bit = 1ull << StimulusIndex;
+	if (((SeenMasks[SensorIndex] & Bit) != 0) == bSeen) return;
+
+	if (bSeen)
+	{
+		SeenMasks[SensorIndex] |= Bit;
+	}
+	else
+	{
+		SeenMasks[SensorIndex] &= ~Bit;
+	}
+	INC_DWORD_STAT(STAT_Perception_NumEvents);
+	Callbacks[SensorIndex].ExecuteIfBound(Stimuli[StimulusIndex].Get(), bSeen);
+}
+
+TStatId UEnemyPerceptionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemyPerceptionSubsystem, STATGROUP_Tickables);
+}
+
+bool UEnemyPerceptionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Enemy/EnemyStateTree.h"
+
+#include "Debug/SlashStats.h"
+#include "Enemy/Enemy.h"
+#include "Enemy/EnemyTypes.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("State Tree Events"), STAT_EnemyAI_NumStateTreeEvents, STATGROUP_SlashEnemyAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("State Tree Transitions"), STAT_EnemyAI_NumStateTreeTransitions, STATGROUP_SlashEnemyAI);
+
+FEnemyStateTree::FEnemyStateTree(FName InName)
+	: Name(InName)
+{
+	AddNode(TEXT("Root"), INDEX_NONE, nullptr, nullptr);
+#if STATS
+	StatId = FDynamicStats::CreateStatId<FStatGroup_STATGROUP_SlashEnemyAI>(FString::Printf(TEXT("State Tree %s"), *Name.ToString()));
+#endif
+}
+
+int32 FEnemyStateTree::AddBranch(FName BranchName, int32 Parent, FTask EnterTask, FTask ExitTask)
+{
+	return AddNode(BranchName, Parent, EnterTask, ExitTask);
+}
+
+int32 FEnemyStateTree::AddState(EEnemyState State, int32 Parent, FTask EnterTask, FTask ExitTask)
+{
+	const int32 StateIndex = static_cast<int32>(State);
+	while (StateNodes.Num() <= StateIndex)
+	{
+		StateNodes.Add(INDEX_NONE);
+	}
+	check(StateNodes[StateIndex] == INDEX_NONE);
+	return StateNodes[StateIndex] = AddNode(NAME_None, Parent, EnterTask, ExitTask);
+}
+
+int32 FEnemyStateTree::AddNode(FName NodeName, int32 Parent, FTask EnterTask, FTask ExitTask)
+{
+	check(Parent == INDEX_NONE ? Nodes.Num() == 0 : Nodes.IsValidIndex(Parent));
+	return Nodes.Add({ NodeName, Parent, EnterTask, ExitTask, {} });
+}
+
+void FEnemyStateTree::AddTransition(int32 Node, EEnemyEvent Event, FCondition Condition, FTask Action, TOptional<EEnemyState> Target, bool bReenter)
+{
+	check(Nodes.IsValidIndex(Node));
+	check(!Target || GetStateNode(*Target) != INDEX_NONE);
+	Nodes[Node].Transitions.Add({ Event, Condition, Action, Target, bReenter });
+}
+
+void FEnemyStateTree::SetCombatBranch(int32 Branch)
+{
+	check(Nodes.IsValidIndex(Branch));
+	CombatBranch = Branch;
+}
+
+bool FEnemyStateTree::SendEvent(AEnemy& Enemy, EEnemyEvent Event) const
+{
+	FScopeCycleCounter CycleCounter(StatId);
+	INC_DWORD_STAT(STAT_EnemyAI_NumStateTreeEvents);
+
+	// Transitions of the state come before those of the branches it is in
+	for (int32 Node = GetStateNode(Enemy.EnemyState); Node != INDEX_NONE; Node = Nodes[Node].Parent)
+	{
+		for (const FTransition& Transition : Nodes[Node].Transitions)
+		{
+			if (Transition.Event != Event || (Transition.Condition && !(Enemy.*Transition.Condition)())) continue;
+
+			INC_DWORD_STAT(STAT_EnemyAI_NumStateTreeTransitions);
+			if (Transition.Action)
+			{
+				(Enemy.*Transition.Action)();
+			}
+			if (Transition.Target)
+			{
+				ChangeState(Enemy, *Transition.Target, Transition.bReenter);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void FEnemyStateTree::ChangeState(AEnemy& Enemy, EEnemyState Target, bool bReenter) const
+{
+	const int32 FromNode = GetStateNode(Enemy.EnemyState);
+	const int32 ToNode = GetStateNode(Target);
+	if (FromNode == ToNode && !bReenter) return;
+
+	// Branches above both states stay entered, re-entering a state only leaves the state itself
+	int32 SharedNode = FromNode == ToNode ? Nodes[ToNode].Parent : FromNode;
+	while (SharedNode != INDEX_NONE && !IsUnder(ToNode, SharedNode))
+	{
+		SharedNode = Nodes[SharedNode].Parent;
+	}
+
+	for (int32 Node = FromNode; Node != SharedNode && Node != INDEX_NONE; Node = Nodes[Node].Parent)
+	{
+		if (const FTask ExitTask = Nodes[Node].ExitTask)
+		{
+			(Enemy.*ExitTask)();
+		}
+	}
+
+	Enemy.SetEnemyState(Target);
+
+	TArray<int32, TInlineAllocator<8>> EnteredNodes;
+	for (int32 Node = ToNode; Node != SharedNode && Node != INDEX_NONE; Node = Nodes[Node].Parent)
+	{
+		EnteredNodes.Add(Node);
+	}
+	for (int32 i = EnteredNodes.Num() - 1; i >= 0; --i)
+	{
+		if (const FTask EnterTask = Nodes[EnteredNodes[i]].EnterTask)
+		{
+			(Enemy.*EnterTask)();
+		}
+	}
+}
+
+bool FEnemyStateTree::IsInCombat(EEnemyState State) const
+{
+	const int32 Node = GetStateNode(State);
+	return CombatBranch != INDEX_NONE && Node != INDEX_NONE && IsUnder(Node, CombatBranch);
+}
+
+int32 FEnemyStateTree::GetStateNode(EEnemyState State) const
+{
+	const int32 StateIndex = static_cast<int32>(State);
+	return StateNodes.IsValidIndex(StateIndex) ? StateNodes[StateIndex] : INDEX_NONE;
+}
+
+bool FEnemyStateTree::IsUnder(int32 Node, int32 Branch) const
+{
+	for (; Node != INDEX_NONE; Node = Nodes[Node].Parent)
+	{
+		if (Node == Branch) return true;
+	}
+	return false;
+}
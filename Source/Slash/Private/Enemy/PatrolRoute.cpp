@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Enemy/PatrolRoute.h"
+
+#include "NavigationData.h"
+#include "NavigationPath.h"
+#include "NavigationSystem.h"
+
+APatrolRoute::APatrolRoute()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>("RootComponent");
+}
+
+void APatrolRoute::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Cached before any actor begins play, so enemies can join the route from their own BeginPlay
+	const FTransform& Transform = GetActorTransform();
+	WorldWaypoints.Reset(Waypoints.Num());
+	for (const FVector& Waypoint : Waypoints)
+	{
+		WorldWaypoints.Add(Transform.TransformPosition(Waypoint));
+	}
+
+	const int32 NumWaypoints = WorldWaypoints.Num();
+	LegPaths.SetNum(NumWaypoints * NumWaypoints);
+	LegsBaked.Init(false, NumWaypoints * NumWaypoints);
+}
+
+void APatrolRoute::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const int32 NumWaypoints = WorldWaypoints.Num();
+	if (bBakePathsOnBeginPlay && NumWaypoints > 1)
+	{
+		for (int32 From = 0; From < NumWaypoints; ++From)
+		{
+			if (Mode == EPatrolRouteMode::Ordered)
+			{
+				BakeLeg(From, GetNextWaypoint(From));
+				continue;
+			}
+			for (int32 To = 0; To < NumWaypoints; ++To)
+			{
+				if (To != From)
+				{
+					BakeLeg(From, To);
+				}
+			}
+		}
+	}
+}
+
+int32 APatrolRoute::GetNextWaypoint(int32 Current) const
+{
+	const int32 NumWaypoints = WorldWaypoints.Num();
+	if (NumWaypoints == 0) return INDEX_NONE;
+	if (NumWaypoints == 1 || !IsValidWaypoint(Current)) return 0;
+
+	if (Mode == EPatrolRouteMode::Ordered)
+	{
+		return (Current + 1) % NumWaypoints;
+	}
+	// Pick among the other waypoints by skipping over the current one, no candidate list needed
+	const int32 Selection = FMath::RandRange(0, NumWaypoints - 2);
+	return Selection >= Current ? Selection + 1 : Selection;
+}
+
+int32 APatrolRoute::GetClosestWaypoint(const FVector& Location) const
+{
+	int32 Closest = INDEX_NONE;
+	double ClosestDistanceSquared = TNumericLimits<double>::Max();
+	for (int32 Waypoint = 0; Waypoint < WorldWaypoints.Num(); ++Waypoint)
+	{
+		if (const double DistanceSquared = FVector::DistSquared(Location, WorldWaypoints[Waypoint]); DistanceSquared < ClosestDistanceSquared)
+		{
+			Closest = Waypoint;
+			ClosestDistanceSquared = DistanceSquared;
+		}
+	}
+	return Closest;
+}
+
+FNavPathSharedPtr APatrolRoute::MakeLegPath(int32 From, int32 To)
+{
+	if (!IsValidWaypoint(From) || !IsValidWaypoint(To) || From == To) return nullptr;
+
+	const int32 Leg = GetLegIndex(From, To);
+	if (!LegsBaked[Leg])
+	{
+		BakeLeg(From, To);
+	}
+	if (LegPaths[Leg].Num() < 2) return nullptr;
+	// Path following takes ownership of the path it follows, so every enemy gets its own copy of the points
+	return MakeShared<FNavigationPath, ESPMode::ThreadSafe>(LegPaths[Leg]);
+}
+
+void APatrolRoute::BakeLeg(int32 From, int32 To)
+{
+	const int32 Leg = GetLegIndex(From, To);
+	LegsBaked[Leg] = true;
+	LegPaths[Leg].Reset();
+
+	if (const UNavigationPath* Path = UNavigationSystemV1::FindPathToLocationSynchronously(this, WorldWaypoints[From], WorldWaypoints[To]);
+		Path && Path->IsValid() && !Path->IsPartial())
+	{
+		LegPaths[Leg] = Path->PathPoints;
+	}
+}
@@ -0,0 +1,385 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Enemy/PursuitFieldSubsystem.h"
+
+#include "NavigationSystem.h"
+#include "Debug/SlashStats.h"
+#include "Enemy/Enemy.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pursuit Tick"), STAT_Pursuit_Tick, STATGROUP_SlashPursuit);
+DECLARE_CYCLE_STAT(TEXT("Navmesh Sampling"), STAT_Pursuit_Sample, STATGROUP_SlashPursuit);
+DECLARE_CYCLE_STAT(TEXT("Distance Spreading"), STAT_Pursuit_Integrate, STATGROUP_SlashPursuit);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fields"), STAT_Pursuit_NumFields, STATGROUP_SlashPursuit);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Chasers On Fields"), STAT_Pursuit_NumOnField, STATGROUP_SlashPursuit);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Chasers Moving Alone"), STAT_Pursuit_NumMoveTo, STATGROUP_SlashPursuit);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Navmesh Samples"), STAT_Pursuit_NumSamples, STATGROUP_SlashPursuit);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fields Spread"), STAT_Pursuit_NumIntegrations, STATGROUP_SlashPursuit);
+
+static TAutoConsoleVariable<int32> CVarPursuitMinChasers(
+	TEXT("Slash.Pursuit.MinChasers"),
+	3,
+	TEXT("Enemies chasing one target share a flow field once there are at least this many, fewer use their own move requests."));
+
+static TAutoConsoleVariable<int32> CVarPursuitSampleBudget(
+	TEXT("Slash.Pursuit.SampleBudget"),
+	256,
+	TEXT("Maximum number of flow field cells projected onto the navmesh per frame."));
+
+static TAutoConsoleVariable<float> CVarPursuitCellSize(
+	TEXT("Slash.Pursuit.CellSize"),
+	100,
+	TEXT("Size of a flow field cell.  Read when a world starts."));
+
+static TAutoConsoleVariable<int32> CVarPursuitGridSize(
+	TEXT("Slash.Pursuit.GridSize"),
+	48,
+	TEXT("Number of cells along each side of a flow field.  Read when a world starts."));
+
+namespace PursuitField
+{
+	enum ECellState : uint8
+	{
+		Unsampled,
+		Walkable,
+		Blocked
+	};
+
+	/// Orthogonal neighbours first, then diagonals.  Opposite directions are paired in OppositeDirections
+	constexpr int32 NumDirections = 8;
+	constexpr int32 OffsetsX[NumDirections] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+	constexpr int32 OffsetsY[NumDirections] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+	constexpr uint8 OppositeDirections[NumDirections] = { 1, 0, 3, 2, 7, 6, 5, 4 };
+	/// Step costs in tenths of a cell
+	constexpr uint16 StepCosts[NumDirections] = { 10, 10, 10, 10, 14, 14, 14, 14 };
+}
+
+void UPursuitFieldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	CellSize = FMath::Max(CVarPursuitCellSize.GetValueOnGameThread(), 10.f);
+	GridSize = FMath::Clamp(CVarPursuitGridSize.GetValueOnGameThread(), 8, 128);
+}
+
+bool UPursuitFieldSubsystem::StartPursuit(AEnemy* Enemy, AActor* Target)
+{
+	if (!Enemy || !Target) return false;
+
+	if (const TObjectKey<AActor>* ExistingTarget = ChaserTargets.Find(Enemy))
+	{
+		if (*ExistingTarget == TObjectKey<AActor>(Target))
+		{
+			// Already chasing this target, keep whatever it is doing
+			const FPursuitField& Field = Fields.FindChecked(*ExistingTarget);
+			const FChaser* Chaser = Field.Chasers.FindByPredicate([Enemy](const FChaser& Other) { return Other.Enemy == Enemy; });
+			return Chaser && Chaser->bOnField;
+		}
+		StopPursuit(Enemy);
+	}
+
+	FPursuitField& Field = FindOrAddField(Target);
+	FChaser& Chaser = Field.Chasers.AddDefaulted_GetRef();
+	Chaser.Enemy = Enemy;
+	ChaserTargets.Add(Enemy, Target);
+
+	// Join a ready field straight away so the enemy never requests its own path
+	FVector Direction;
+	Chaser.bOnField = Field.Chasers.Num() >= CVarPursuitMinChasers.GetValueOnGameThread()
+		&& IsFieldReady(Field)
+		&& GetSteeringDirection(Field, Enemy->GetActorLocation(), Target->GetActorLocation(), Direction);
+	return Chaser.bOnField;
+}
+
+void UPursuitFieldSubsystem::StopPursuit(AEnemy* Enemy)
+{
+	TObjectKey<AActor> TargetKey;
+	if (!ChaserTargets.RemoveAndCopyValue(Enemy, TargetKey)) return;
+
+	if (FPursuitField* Field = Fields.Find(TargetKey))
+	{
+		Field->Chasers.RemoveAllSwap([Enemy](const FChaser& Chaser) { return Chaser.Enemy == Enemy; }, false);
+		if (Field->Chasers.IsEmpty())
+		{
+			Fields.Remove(TargetKey);
+		}
+	}
+}
+
+void UPursuitFieldSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Pursuit_Tick);
+
+	const int32 MinChasers = CVarPursuitMinChasers.GetValueOnGameThread();
+	int32 SampleBudget = CVarPursuitSampleBudget.GetValueOnGameThread();
+	const int32 NumCells = GridSize * GridSize;
+	const int32 ScrollMargin = GridSize / 4;
+	int32 NumSamples = 0;
+	int32 NumOnField = 0;
+	int32 NumMoveTo = 0;
+
+	for (auto It = Fields.CreateIterator(); It; ++It)
+	{
+		FPursuitField& Field = It.Value();
+		Field.Chasers.RemoveAllSwap([](const FChaser& Chaser) { return !Chaser.Enemy.IsValid(); }, false);
+
+		const AActor* Target = Field.Target.Get();
+		if (!Target || Field.Chasers.IsEmpty())
+		{
+			// Chasers of a destroyed target lose interest on their next decision
+			for (const FChaser& Chaser : Field.Chasers)
+			{
+				ChaserTargets.Remove(Chaser.Enemy.Get());
+			}
+			It.RemoveCurrent();
+			continue;
+		}
+
+		const FVector TargetLocation = Target->GetActorLocation();
+		if (Field.Chasers.Num() >= MinChasers)
+		{
+			const FIntPoint TargetCell = GetWorldCell(TargetLocation);
+			if (const FIntPoint Local = TargetCell - Field.Origin;
+				Field.CellStates.Num() != NumCells
+				|| Local.X < ScrollMargin || Local.Y < ScrollMargin
+				|| Local.X >= GridSize - ScrollMargin || Local.Y >= GridSize - ScrollMargin)
+			{
+				ScrollField(Field, TargetCell);
+			}
+			if (Field.NumUnsampled > 0 && SampleBudget > 0)
+			{
+				const int32 Sampled = SampleField(Field, SampleBudget, TargetLocation.Z);
+				SampleBudget -= Sampled;
+				NumSamples += Sampled;
+			}
+			if (TargetCell != Field.TargetCell)
+			{
+				Field.TargetCell = TargetCell;
+				Field.bDirty = true;
+			}
+			if (Field.bDirty && Field.NumUnsampled == 0)
+			{
+				IntegrateField(Field);
+			}
+		}
+
+		const bool bReady = Field.Chasers.Num() >= MinChasers && IsFieldReady(Field);
+		for (FChaser& Chaser : Field.Chasers)
+		{
+			AEnemy* Enemy = Chaser.Enemy.Get();
+			FVector Direction;
+			const bool bOnField = bReady && GetSteeringDirection(Field, Enemy->GetActorLocation(), TargetLocation, Direction);
+			SetOnField(Chaser, bOnField);
+			if (bOnField)
+			{
+				Enemy->AddMovementInput(Direction);
+				++NumOnField;
+			}
+			else
+			{
+				++NumMoveTo;
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_Pursuit_NumFields, Fields.Num());
+	SET_DWORD_STAT(STAT_Pursuit_NumOnField, NumOnField);
+	SET_DWORD_STAT(STAT_Pursuit_NumMoveTo, NumMoveTo);
+	SET_DWORD_STAT(STAT_Pursuit_NumSamples, NumSamples);
+}
+
+UPursuitFieldSubsystem::FPursuitField& UPursuitFieldSubsystem::FindOrAddField(AActor* Target)
+{
+	FPursuitField& Field = Fields.FindOrAdd(Target);
+	Field.Target = Target;
+	return Field;
+}
+
+void UPursuitFieldSubsystem::ScrollField(FPursuitField& Field, const FIntPoint& CenterCell) const
+{
+	using namespace PursuitField;
+
+	const FIntPoint NewOrigin = CenterCell - FIntPoint(GridSize / 2);
+	const int32 NumCells = GridSize * GridSize;
+
+	TArray<float> Heights;
+	Heights.SetNumZeroed(NumCells);
+	TArray<uint8> CellStates;
+	CellStates.Init(Unsampled, NumCells);
+	int32 NumUnsampled = NumCells;
+
+	// Keep the samples of cells covered by both grids
+	if (Field.CellStates.Num() == NumCells)
+	{
+		for (int32 Y = 0; Y < GridSize; ++Y)
+		{
+			for (int32 X = 0; X < GridSize; ++X)
+			{
+				if (const int32 OldIndex = GetCellIndex(Field.Origin, NewOrigin + FIntPoint(X, Y));
+					OldIndex != INDEX_NONE && Field.CellStates[OldIndex] != Unsampled)
+				{
+					const int32 Index = Y * GridSize + X;
+					Heights[Index] = Field.Heights[OldIndex];
+					CellStates[Index] = Field.CellStates[OldIndex];
+					--NumUnsampled;
+				}
+			}
+		}
+	}
+
+	Field.Origin = NewOrigin;
+	Field.Heights = MoveTemp(Heights);
+	Field.CellStates = MoveTemp(CellStates);
+	Field.NumUnsampled = NumUnsampled;
+	Field.SampleCursor = 0;
+	Field.bDirty = true;
+}
+
+int32 UPursuitFieldSubsystem::SampleField(FPursuitField& Field, int32 Budget, float ProbeHeight) const
+{
+	using namespace PursuitField;
+	SCOPE_CYCLE_COUNTER(STAT_Pursuit_Sample);
+
+	const UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!NavSystem) return 0;
+
+	// Probes start at the target's height, so only the floor the target is on is found
+	const double HalfCell = CellSize * 0.5;
+	const FVector QueryExtent(HalfCell, HalfCell, 500);
+	const int32 NumCells = GridSize * GridSize;
+	int32 NumSampled = 0;
+	for (; NumSampled < Budget && Field.NumUnsampled > 0; Field.SampleCursor = (Field.SampleCursor + 1) % NumCells)
+	{
+		const int32 Index = Field.SampleCursor;
+		if (Field.CellStates[Index] != Unsampled) continue;
+
+		const FVector Center(
+			(Field.Origin.X + Index % GridSize + 0.5) * CellSize,
+			(Field.Origin.Y + Index / GridSize + 0.5) * CellSize,
+			ProbeHeight);
+		// The projected point has to land inside the cell, not just somewhere near it
+		FNavLocation NavLocation;
+		const bool bWalkable = NavSystem->ProjectPointToNavigation(Center, NavLocation, QueryExtent)
+			&& FMath::Abs(NavLocation.Location.X - Center.X) <= HalfCell
+			&& FMath::Abs(NavLocation.Location.Y - Center.Y) <= HalfCell;
+
+		Field.CellStates[Index] = bWalkable ? Walkable : Blocked;
+		Field.Heights[Index] = NavLocation.Location.Z;
+		--Field.NumUnsampled;
+		++NumSampled;
+	}
+	if (NumSampled > 0)
+	{
+		Field.bDirty = true;
+	}
+	return NumSampled;
+}
+
+bool UPursuitFieldSubsystem::CanStep(const FPursuitField& Field, int32 X, int32 Y, int32 Direction) const
+{
+	using namespace PursuitField;
+
+	const int32 ToX = X + OffsetsX[Direction];
+	const int32 ToY = Y + OffsetsY[Direction];
+	if (ToX < 0 || ToY < 0 || ToX >= GridSize || ToY >= GridSize) return false;
+
+	const int32 To = ToY * GridSize + ToX;
+	if (Field.CellStates[To] != Walkable) return false;
+	// Walkable slopes are at most 45 degrees, so one cell across rises at most one cell
+	if (FMath::Abs(Field.Heights[To] - Field.Heights[Y * GridSize + X]) > CellSize) return false;
+	// No cutting corners past blocked cells
+	if (Direction >= 4)
+	{
+		return Field.CellStates[Y * GridSize + ToX] == Walkable && Field.CellStates[ToY * GridSize + X] == Walkable;
+	}
+	return true;
+}
+
+void UPursuitFieldSubsystem::IntegrateField(FPursuitField& Field)
+{
+	using namespace PursuitField;
+	SCOPE_CYCLE_COUNTER(STAT_Pursuit_Integrate);
+	INC_DWORD_STAT(STAT_Pursuit_NumIntegrations);
+
+	const int32 NumCells = GridSize * GridSize;
+	Field.Distances.Init(MAX_uint16, NumCells);
+	Field.FlowDirections.Init(MAX_uint8, NumCells);
+	Field.FlowOrigin = Field.Origin;
+	Field.bDirty = false;
+
+	const int32 TargetIndex = GetCellIndex(Field.Origin, Field.TargetCell);
+	if (TargetIndex == INDEX_NONE || Field.CellStates[TargetIndex] != Walkable) return;
+
+	// Dijkstra from the target outwards, each cell flows back to the neighbour it was reached from
+	const auto Closer = [](const TPair<uint16, int32>& A, const TPair<uint16, int32>& B) { return A.Key < B.Key; };
+	OpenCells.Reset();
+	Field.Distances[TargetIndex] = 0;
+	OpenCells.HeapPush(TPair<uint16, int32>(0, TargetIndex), Closer);
+	while (OpenCells.Num() > 0)
+	{
+		TPair<uint16, int32> Open;
+		OpenCells.HeapPop(Open, Closer, false);
+		const int32 Index = Open.Value;
+		if (Open.Key > Field.Distances[Index]) continue;
+
+		const int32 X = Index % GridSize;
+		const int32 Y = Index / GridSize;
+		for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+		{
+			if (!CanStep(Field, X, Y, Direction)) continue;
+
+			const int32 Neighbour = (Y + OffsetsY[Direction]) * GridSize + X + OffsetsX[Direction];
+			if (const uint16 Distance = static_cast<uint16>(FMath::Min<int32>(Open.Key + StepCosts[Direction], MAX_uint16 - 1));
+				Distance < Field.Distances[Neighbour])
+			{
+				Field.Distances[Neighbour] = Distance;
+				Field.FlowDirections[Neighbour] = OppositeDirections[Direction];
+				OpenCells.HeapPush(TPair<uint16, int32>(Distance, Neighbour), Closer);
+			}
+		}
+	}
+}
+
+bool UPursuitFieldSubsystem::IsFieldReady(const FPursuitField& Field) const
+{
+	return Field.Distances.Num() == GridSize * GridSize;
+}
+
+bool UPursuitFieldSubsystem::GetSteeringDirection(const FPursuitField& Field, const FVector& Location, const FVector& TargetLocation, FVector& OutDirection) const
+{
+	using namespace PursuitField;
+
+	const FIntPoint Cell = GetWorldCell(Location);
+	const int32 Index = GetCellIndex(Field.FlowOrigin, Cell);
+	if (Index == INDEX_NONE || Field.Distances[Index] == MAX_uint16) return false;
+
+	// Head for the next cell's centre, or straight for the target once next to it
+	FVector Goal = TargetLocation;
+	if (const uint8 Direction = Field.FlowDirections[Index];
+		Direction != MAX_uint8 && Field.Distances[Index] > StepCosts[NumDirections - 1])
+	{
+		Goal.X = (Cell.X + OffsetsX[Direction] + 0.5) * CellSize;
+		Goal.Y = (Cell.Y + OffsetsY[Direction] + 0.5) * CellSize;
+	}
+	OutDirection = (Goal - Location).GetSafeNormal2D();
+	return !OutDirection.IsZero();
+}
+
+void UPursuitFieldSubsystem::SetOnField(FChaser& Chaser, bool bOnField)
+{
+	if (Chaser.bOnField == bOnField) return;
+	Chaser.bOnField = bOnField;
+	if (AEnemy* Enemy = Chaser.Enemy.Get())
+	{
+		Enemy->SetPursuitSteering(bOnField);
+	}
+}
+
+TStatId UPursuitFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPursuitFieldSubsystem, STATGROUP_Tickables);
+}
+
+bool UPursuitFieldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,312 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FX/EffectPlayerSubsystem.h"
+
+#include "NiagaraComponent.h"
+#include "NiagaraFunctionLibrary.h"
+#include "NiagaraSystem.h"
+#include "Slash.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/AudioComponent.h"
+#include "Debug/SlashStats.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/WorldSettings.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Effect Tick"), STAT_FX_Tick, STATGROUP_SlashFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effects Playing"), STAT_FX_NumPlaying, STATGROUP_SlashFX);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Components"), STAT_FX_NumComponents, STATGROUP_SlashFX);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Effects Spawned"), STAT_FX_NumSpawned, STATGROUP_SlashFX);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Effects Reused"), STAT_FX_NumReused, STATGROUP_SlashFX);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Effects Culled"), STAT_FX_NumCulled, STATGROUP_SlashFX);
+
+static TAutoConsoleVariable<int32> CVarFXMaxPerEffect(
+	TEXT("Slash.FX.MaxPerEffect"),
+	8,
+	TEXT("Most instances of one particle system or sound playing at once.  Also the most components pooled for it."));
+
+static TAutoConsoleVariable<float> CVarFXCullDistance(
+	TEXT("Slash.FX.CullDistance"),
+	6000,
+	TEXT("Distance from the camera beyond which effects aren't played, halved for low importance effects.  0 plays effects at any distance."));
+
+static TAutoConsoleVariable<int32> CVarFXSpawnBudget(
+	TEXT("Slash.FX.SpawnBudget"),
+	16,
+	TEXT("Most effects started per frame, further effects that frame are culled."));
+
+void UEffectPlayerSubsystem::Deinitialize()
+{
+	for (FEffectPool& Pool : Pools)
+	{
+		for (USceneComponent* Component : Pool.Components)
+		{
+			if (Component)
+			{
+				Component->DestroyComponent();
+			}
+		}
+	}
+	Pools.Empty();
+	PoolIndices.Empty();
+	Super::Deinitialize();
+}
+
+void UEffectPlayerSubsystem::PlaySystemAtLocation(const UObject* WorldContextObject, UFXSystemAsset* System, const FVector& Location,
+	EEffectImportance Importance)
+{
+	if (!System) return;
+
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (UEffectPlayerSubsystem* EffectPlayer = World ? World->GetSubsystem<UEffectPlayerSubsystem>() : nullptr)
+	{
+		EffectPlayer->Play(System, Location, Importance);
+	}
+	else if (UNiagaraSystem* NiagaraSystem = Cast<UNiagaraSystem>(System))
+	{
+		UNiagaraFunctionLibrary::SpawnSystemAtLocation(WorldContextObject, NiagaraSystem, Location);
+	}
+	else if (UParticleSystem* ParticleSystem = Cast<UParticleSystem>(System))
+	{
+		UGameplayStatics::SpawnEmitterAtLocation(WorldContextObject, ParticleSystem, Location);
+	}
+}
+
+void UEffectPlayerSubsystem::PlaySoundAtLocation(const UObject* WorldContextObject, USoundBase* Sound, const FVector& Location,
+	EEffectImportance Importance)
+{
+	if (!Sound) return;
+
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (UEffectPlayerSubsystem* EffectPlayer = World ? World->GetSubsystem<UEffectPlayerSubsystem>() : nullptr)
+	{
+		EffectPlayer->Play(Sound, Location, Importance);
+	}
+	else
+	{
+		UGameplayStatics::PlaySoundAtLocation(WorldContextObject, Sound, Location);
+	}
+}
+
+bool UEffectPlayerSubsystem::Play(UObject* Asset, const FVector& Location, EEffectImportance Importance)
+{
+	if (ShouldCull(Location, Importance))
+	{
+		++NumCulled;
+		INC_DWORD_STAT(STAT_FX_NumCulled);
+		return false;
+	}
+
+	FEffectPool* FoundPool;
+	if (const int32* PoolIndex = PoolIndices.Find(Asset))
+	{
+		FoundPool = &Pools[*PoolIndex];
+	}
+	else
+	{
+		PoolIndices.Add(Asset, Pools.Num());
+		FoundPool = &Pools.AddDefaulted_GetRef();
+		FoundPool->Asset = Asset;
+	}
+	FEffectPool& Pool = *FoundPool;
+
+	int32 ComponentIndex;
+	if (Pool.Free.Num() > 0)
+	{
+		ComponentIndex = Pool.Free.Pop(false);
+		++NumReused;
+		INC_DWORD_STAT(STAT_FX_NumReused);
+	}
+	else if (Pool.Components.Num() < FMath::Max(CVarFXMaxPerEffect.GetValueOnGameThread(), 1))
+	{
+		USceneComponent* Component = CreateComponent(Asset);
+		if (!Component) return false;
+
+		ComponentIndex = Pool.Components.Add(Component);
+		++NumSpawned;
+		INC_DWORD_STAT(STAT_FX_NumSpawned);
+	}
+	else if (Importance == EEffectImportance::Always && Pool.Playing.Num() > 0)
+	{
+		// Restart the oldest instance here rather than drop an effect that must play
+		ComponentIndex = Pool.Playing[0];
+		Pool.Playing.RemoveAt(0, 1, false);
+		StopComponent(Pool.Components[ComponentIndex]);
+		++NumReused;
+		INC_DWORD_STAT(STAT_FX_NumReused);
+	}
+	else
+	{
+		++NumCulled;
+		INC_DWORD_STAT(STAT_FX_NumCulled);
+		return false;
+	}
+
+	StartComponent(Pool.Components[ComponentIndex], Location);
+	Pool.Playing.Add(ComponentIndex);
+	++NumStartedThisFrame;
+	return true;
+}
+
+bool UEffectPlayerSubsystem::ShouldCull(const FVector& Location, EEffectImportance Importance) const
+{
+	if (Importance == EEffectImportance::Always) return false;
+	if (NumStartedThisFrame >= CVarFXSpawnBudget.GetValueOnGameThread()) return true;
+
+	double CullDistance = CVarFXCullDistance.GetValueOnGameThread();
+	if (!ViewLocation.IsSet() || CullDistance <= 0) return false;
+
+	if (Importance == EEffectImportance::Low)
+	{
+		CullDistance /= 2;
+	}
+	return FVector::DistSquared(Location, ViewLocation.GetValue()) > FMath::Square(CullDistance);
+}
+
+USceneComponent* UEffectPlayerSubsystem::CreateComponent(UObject* Asset)
+{
+	UWorld* World = GetWorld();
+	// Owned by the world settings like components spawned by UGameplayStatics, so they live as long as the world
+	UObject* Outer = World->GetWorldSettings() ? static_cast<UObject*>(World->GetWorldSettings()) : World;
+	USceneComponent* Component = nullptr;
+	if (UNiagaraSystem* NiagaraSystem = Cast<UNiagaraSystem>(Asset))
+	{
+		UNiagaraComponent* NiagaraComponent = NewObject<UNiagaraComponent>(Outer);
+		NiagaraComponent->SetAsset(NiagaraSystem);
+		NiagaraComponent->SetAutoDestroy(false);
+		Component = NiagaraComponent;
+	}
+	else if (UParticleSystem* ParticleSystem = Cast<UParticleSystem>(Asset))
+	{
+		UParticleSystemComponent* ParticleSystemComponent = NewObject<UParticleSystemComponent>(Outer);
+		ParticleSystemComponent->SetTemplate(ParticleSystem);
+		ParticleSystemComponent->bAutoDestroy = false;
+		Component = ParticleSystemComponent;
+	}
+	else if (USoundBase* Sound = Cast<USoundBase>(Asset))
+	{
+		UAudioComponent* AudioComponent = NewObject<UAudioComponent>(Outer);
+		AudioComponent->SetSound(Sound);
+		AudioComponent->bAutoDestroy = false;
+		AudioComponent->bAllowSpatialization = true;
+		Component = AudioComponent;
+	}
+	if (!Component) return nullptr;
+
+	Component->bAutoActivate = false;
+	Component->RegisterComponentWithWorld(World);
+	return Component;
+}
+
+void UEffectPlayerSubsystem::StartComponent(USceneComponent* Component, const FVector& Location)
+{
+	Component->SetWorldLocation(Location);
+	if (UAudioComponent* AudioComponent = Cast<UAudioComponent>(Component))
+	{
+		AudioComponent->Play();
+	}
+	else if (UParticleSystemComponent* ParticleSystemComponent = Cast<UParticleSystemComponent>(Component))
+	{
+		ParticleSystemComponent->ActivateSystem(true);
+	}
+	else
+	{
+		Component->Activate(true);
+	}
+}
+
+void UEffectPlayerSubsystem::StopComponent(USceneComponent* Component)
+{
+	if (UAudioComponent* AudioComponent = Cast<UAudioComponent>(Component))
+	{
+		AudioComponent->Stop();
+	}
+	else if (UFXSystemComponent* FXComponent = Cast<UFXSystemComponent>(Component))
+	{
+		FXComponent->DeactivateImmediate();
+	}
+}
+
+bool UEffectPlayerSubsystem::IsComponentPlaying(USceneComponent* Component)
+{
+	if (const UAudioComponent* AudioComponent = Cast<UAudioComponent>(Component))
+	{
+		return AudioComponent->IsPlaying();
+	}
+	if (UParticleSystemComponent* ParticleSystemComponent = Cast<UParticleSystemComponent>(Component))
+	{
+		return !ParticleSystemComponent->HasCompleted();
+	}
+	return Component->IsActive();
+}
+
+void UEffectPlayerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FX_Tick);
+
+	NumStartedThisFrame = 0;
+	ViewLocation.Reset();
+	if (const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController(); PlayerController && PlayerController->PlayerCameraManager)
+	{
+		ViewLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+	}
+
+	// Finished components go back to their pools
+	int32 NumPlaying = 0;
+	int32 NumComponents = 0;
+	for (FEffectPool& Pool : Pools)
+	{
+		for (int32 i = Pool.Playing.Num() - 1; i >= 0; --i)
+		{
+			const int32 ComponentIndex = Pool.Playing[i];
+			if (USceneComponent* Component = Pool.Components[ComponentIndex]; !Component || !IsComponentPlaying(Component))
+			{
+				Pool.Playing.RemoveAt(i, 1, false);
+				if (Component)
+				{
+					Pool.Free.Add(ComponentIndex);
+				}
+			}
+		}
+		NumPlaying += Pool.Playing.Num();
+		NumComponents += Pool.Components.Num();
+	}
+	SET_DWORD_STAT(STAT_FX_NumPlaying, NumPlaying);
+	SET_DWORD_STAT(STAT_FX_NumComponents, NumComponents);
+}
+
+void UEffectPlayerSubsystem::DumpStats() const
+{
+	int32 NumComponents = 0;
+	for (const FEffectPool& Pool : Pools)
+	{
+		NumComponents += Pool.Components.Num();
+		UE_LOG(LogSlash, Display, TEXT("  %s: %d components, %d playing"), *GetNameSafe(Pool.Asset), Pool.Components.Num(), Pool.Playing.Num());
+	}
+	UE_LOG(LogSlash, Display, TEXT("Effects: %lld spawned, %lld reused, %lld culled, %d components in %d pools"),
+		NumSpawned, NumReused, NumCulled, NumComponents, Pools.Num());
+}
+
+TStatId UEffectPlayerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEffectPlayerSubsystem, STATGROUP_Tickables);
+}
+
+bool UEffectPlayerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorld EffectStatsCommand(
+	TEXT("Slash.FX.Stats"),
+	TEXT("Log spawned, reused and culled effect counts and effect pool sizes."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UEffectPlayerSubsystem* EffectPlayer = World ? World->GetSubsystem<UEffectPlayerSubsystem>() : nullptr)
+		{
+			EffectPlayer->DumpStats();
+		}
+	}));
@@ -3,3 +3,13 @@
 
 #include "HUD/HealthBar.h"
 
+#include "Components/ProgressBar.h"
+
+void UHealthBar::SetHealthPercent(float Percent)
+{
+	if (HealthBar)
+	{
+		HealthBar->SetPercent(Percent);
+	}
+}
+
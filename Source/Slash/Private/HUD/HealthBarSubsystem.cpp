@@ -0,0 +1,228 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HUD/HealthBarSubsystem.h"
+
+#include "SceneView.h"
+#include "Debug/SlashStats.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/GameViewportClient.h"
+#include "GameFramework/PlayerController.h"
+#include "HUD/HealthBar.h"
+
+DECLARE_CYCLE_STAT(TEXT("Health Bar Tick"), STAT_HealthBar_Tick, STATGROUP_SlashHUD);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Health Bars Shown"), STAT_HealthBar_NumShown, STATGROUP_SlashHUD);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Health Bars Drawn"), STAT_HealthBar_NumDrawn, STATGROUP_SlashHUD);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Health Bar Widgets"), STAT_HealthBar_NumWidgets, STATGROUP_SlashHUD);
+
+static TAutoConsoleVariable<int32> CVarHealthBarMaxVisible(
+	TEXT("Slash.HealthBar.MaxVisible"),
+	8,
+	TEXT("Most health bars drawn at once, nearest to the camera first.  Also the most health bar widgets created."));
+
+static TAutoConsoleVariable<float> CVarHealthBarMaxDistance(
+	TEXT("Slash.HealthBar.MaxDistance"),
+	3000,
+	TEXT("Distance from the camera beyond which health bars aren't drawn."));
+
+static TAutoConsoleVariable<float> CVarHealthBarHeightOffset(
+	TEXT("Slash.HealthBar.HeightOffset"),
+	30,
+	TEXT("Height above the top of an actor's collision health bars are drawn at."));
+
+void UHealthBarSubsystem::Deinitialize()
+{
+	for (UHealthBar* Widget : Widgets)
+	{
+		if (Widget)
+		{
+			Widget->RemoveFromParent();
+		}
+	}
+	Widgets.Empty();
+	FreeWidgets.Empty();
+	Bars.Empty();
+	BarIndices.Empty();
+	Super::Deinitialize();
+}
+
+void UHealthBarSubsystem::SetWidgetClass(APlayerController* PlayerController, TSubclassOf<UHealthBar> WidgetClass)
+{
+	if (HealthBarClass == WidgetClass && OwningPlayer == PlayerController) return;
+
+	// Widgets of the old class or player are dropped, bars pick up new ones on the next tick
+	for (FActorBar& Bar : Bars)
+	{
+		Bar.Widget = INDEX_NONE;
+	}
+	for (UHealthBar* Widget : Widgets)
+	{
+		if (Widget)
+		{
+			Widget->RemoveFromParent();
+		}
+	}
+	Widgets.Empty();
+	FreeWidgets.Empty();
+	HealthBarClass = WidgetClass;
+	OwningPlayer = PlayerController;
+}
+
+void UHealthBarSubsystem::ShowHealthBar(AActor* Actor, float Percent)
+{
+	if (!Actor) return;
+
+	if (BarIndices.Contains(Actor))
+	{
+		SetHealthPercent(Actor, Percent);
+		return;
+	}
+	BarIndices.Add(Actor, Bars.Add({ Actor, Actor, Percent }));
+}
+
+void UHealthBarSubsystem::SetHealthPercent(AActor* Actor, float Percent)
+{
+	const int32* BarIndex = BarIndices.Find(Actor);
+	if (!BarIndex) return;
+
+	FActorBar& Bar = Bars[*BarIndex];
+	Bar.Percent = Percent;
+	if (Bar.Widget != INDEX_NONE)
+	{
+		Widgets[Bar.Widget]->SetHealthPercent(Percent);
+	}
+}
+
+void UHealthBarSubsystem::HideHealthBar(AActor* Actor)
+{
+	if (const int32* BarIndex = BarIndices.Find(Actor))
+	{
+		RemoveBar(*BarIndex);
+	}
+}
+
+void UHealthBarSubsystem::RemoveBar(int32 BarIndex)
+{
+	ReleaseWidget(Bars[BarIndex]);
+	BarIndices.Remove(Bars[BarIndex].Key);
+	Bars.RemoveAtSwap(BarIndex, 1, false);
+	if (Bars.IsValidIndex(BarIndex))
+	{
+		BarIndices[Bars[BarIndex].Key] = BarIndex;
+	}
+}
+
+void UHealthBarSubsystem::ReleaseWidget(FActorBar& Bar)
+{
+	if (Bar.Widget == INDEX_NONE) return;
+
+	if (UHealthBar* Widget = Widgets[Bar.Widget])
+	{
+		Widget->SetVisibility(ESlateVisibility::Collapsed);
+	}
+	FreeWidgets.Add(Bar.Widget);
+	Bar.Widget = INDEX_NONE;
+}
+
+bool UHealthBarSubsystem::AssignWidget(FActorBar& Bar)
+{
+	if (FreeWidgets.Num() == 0)
+	{
+		APlayerController* PlayerController = OwningPlayer.Get();
+		UHealthBar* Widget = PlayerController ? CreateWidget<UHealthBar>(PlayerController, HealthBarClass) : nullptr;
+		if (!Widget) return false;
+
+		Widget->SetAlignmentInViewport(FVector2D(0.5, 1));
+		Widget->AddToViewport(-1);
+		FreeWidgets.Add(Widgets.Add(Widget));
+	}
+
+	Bar.Widget = FreeWidgets.Pop(false);
+	UHealthBar* Widget = Widgets[Bar.Widget];
+	Widget->SetHealthPercent(Bar.Percent);
+	Widget->SetVisibility(ESlateVisibility::HitTestInvisible);
+	return true;
+}
+
+void UHealthBarSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HealthBar_Tick);
+
+	for (int32 BarIndex = Bars.Num() - 1; BarIndex >= 0; --BarIndex)
+	{
+		if (!Bars[BarIndex].Actor.IsValid())
+		{
+			RemoveBar(BarIndex);
+		}
+	}
+	SET_DWORD_STAT(STAT_HealthBar_NumShown, Bars.Num());
+	SET_DWORD_STAT(STAT_HealthBar_NumWidgets, Widgets.Num());
+	SET_DWORD_STAT(STAT_HealthBar_NumDrawn, 0);
+
+	const APlayerController* PlayerController = OwningPlayer.Get();
+	ULocalPlayer* LocalPlayer = PlayerController ? PlayerController->GetLocalPlayer() : nullptr;
+	if (Bars.Num() == 0 || !HealthBarClass || !LocalPlayer || !LocalPlayer->ViewportClient) return;
+
+	// One view projection for every bar, rather than a projection set up per widget
+	FSceneViewProjectionData ProjectionData;
+	if (!LocalPlayer->GetProjectionData(LocalPlayer->ViewportClient->Viewport, ProjectionData)) return;
+	const FMatrix ViewProjection = ProjectionData.ComputeViewProjectionMatrix();
+	const FIntRect ViewRect = ProjectionData.GetConstrainedViewRect();
+
+	struct FCandidate
+	{
+		int32 BarIndex;
+		double DistanceSquared;
+		FVector2D ScreenPosition;
+	};
+	TArray<FCandidate, TInlineAllocator<32>> Candidates;
+	const double MaxDistanceSquared = FMath::Square(CVarHealthBarMaxDistance.GetValueOnGameThread());
+	const float HeightOffset = CVarHealthBarHeightOffset.GetValueOnGameThread();
+	for (int32 BarIndex = 0; BarIndex < Bars.Num(); ++BarIndex)
+	{
+		const AActor* Actor = Bars[BarIndex].Actor.Get();
+		const FVector Anchor = Actor->GetActorLocation() + FVector(0, 0, Actor->GetSimpleCollisionHalfHeight() + HeightOffset);
+		const double DistanceSquared = FVector::DistSquared(Anchor, ProjectionData.ViewOrigin);
+		if (FVector2D ScreenPosition; DistanceSquared <= MaxDistanceSquared
+			&& FSceneView::ProjectWorldToScreen(Anchor, ViewRect, ViewProjection, ScreenPosition)
+			&& ViewRect.Contains(FIntPoint(ScreenPosition.X, ScreenPosition.Y)))
+		{
+			Candidates.Add({ BarIndex, DistanceSquared, ScreenPosition });
+		}
+	}
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.DistanceSquared < B.DistanceSquared; });
+	const int32 NumDrawn = FMath::Min(Candidates.Num(), FMath::Max(CVarHealthBarMaxVisible.GetValueOnGameThread(), 0));
+
+	// Bars no longer among the nearest give their widgets back before the nearest take one
+	TBitArray<> Drawn(false, Bars.Num());
+	for (int32 i = 0; i < NumDrawn; ++i)
+	{
+		Drawn[Candidates[i].BarIndex] = true;
+	}
+	for (int32 BarIndex = 0; BarIndex < Bars.Num(); ++BarIndex)
+	{
+		if (!Drawn[BarIndex])
+		{
+			ReleaseWidget(Bars[BarIndex]);
+		}
+	}
+	for (int32 i = 0; i < NumDrawn; ++i)
+	{
+		FActorBar& Bar = Bars[Candidates[i].BarIndex];
+		if (Bar.Widget == INDEX_NONE && !AssignWidget(Bar)) break;
+		Widgets[Bar.Widget]->SetPositionInViewport(Candidates[i].ScreenPosition);
+	}
+
+	SET_DWORD_STAT(STAT_HealthBar_NumDrawn, NumDrawn);
+	SET_DWORD_STAT(STAT_HealthBar_NumWidgets, Widgets.Num());
+}
+
+TStatId UHealthBarSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHealthBarSubsystem, STATGROUP_Tickables);
+}
+
+bool UHealthBarSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -3,8 +3,17 @@
 
 #include "HUD/SlashHUD.h"
 
+#include "Asset/AssetMacros.h"
+#include "HUD/HealthBar.h"
+#include "HUD/HealthBarSubsystem.h"
 #include "HUD/SlashOverlay.h"
 
+ASlashHUD::ASlashHUD()
+{
+	// Default health bar widget, Blueprints may override it
+	LOAD_CLASS_TO_VARIABLE(UHealthBar, "/Game/Blueprints/HUD/WBP_HealthBar", HealthBarClass);
+}
+
 void ASlashHUD::BeginPlay()
 {
 	Super::BeginPlay();
@@ -17,6 +26,10 @@ void ASlashHUD::BeginPlay()
 				SlashOverlay = CreateWidget<USlashOverlay>(PlayerController, SlashOverlayClass);
 				SlashOverlay->AddToViewport();
 			}
+			if (UHealthBarSubsystem* HealthBars = World->GetSubsystem<UHealthBarSubsystem>(); HealthBars && HealthBarClass)
+			{
+				HealthBars->SetWidgetClass(PlayerController, HealthBarClass);
+			}
 		}
 	}
 	
@@ -3,13 +3,18 @@
 
 #include "HUD/SlashOverlay.h"
 
+#include "Components/AttributeComponent.h"
 #include "Components/ProgressBar.h"
 #include "Components/TextBlock.h"
+#include "Debug/SlashStats.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Overlay Updates"), STAT_Overlay_NumUpdates, STATGROUP_SlashHUD);
 
 void USlashOverlay::SetHealthPercent(float Percent)
 {
 	if (HealthBar)
 	{
+		INC_DWORD_STAT(STAT_Overlay_NumUpdates);
 		HealthBar->SetPercent(Percent);
 	}
 }
@@ -18,6 +23,7 @@ void USlashOverlay::SetStaminaPercent(float Percent)
 {
 	if (StaminaBar)
 	{
+		INC_DWORD_STAT(STAT_Overlay_NumUpdates);
 		StaminaBar->SetPercent(Percent);
 	}
 }
@@ -26,6 +32,7 @@ void USlashOverlay::SetGold(int32 Gold)
 {
 	if (GoldCount)
 	{
+		INC_DWORD_STAT(STAT_Overlay_NumUpdates);
 		GoldCount->SetText(FText::AsNumber(Gold));
 	}
 }
@@ -34,6 +41,61 @@ void USlashOverlay::SetSouls(int32 Souls)
 {
 	if (SoulsCount)
 	{
+		INC_DWORD_STAT(STAT_Overlay_NumUpdates);
 		SoulsCount->SetText(FText::AsNumber(Souls));
 	}
 }
+
+void USlashOverlay::BindAttributes(UAttributeComponent* Attributes)
+{
+	UnbindAttributes();
+	if (!Attributes) return;
+
+	BoundAttributes = Attributes;
+	Attributes->OnHealthChanged.AddUObject(this, &USlashOverlay::OnHealthChanged);
+	Attributes->OnStaminaChanged.AddUObject(this, &USlashOverlay::OnStaminaChanged);
+	Attributes->OnGoldChanged.AddUObject(this, &USlashOverlay::OnGoldChanged);
+	Attributes->OnSoulsChanged.AddUObject(this, &USlashOverlay::OnSoulsChanged);
+	SetHealthPercent(Attributes->GetHealthPercent());
+	SetStaminaPercent(Attributes->GetStaminaPercent());
+	SetGold(Attributes->GetGold());
+	SetSouls(Attributes->GetSouls());
+}
+
+void USlashOverlay::UnbindAttributes()
+{
+	if (UAttributeComponent* Attributes = BoundAttributes.Get())
+	{
+		Attributes->OnHealthChanged.RemoveAll(this);
+		Attributes->OnStaminaChanged.RemoveAll(this);
+		Attributes->OnGoldChanged.RemoveAll(this);
+		Attributes->OnSoulsChanged.RemoveAll(this);
+	}
+	BoundAttributes.Reset();
+}
+
+void USlashOverlay::NativeDestruct()
+{
+	UnbindAttributes();
+	Super::NativeDestruct();
+}
+
+void USlashOverlay::OnHealthChanged(UAttributeComponent* Attributes, float OldHealth, float NewHealth)
+{
+	SetHealthPercent(Attributes->GetHealthPercent());
+}
+
+void USlashOverlay::OnStaminaChanged(UAttributeComponent* Attributes, float OldStamina, float NewStamina)
+{
+	SetStaminaPercent(Attributes->GetStaminaPercent());
+}
+
+void USlashOverlay::OnGoldChanged(UAttributeComponent* Attributes, int32 OldGold, int32 NewGold)
+{
+	SetGold(NewGold);
+}
+
+void USlashOverlay::OnSoulsChanged(UAttributeComponent* Attributes, int32 OldSouls, int32 NewSouls)
+{
+	SetSouls(NewSouls);
+}
@@ -5,10 +5,10 @@
 
 #include "Components/SphereComponent.h"
 #include "NiagaraComponent.h"
-#include "NiagaraFunctionLibrary.h"
 #include "Asset/AssetMacros.h"
+#include "FX/EffectPlayerSubsystem.h"
 #include "Interfaces/PickupInterface.h"
-#include "Kismet/GameplayStatics.h"
+#include "Spatial/SpatialHashSubsystem.h"
 
 AItem::AItem()
 {
@@ -35,6 +35,47 @@ void AItem::BeginPlay()
 	// Bind our callback to SphereComponent's OnComponentBeginOverlap event
 	SphereComponent->OnComponentBeginOverlap.AddDynamic(this, &AItem::OnSphereBeginOverlap);
 	SphereComponent->OnComponentEndOverlap.AddDynamic(this, &AItem::OnSphereEndOverlap);
+
+	if (USpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<USpatialHashSubsystem>())
+	{
+		SpatialHash->RegisterActor(this, ESpatialHashCategory::Pickup);
+	}
+}
+
+void AItem::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<USpatialHashSubsystem>())
+	{
+		SpatialHash->UnregisterActor(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void AItem::OnAcquiredFromPool()
+{
+	RunningTime = 0;
+	ItemState = EItemState::Hovering;
+	SphereComponent->SetCollisionEnabled(GetClass()->GetDefaultObject<AItem>()->SphereComponent->GetCollisionEnabled());
+	if (GlowParticles)
+	{
+		GlowParticles->Activate(true);
+	}
+	if (USpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<USpatialHashSubsystem>())
+	{
+		SpatialHash->RegisterActor(this, ESpatialHashCategory::Pickup);
+	}
+}
+
+void AItem::OnReleasedToPool()
+{
+	if (GlowParticles)
+	{
+		GlowParticles->Deactivate();
+	}
+	if (USpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<USpatialHashSubsystem>())
+	{
+		SpatialHash->UnregisterActor(this);
+	}
 }
 
 float AItem::TransformedSin()
@@ -70,7 +111,8 @@ void AItem::SpawnPickupSystem()
 {
 	if (PickupEffect)
 	{
-		UNiagaraFunctionLibrary::SpawnSystemAtLocation(this, PickupEffect, GetActorLocation());
+		// Pickups are the player's doing, so always shown
+		UEffectPlayerSubsystem::PlaySystemAtLocation(this, PickupEffect, GetActorLocation(), EEffectImportance::Always);
 	}
 }
 
@@ -78,7 +120,7 @@ void AItem::PlayPickupSound()
 {
 	if (PickupSound)
 	{
-		UGameplayStatics::SpawnSoundAtLocation(this, PickupSound, GetActorLocation());
+		UEffectPlayerSubsystem::PlaySoundAtLocation(this, PickupSound, GetActorLocation(), EEffectImportance::Always);
 	}
 }
 
@@ -6,6 +6,7 @@
 #include "NiagaraSystem.h"
 #include "Asset/AssetMacros.h"
 #include "Interfaces/PickupInterface.h"
+#include "Pooling/ActorPoolSubsystem.h"
 
 ASoul::ASoul()
 {
@@ -22,6 +23,6 @@ void ASoul::OnSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActo
 		PickupInterface->AddSouls(this);
 		SpawnPickupSystem();
 		PlayPickupSound();
-		Destroy();
+		UActorPoolSubsystem::ReleaseActor(this);
 	}
 }
@@ -6,6 +6,7 @@
 #include "Asset/AssetMacros.h"
 #include "Components/SphereComponent.h"
 #include "Interfaces/PickupInterface.h"
+#include "Pooling/ActorPoolSubsystem.h"
 
 ATreasure::ATreasure()
 {
@@ -24,6 +25,6 @@ void ATreasure::OnSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, A
 		PickupInterface->AddGold(this);
 		PlayPickupSound();
 		// Despawn
-		Destroy();
+		UActorPoolSubsystem::ReleaseActor(this);
 	}
 }
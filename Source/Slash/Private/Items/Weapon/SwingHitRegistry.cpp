@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Items/Weapon/SwingHitRegistry.h"
+
+namespace SwingHitRegistry
+{
+	/// Hits kept from earlier swings before they are emptied out, few enough to be cheap to keep around
+	constexpr int32 MaxStaleHits = 64;
+}
+
+uint32 FSwingHitRegistry::BeginSwing()
+{
+	if (Hits.Num() > SwingHitRegistry::MaxStaleHits)
+	{
+		Hits.Reset();
+	}
+	return ++SwingId;
+}
+
+bool FSwingHitRegistry::TryRegisterHit(const AActor* Actor, double Time, EWeaponHitPolicy Policy, double RehitInterval)
+{
+	FHitRecord& Record = Hits.FindOrAdd(Actor, FHitRecord{ SwingId - 1, 0 });
+	if (Record.SwingId == SwingId
+		&& (Policy == EWeaponHitPolicy::OncePerSwing || Time - Record.Time < RehitInterval)) return false;
+
+	Record = { SwingId, Time };
+	return true;
+}
+
+bool FSwingHitRegistry::WasHit(const AActor* Actor) const
+{
+	const FHitRecord* Record = Hits.Find(Actor);
+	return Record && Record->SwingId == SwingId;
+}
@@ -5,15 +5,39 @@
 
 #include "NiagaraComponent.h"
 #include "Asset/AssetMacros.h"
-#include "Character/CharacterTypes.h"
+#include "Character/BaseCharacter.h"
+#include "Combat/DamageQueueSubsystem.h"
 #include "Components/BoxComponent.h"
 #include "Components/SphereComponent.h"
-#include "Enemy/EnemyTypes.h"
-#include "Interfaces/HitInterface.h"
+#include "Debug/BenchmarkTimers.h"
+#include "Debug/CombatTelemetry.h"
+#include "Debug/SlashStats.h"
+#include "Items/Weapon/WeaponTraceSubsystem.h"
 #include "Kismet/GameplayStatics.h"
+#include "Spatial/SpatialHashSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Swing Sweep"), STAT_Weapon_SwingSweep, STATGROUP_SlashWeapon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Swing Sweeps"), STAT_Weapon_NumSweeps, STATGROUP_SlashWeapon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Swing Hits"), STAT_Weapon_NumHits, STATGROUP_SlashWeapon);
+
+static TAutoConsoleVariable<float> CVarSwingSubstepRate(
+	TEXT("Slash.Weapon.SwingSubstepRate"),
+	120,
+	TEXT("Blade samples per second of swing swept for hits, independent of the frame rate."));
+
+namespace Weapon
+{
+	/// Most sub-steps swept in one frame, longer hitches are caught up in one sweep
+	constexpr int32 MaxSubstepsPerFrame = 16;
+}
 
 AWeapon::AWeapon()
 {
+	// Swings are traced once the owner's animation has posed the blade for the frame
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+	// Only ticks to float as a pickup or trace a swing, see UpdateTickEnabled
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
 	// Default equip sound
 	LOAD_ASSET_TO_VARIABLE(USoundBase, "/Game/Audio/MetaSounds/SFX_Shink", EquipSound);
 
@@ -27,10 +51,9 @@ AWeapon::AWeapon()
 	CollisionBox->InitBoxExtent(FVector(3, 2.2, 40));
 	CollisionBox->SetRelativeLocation(FVector(0, 0, 12.4));
 	
-	// Default to no collision at the start
+	// Only sizes the blade for swing sweeps, see SweepBlade
 	CollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Overlap);
-	//CollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Ignore);
+	CollisionBox->SetGenerateOverlapEvents(false);
 	// Positions will be set in BP
 	BoxTraceStart = CreateDefaultSubobject<USceneComponent>("BoxTraceStart");
 	BoxTraceStart->SetupAttachment(ItemMesh);
@@ -38,6 +61,12 @@ AWeapon::AWeapon()
 	BoxTraceEnd->SetupAttachment(ItemMesh);
 }
 
+void AWeapon::BeginPlay()
+{
+	Super::BeginPlay();
+	UpdateTickEnabled();
+}
+
 void AWeapon::PlayEquipSound()
 {
 	if (EquipSound)
@@ -46,13 +75,6 @@ void AWeapon::PlayEquipSound()
 	}
 }
 
-void AWeapon::BeginPlay()
-{
-	Super::BeginPlay();
-
-	CollisionBox->OnComponentBeginOverlap.AddDynamic(this, &AWeapon::OnBoxBeginOverlap);
-}
-
 void AWeapon::Equip(USceneComponent* SceneComponent, FName InSocketName, TObjectPtr<AActor> OwnerActor, TObjectPtr<APawn> InstigatorActor)
 {
 	SetOwner(OwnerActor);
@@ -61,6 +83,7 @@ void AWeapon::Equip(USceneComponent* SceneComponent, FName InSocketName, TObject
 	{
 		AttachMeshToComponent(SceneComponent, InSocketName);
 		ItemState = EItemState::Equipped;
+		UpdateTickEnabled();
 		PlayEquipSound();
 		if (SphereComponent)
 		{
@@ -71,53 +94,184 @@ void AWeapon::Equip(USceneComponent* SceneComponent, FName InSocketName, TObject
 		{
 			GlowParticles->Deactivate();
 		}
+		// Equipped weapons are no longer pickups
+		if (USpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<USpatialHashSubsystem>())
+		{
+			SpatialHash->UnregisterActor(this);
+		}
 	}
 }
 
+void AWeapon::OnAcquiredFromPool()
+{
+	Super::OnAcquiredFromPool();
+	// Owner and instigator are those given to AcquireActor, until equipped by someone else
+	ResetMeshAttachment();
+	bSwinging = false;
+	NumSwingHits = INDEX_NONE;
+	TraceSubsystem = nullptr;
+	UpdateTickEnabled();
+}
+
+void AWeapon::OnReleasedToPool()
+{
+	Super::OnReleasedToPool();
+	bSwinging = false;
+	RecordSwingHits();
+	// Sweeps still being traced are dropped
+	HitRegistry.BeginSwing();
+	// Take the mesh back from whoever had it equipped, so it doesn't follow them while pooled
+	ResetMeshAttachment();
+	SetInstigator(nullptr);
+}
+
+void AWeapon::ResetMeshAttachment()
+{
+	ItemMesh->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+	ItemMesh->SetRelativeTransform(GetClass()->GetDefaultObject<AWeapon>()->ItemMesh->GetRelativeTransform());
+}
+
 void AWeapon::AttachMeshToComponent(USceneComponent* SceneComponent, FName InSocketName)
 {
 	ItemMesh->AttachToComponent(SceneComponent, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, false), InSocketName);
 }
 
-bool AWeapon::ActorSameTagAsOwner(AActor* OtherActor, FName Tag)
+void AWeapon::Tick(float DeltaTime)
 {
-	return GetOwner()->ActorHasTag(Tag) && OtherActor->ActorHasTag(Tag);
+	Super::Tick(DeltaTime);
+	if (!bSwinging || DeltaTime <= 0) return;
+
+	// Sub-steps fall at fixed times from the start of the swing, so they don't depend on the frame rate
+	const FBladeSample Current = SampleBlade();
+	const float FrameStartTime = SwingTime;
+	SwingTime += DeltaTime;
+	const float SubstepTime = 1 / FMath::Max(CVarSwingSubstepRate.GetValueOnGameThread(), 1.f);
+	int32 NumSubsteps = 0;
+	while (SampledTime + SubstepTime <= SwingTime)
+	{
+		if (++NumSubsteps > Weapon::MaxSubstepsPerFrame)
+		{
+			// Catch up in one sweep after a long hitch
+			SweepBlade(SweptSample, Current);
+			SweptSample = Current;
+			SampledTime = SwingTime;
+			break;
+		}
+		SampledTime += SubstepTime;
+		// Blade pose at the sub-step, interpolated between the previous frame's and this frame's
+		const float Alpha = (SampledTime - FrameStartTime) / DeltaTime;
+		const FBladeSample Sample{ FMath::Lerp(FrameSample.Start, Current.Start, Alpha), FMath::Lerp(FrameSample.End, Current.End, Alpha) };
+		SweepBlade(SweptSample, Sample);
+		SweptSample = Sample;
+	}
+	FrameSample = Current;
 }
 
-void AWeapon::OnBoxBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp,
-                                int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AWeapon::BeginSwing()
 {
+	TraceSubsystem = GetWorld()->GetSubsystem<UWeaponTraceSubsystem>();
+	RecordSwingHits();
+	NumSwingHits = 0;
+	SLASH_TELEMETRY_COUNT(Swings, 1);
+	HitRegistry.BeginSwing();
+	bSwinging = true;
+	UpdateTickEnabled();
+	SwingTime = 0;
+	SampledTime = 0;
+	FrameSample = SweptSample = SampleBlade();
+	// Catch anything already touching the blade as the window opens
+	SweepBlade(SweptSample, SweptSample);
+}
+
+void AWeapon::EndSwing()
+{
+	if (!bSwinging) return;
+
+	bSwinging = false;
+	UpdateTickEnabled();
+	// Hits are kept until the next swing, as the last sweeps' results may still be on their way
+	SweepBlade(SweptSample, SampleBlade());
+}
+
+void AWeapon::UpdateTickEnabled()
+{
+	SetActorTickEnabled(bSwinging || ItemState == EItemState::Hovering);
+}
+
+void AWeapon::RecordSwingHits()
+{
+	if (NumSwingHits != INDEX_NONE)
+	{
+		SLASH_TELEMETRY_SAMPLE(HitsPerSwing, 0, NumSwingHits);
+		NumSwingHits = INDEX_NONE;
+	}
+}
+
+AWeapon::FBladeSample AWeapon::SampleBlade() const
+{
+	return { BoxTraceStart->GetComponentLocation(), BoxTraceEnd->GetComponentLocation() };
+}
+
+void AWeapon::SweepBlade(const FBladeSample& From, const FBladeSample& To)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Weapon_SwingSweep);
+	SCOPE_BENCHMARK_TIMER(WeaponSwing);
+	INC_DWORD_STAT(STAT_Weapon_NumSweeps);
+
+	// The blade is a box from start to end, as wide as the collision box, swept between the two samples
+	const FVector Axis = (From.End - From.Start) + (To.End - To.Start);
+	const double HalfLength = FMath::Max(FVector::Dist(From.Start, From.End), FVector::Dist(To.Start, To.End)) / 2;
+	const FVector HalfExtent(CollisionBox->GetScaledBoxExtent().X, CollisionBox->GetScaledBoxExtent().Y, HalfLength);
+	const FQuat Rotation = FRotationMatrix::MakeFromZ(Axis).ToQuat();
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(WeaponSwing), false, this);
+	QueryParams.AddIgnoredActor(GetOwner());
+	// Actors already hit are filtered by the hit registry rather than ignored by the sweep
+	const FVector Start = (From.Start + From.End) / 2;
+	const FVector End = (To.Start + To.End) / 2;
+	if (TraceSubsystem)
+	{
+		TraceSubsystem->QueueSweep(this, HitRegistry.GetSwingId(), Start, End, Rotation, HalfExtent, QueryParams);
+		return;
+	}
+
+	TArray<FHitResult> HitResults;
+	GetWorld()->SweepMultiByObjectType(HitResults, Start, End, Rotation,
+		FCollisionObjectQueryParams(FCollisionObjectQueryParams::AllObjects), FCollisionShape::MakeBox(HalfExtent), QueryParams);
+	ApplySweepHits(HitRegistry.GetSwingId(), HitResults);
+}
+
+void AWeapon::ApplySweepHits(uint32 InSwingId, TArray<FHitResult>& HitResults)
+{
+	if (InSwingId != HitRegistry.GetSwingId()) return;
+
+	// Earliest contact first, so the order hits are dealt in doesn't depend on the physics scene
+	HitResults.Sort([](const FHitResult& A, const FHitResult& B) { return A.Time < B.Time; });
+	for (const FHitResult& HitResult : HitResults)
+	{
+		ReportHit(HitResult);
+	}
+}
+
+void AWeapon::ReportHit(const FHitResult& HitResult)
+{
+	AActor* HitActor = HitResult.GetActor();
 	// Enemies cannot hurt other enemies
 	// SlashCharacters cannot hurt other SlashCharacters
-	if (ActorSameTagAsOwner(OtherActor, EnemyTag) || ActorSameTagAsOwner(OtherActor, SlashCharacterTag)) return;
-	CollisionIgnoreActors.Add(GetOwner());
-	// Ignore the owner of this weapon, or if we already hit the other actor during a single attack
-	if (!CollisionIgnoreActors.Contains(OtherActor))
+	if (!HitActor
+		|| !ABaseCharacter::IdentityOf(GetOwner()).CanHurt(ABaseCharacter::IdentityOf(HitActor))
+		|| HitActor == GetOwner()
+		|| !HitRegistry.TryRegisterHit(HitActor, GetWorld()->GetTimeSeconds(), HitPolicy, RehitIntervalMs / 1000)) return;
+
+	INC_DWORD_STAT(STAT_Weapon_NumHits);
+	if (SlashBenchmark::bTimersEnabled)
 	{
-		const FVector Start = BoxTraceStart->GetComponentLocation();
-		const FVector End = BoxTraceEnd->GetComponentLocation();
-		const FVector BoxHalfSize = FVector(CollisionBox->GetScaledBoxExtent().X, CollisionBox->GetScaledBoxExtent().Y, 5);
-		FHitResult HitResult;
-		// Note: trace type query is for custom traces, which we aren't using here so just pick any
-		UKismetSystemLibrary::BoxTraceSingle(this, Start, End, BoxHalfSize, BoxTraceStart->GetComponentRotation(),
-			ETraceTypeQuery::TraceTypeQuery1, false, CollisionIgnoreActors, EDrawDebugTrace::None, HitResult, true);
-
-		if (AActor* HitActor = HitResult.GetActor();
-			HitActor
-			&& !ActorSameTagAsOwner(HitActor, EnemyTag)
-			&& !ActorSameTagAsOwner(HitActor, SlashCharacterTag)
-			&& HitActor != GetOwner()
-			&& !CollisionIgnoreActors.Contains(HitActor))
-		{
-			UGameplayStatics::ApplyDamage(HitActor, Damage, GetInstigator()->GetController(), this, UDamageType::StaticClass());
-			
-			if (IHitInterface* HitInterface = Cast<IHitInterface>(HitActor))
-			{
-				HitInterface->Execute_GetHit(HitActor, HitResult.ImpactPoint, GetOwner());
-			}
-			// Hitting terrain generates a physics field too
-			CreateFields(HitResult.ImpactPoint);
-			CollisionIgnoreActors.AddUnique(HitActor);
-		}
+		++SlashBenchmark::NumWeaponHits;
 	}
+	++NumSwingHits;
+	SLASH_TELEMETRY_COUNT(Hits, 1);
+	SLASH_TELEMETRY_SAMPLE(DamagePerHit, 0, Damage);
+
+	// Terrain is hit too, for the physics field it generates
+	UDamageQueueSubsystem::QueueHit(GetWorld(), HitActor, this, Damage, HitResult.ImpactPoint);
 }
@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Items/Weapon/WeaponTraceSubsystem.h"
+
+#include "Debug/BenchmarkTimers.h"
+#include "Debug/SlashStats.h"
+#include "Items/Weapon/Weapon.h"
+
+DECLARE_CYCLE_STAT(TEXT("Trace Batch"), STAT_Weapon_TraceBatch, STATGROUP_SlashWeapon);
+DECLARE_CYCLE_STAT(TEXT("Trace Wait"), STAT_Weapon_TraceWait, STATGROUP_SlashWeapon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Traces This Frame"), STAT_Weapon_NumTraces, STATGROUP_SlashWeapon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Late Trace Results"), STAT_Weapon_NumLateResults, STATGROUP_SlashWeapon);
+
+static TAutoConsoleVariable<bool> CVarWeaponAsyncTraces(
+	TEXT("Slash.Weapon.AsyncTraces"),
+	true,
+	TEXT("Trace weapon sweeps asynchronously, applying hits on the next tick.  Off traces and applies them on the game thread in the frame they are queued."));
+
+void UWeaponTraceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UWeaponTraceSubsystem::OnWorldTickStart);
+	// Weapons sweep in TG_PostUpdateWork, so the frame's sweeps are only all queued once every actor has ticked
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UWeaponTraceSubsystem::OnWorldPostActorTick);
+}
+
+void UWeaponTraceSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	Queued.Empty();
+	Issued.Empty();
+	Super::Deinitialize();
+}
+
+void UWeaponTraceSubsystem::QueueSweep(AWeapon* Weapon, uint32 SwingId, const FVector& Start, const FVector& End, const FQuat& Rotation,
+	const FVector& HalfExtent, const FCollisionQueryParams& QueryParams)
+{
+	Queued.Add({ Weapon, SwingId, Start, End, Rotation, HalfExtent, QueryParams, FTraceHandle() });
+}
+
+void UWeaponTraceSubsystem::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld()) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_Weapon_TraceBatch);
+	NumTraces = 0;
+	ApplyIssuedSweeps();
+}
+
+void UWeaponTraceSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld()) return;
+
+	FlushQueuedSweeps();
+}
+
+void UWeaponTraceSubsystem::FlushQueuedSweeps()
+{
+	// Flushed again after the damage queue flushed it, with nothing left to do
+	if (Queued.Num() == 0) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_Weapon_TraceBatch);
+	NumTraces += Queued.Num();
+
+	if (CVarWeaponAsyncTraces.GetValueOnGameThread())
+	{
+		IssueQueuedSweeps();
+	}
+	else
+	{
+		TraceQueuedSweeps();
+	}
+	SET_DWORD_STAT(STAT_Weapon_NumTraces, NumTraces);
+}
+
+void UWeaponTraceSubsystem::ApplyIssuedSweeps()
+{
+	WaitMs = 0;
+	if (Issued.Num() == 0) return;
+
+	UWorld* World = GetWorld();
+	TArray<TArray<FHitResult>> Results;
+	Results.SetNum(Issued.Num());
+	{
+		SCOPE_CYCLE_COUNTER(STAT_Weapon_TraceWait);
+		SCOPE_BENCHMARK_TIMER(WeaponTraceWait);
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Issued.Num(); ++i)
+		{
+			FTraceDatum TraceDatum;
+			if (!World->QueryTraceData(Issued[i].Handle, TraceDatum))
+			{
+				// Normally finished by the start of the next world tick, unless the batch was issued too late for it
+				INC_DWORD_STAT(STAT_Weapon_NumLateResults);
+				World->WaitForAllAsyncTraceTasks();
+				World->QueryTraceData(Issued[i].Handle, TraceDatum);
+			}
+			Results[i] = MoveTemp(TraceDatum.OutHits);
+		}
+		WaitMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+	}
+
+	// Applying hits can queue more sweeps or release weapons, so the issued list is let go of first
+	TArray<FQueuedSweep> Applied = MoveTemp(Issued);
+	Issued.Reset();
+	for (int32 i = 0; i < Applied.Num(); ++i)
+	{
+		if (AWeapon* Weapon = Applied[i].Weapon.Get())
+		{
+			Weapon->ApplySweepHits(Applied[i].SwingId, Results[i]);
+		}
+	}
+}
+
+void UWeaponTraceSubsystem::IssueQueuedSweeps()
+{
+	UWorld* World = GetWorld();
+	const FCollisionObjectQueryParams ObjectQueryParams(FCollisionObjectQueryParams::AllObjects);
+	for (FQueuedSweep& Sweep : Queued)
+	{
+		Sweep.Handle = World->AsyncSweepByObjectType(EAsyncTraceType::Multi, Sweep.Start, Sweep.End, Sweep.Rotation,
+			ObjectQueryParams, FCollisionShape::MakeBox(Sweep.HalfExtent), Sweep.QueryParams);
+	}
+	Issued.Append(MoveTemp(Queued));
+	Queued.Reset();
+}
+
+void UWeaponTraceSubsystem::TraceQueuedSweeps()
+{
+	SCOPE_BENCHMARK_TIMER(WeaponSwing);
+	UWorld* World = GetWorld();
+	const FCollisionObjectQueryParams ObjectQueryParams(FCollisionObjectQueryParams::AllObjects);
+	TArray<FQueuedSweep> Traced = MoveTemp(Queued);
+	Queued.Reset();
+	for (const FQueuedSweep& Sweep : Traced)
+	{
+		AWeapon* Weapon = Sweep.Weapon.Get();
+		if (!Weapon) continue;
+
+		TArray<FHitResult> HitResults;
+		World->SweepMultiByObjectType(HitResults, Sweep.Start, Sweep.End, Sweep.Rotation, ObjectQueryParams,
+			FCollisionShape::MakeBox(Sweep.HalfExtent), Sweep.QueryParams);
+		Weapon->ApplySweepHits(Sweep.SwingId, HitResults);
+	}
+}
+
+bool UWeaponTraceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pooling/ActorPoolSubsystem.h"
+
+#include "Slash.h"
+#include "Debug/SlashStats.h"
+#include "Engine/World.h"
+#include "Interfaces/PoolableInterface.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pool Hits"), STAT_Pool_NumHits, STATGROUP_SlashPool);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pool Misses"), STAT_Pool_NumMisses, STATGROUP_SlashPool);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Actors"), STAT_Pool_NumPooled, STATGROUP_SlashPool);
+DECLARE_CYCLE_STAT(TEXT("Acquire"), STAT_Pool_Acquire, STATGROUP_SlashPool);
+DECLARE_CYCLE_STAT(TEXT("Release"), STAT_Pool_Release, STATGROUP_SlashPool);
+
+static TAutoConsoleVariable<bool> CVarPoolEnabled(
+	TEXT("Slash.Pool.Enabled"),
+	true,
+	TEXT("If true, poolable actors are reused instead of destroyed and spawned again."));
+
+static TAutoConsoleVariable<int32> CVarPoolMaxPerClass(
+	TEXT("Slash.Pool.MaxPerClass"),
+	64,
+	TEXT("Maximum number of actors waiting in the pool of each class, more are destroyed when released."));
+
+AActor* UActorPoolSubsystem::Acquire(UClass* Class, const FTransform& Transform, AActor* Owner, APawn* Instigator)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Pool_Acquire);
+	if (!Class) return nullptr;
+
+	FClassPool& Pool = Pools.FindOrAdd(Class);
+	while (Pool.Free.Num() > 0)
+	{
+		AActor* Actor = Pool.Free.Pop(false).Get();
+		// Pooled actors can still be destroyed from outside, e.g. by level streaming
+		if (!IsValid(Actor)) continue;
+
+		PooledActors.Remove(Actor);
+		DEC_DWORD_STAT(STAT_Pool_NumPooled);
+		++Pool.NumHits;
+		INC_DWORD_STAT(STAT_Pool_NumHits);
+
+		Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+		Actor->SetOwner(Owner);
+		Actor->SetInstigator(Instigator);
+		Actor->SetActorHiddenInGame(false);
+		Actor->SetActorEnableCollision(true);
+		Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+		Cast<IPoolableInterface>(Actor)->OnAcquiredFromPool();
+		return Actor;
+	}
+
+	++Pool.NumMisses;
+	INC_DWORD_STAT(STAT_Pool_NumMisses);
+	return SpawnForPool(Class, Transform, Owner, Instigator);
+}
+
+void UActorPoolSubsystem::Release(AActor* Actor)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Pool_Release);
+	if (!IsValid(Actor) || PooledActors.Contains(Actor)) return;
+
+	if (!CVarPoolEnabled.GetValueOnGameThread() || !Actor->Implements<UPoolableInterface>() || GetWorld()->bIsTearingDown)
+	{
+		Actor->Destroy();
+		return;
+	}
+
+	FClassPool& Pool = Pools.FindOrAdd(Actor->GetClass());
+	if (Pool.Free.Num() >= CVarPoolMaxPerClass.GetValueOnGameThread())
+	{
+		++Pool.NumOverflowed;
+		Actor->Destroy();
+		return;
+	}
+	++Pool.NumReleased;
+	Deactivate(Actor, Pool);
+}
+
+void UActorPoolSubsystem::Prewarm(UClass* Class, int32 Count)
+{
+	if (!Class || !Class->ImplementsInterface(UPoolableInterface::StaticClass()) || !CVarPoolEnabled.GetValueOnGameThread()) return;
+
+	FClassPool& Pool = Pools.FindOrAdd(Class);
+	Count = FMath::Min(Count, CVarPoolMaxPerClass.GetValueOnGameThread());
+	while (Pool.Free.Num() < Count)
+	{
+		AActor* Actor = SpawnForPool(Class, FTransform::Identity, nullptr, nullptr);
+		if (!Actor) break;
+		Deactivate(Actor, Pool);
+	}
+}
+
+int32 UActorPoolSubsystem::GetNumPooled(UClass* Class) const
+{
+	const FClassPool* Pool = Pools.Find(Class);
+	return Pool ? Pool->Free.Num() : 0;
+}
+
+AActor* UActorPoolSubsystem::AcquireActor(UWorld* World, UClass* Class, const FTransform& Transform, AActor* Owner, APawn* Instigator)
+{
+	if (!World || !Class) return nullptr;
+	if (UActorPoolSubsystem* ActorPool = World->GetSubsystem<UActorPoolSubsystem>();
+		ActorPool && CVarPoolEnabled.GetValueOnGameThread() && Class->ImplementsInterface(UPoolableInterface::StaticClass()))
+	{
+		return ActorPool->Acquire(Class, Transform, Owner, Instigator);
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = Owner;
+	SpawnParameters.Instigator = Instigator;
+	return World->SpawnActor<AActor>(Class, Transform, SpawnParameters);
+}
+
+void UActorPoolSubsystem::ReleaseActor(AActor* Actor)
+{
+	if (!IsValid(Actor)) return;
+	if (UActorPoolSubsystem* ActorPool = Actor->GetWorld() ? Actor->GetWorld()->GetSubsystem<UActorPoolSubsystem>() : nullptr)
+	{
+		ActorPool->Release(Actor);
+	}
+	else
+	{
+		Actor->Destroy();
+	}
+}
+
+bool UActorPoolSubsystem::IsPooled(const AActor* Actor)
+{
+	const UActorPoolSubsystem* ActorPool = Actor && Actor->GetWorld() ? Actor->GetWorld()->GetSubsystem<UActorPoolSubsystem>() : nullptr;
+	return ActorPool && ActorPool->PooledActors.Contains(Actor);
+}
+
+AActor* UActorPoolSubsystem::SpawnForPool(UClass* Class, const FTransform& Transform, AActor* Owner, APawn* Instigator) const
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = Owner;
+	SpawnParameters.Instigator = Instigator;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return GetWorld()->SpawnActor<AActor>(Class, Transform, SpawnParameters);
+}
+
+void UActorPoolSubsystem::Deactivate(AActor* Actor, FClassPool& Pool)
+{
+	// Hooks run first, while components are still active and registrations still valid
+	Cast<IPoolableInterface>(Actor)->OnReleasedToPool();
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	Actor->SetOwner(nullptr);
+
+	Pool.Free.Add(Actor);
+	PooledActors.Add(Actor);
+	INC_DWORD_STAT(STAT_Pool_NumPooled);
+}
+
+void UActorPoolSubsystem::DumpStats() const
+{
+	for (const TPair<TObjectKey<UClass>, FClassPool>& Entry : Pools)
+	{
+		const UClass* Class = Entry.Key.ResolveObjectPtr();
+		const FClassPool& Pool = Entry.Value;
+		const int32 NumAcquired = Pool.NumHits + Pool.NumMisses;
+		UE_LOG(LogSlash, Display, TEXT("Pool %s: %d waiting, %d hits, %d misses (%.1f%% hit rate), %d released, %d destroyed when full"),
+			Class ? *Class->GetName() : TEXT("<unloaded>"), Pool.Free.Num(), Pool.NumHits, Pool.NumMisses,
+			NumAcquired > 0 ? 100.f * Pool.NumHits / NumAcquired : 0.f, Pool.NumReleased, Pool.NumOverflowed);
+	}
+}
+
+bool UActorPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorld PoolDumpCommand(
+	TEXT("Slash.Pool.Dump"),
+	TEXT("Log actor pool sizes and hit rates per class."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UActorPoolSubsystem* ActorPool = World ? World->GetSubsystem<UActorPoolSubsystem>() : nullptr)
+		{
+			ActorPool->DumpStats();
+		}
+	}));
@@ -0,0 +1,853 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/CombatReplaySubsystem.h"
+
+#include "DrawDebugHelpers.h"
+#include "Slash.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Count.h"
+#include "Animation/AnimMontage.h"
+#include "Character/BaseCharacter.h"
+#include "Components/AttributeComponent.h"
+#include "Debug/BenchmarkTimers.h"
+#include "Debug/SlashStats.h"
+#include "Enemy/Enemy.h"
+#include "Enemy/EnemyTypes.h"
+#include "Engine/Engine.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+
+DECLARE_CYCLE_STAT(TEXT("Replay Record"), STAT_Replay_Record, STATGROUP_SlashReplay);
+DECLARE_CYCLE_STAT(TEXT("Replay Playback"), STAT_Replay_Playback, STATGROUP_SlashReplay);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Replay Bytes This Frame"), STAT_Replay_FrameBytes, STATGROUP_SlashReplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Replay Frames Dropped"), STAT_Replay_NumDropped, STATGROUP_SlashReplay);
+
+static TAutoConsoleVariable<float> CVarReplayKeyframeInterval(
+	TEXT("Slash.Replay.KeyframeInterval"),
+	2,
+	TEXT("Seconds between keyframes of a combat replay, the most playback applies to seek."));
+
+static TAutoConsoleVariable<int32> CVarReplayMaxPendingKB(
+	TEXT("Slash.Replay.MaxPendingKB"),
+	4096,
+	TEXT("Most kilobytes of a combat replay waiting to be written, frames beyond that are dropped."));
+
+namespace CombatReplay
+{
+	constexpr uint32 Magic = 0x50524C53;  // "SLRP"
+	constexpr uint32 Version = 1;
+	/// Bytes before the records of a frame: size, time and keyframe flag
+	constexpr int32 FrameHeaderSize = sizeof(uint32) + sizeof(float) + sizeof(uint8);
+	/// Id of actors that aren't characters, in hit records
+	constexpr uint16 NoId = MAX_uint16;
+	/// Smallest health or stamina change recorded
+	constexpr float AttributeTolerance = 0.05f;
+
+	enum class ERecord : uint8
+	{
+		/// uint16 Id, FString Name, uint8 bEnemy
+		DeclareCharacter,
+		/// uint16 Id, FString Name
+		DeclareName,
+		/// uint16 Id
+		RemoveCharacter,
+		/// uint16 Id, int32 X, Y, Z in centimetres, uint16 Yaw
+		Transform,
+		/// uint16 Id, float Health, float Stamina
+		Attributes,
+		/// uint16 Id, uint8 EEnemyState
+		EnemyState,
+		/// uint16 Id, uint16 Montage name, uint16 Section name
+		Montage,
+		/// uint16 Hitter, uint16 Target, float Damage, int32 X, Y, Z in centimetres
+		Hit,
+	};
+
+	FORCEINLINE FIntVector QuantizeLocation(const FVector& Location)
+	{
+		return FIntVector(FMath::RoundToInt32(Location.X), FMath::RoundToInt32(Location.Y), FMath::RoundToInt32(Location.Z));
+	}
+
+	FORCEINLINE FArchive& operator<<(FArchive& Ar, ERecord& Record)
+	{
+		return Ar << reinterpret_cast<uint8&>(Record);
+	}
+}
+
+FCombatReplayWriter::FCombatReplayWriter(const FString& Filename, int64 InMaxPendingBytes)
+	: MaxPendingBytes(InMaxPendingBytes)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+	File.Reset(PlatformFile.OpenWrite(*Filename));
+	if (!File) return;
+
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool();
+	Thread = FRunnableThread::Create(this, TEXT("CombatReplayWriter"), 0, TPri_BelowNormal);
+}
+
+FCombatReplayWriter::~FCombatReplayWriter()
+{
+	if (Thread)
+	{
+		// Stops the thread once everything submitted is written
+		Thread->Kill(true);
+		delete Thread;
+	}
+	if (WorkEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	}
+}
+
+bool FCombatReplayWriter::Submit(TArray<uint8>&& Frame)
+{
+	const int64 Size = Frame.Num();
+	if (PendingBytes.load() + Size > MaxPendingBytes) return false;
+
+	PendingBytes += Size;
+	Pending.Enqueue(MoveTemp(Frame));
+	WorkEvent->Trigger();
+	return true;
+}
+
+uint32 FCombatReplayWriter::Run()
+{
+	while (!bStopping)
+	{
+		WorkEvent->Wait();
+		WritePending();
+	}
+	WritePending();
+	File->Flush();
+	return 0;
+}
+
+void FCombatReplayWriter::Stop()
+{
+	bStopping = true;
+	WorkEvent->Trigger();
+}
+
+void FCombatReplayWriter::WritePending()
+{
+	TArray<uint8> Frame;
+	while (Pending.Dequeue(Frame))
+	{
+		File->Write(Frame.GetData(), Frame.Num());
+		PendingBytes -= Frame.Num();
+	}
+}
+
+void UCombatReplaySubsystem::Deinitialize()
+{
+	StopRecording();
+	StopPlayback();
+	Characters.Empty();
+	Super::Deinitialize();
+}
+
+void UCombatReplaySubsystem::RegisterCharacter(ABaseCharacter* Character)
+{
+	Characters.AddUnique(Character);
+}
+
+void UCombatReplaySubsystem::UnregisterCharacter(ABaseCharacter* Character)
+{
+	Characters.RemoveSwap(Character, false);
+	if (IsRecording())
+	{
+		if (int32 RecordedIndex; RecordedIndices.RemoveAndCopyValue(Character, RecordedIndex))
+		{
+			CombatReplay::ERecord Record = CombatReplay::ERecord::RemoveCharacter;
+			FrameWriter << Record << Recorded[RecordedIndex].Id;
+			// Dropped from Recorded when the frame ends, so indices stay valid until then
+			Recorded[RecordedIndex].Character.Reset();
+		}
+	}
+}
+
+bool UCombatReplaySubsystem::StartRecording(const FString& Filename)
+{
+	StopRecording();
+	StopPlayback();
+
+	Writer = MakeUnique<FCombatReplayWriter>(Filename, static_cast<int64>(FMath::Max(CVarReplayMaxPendingKB.GetValueOnGameThread(), 1)) * 1024);
+	if (!Writer->IsOpen())
+	{
+		UE_LOG(LogSlash, Error, TEXT("Combat replay could not open %s"), *Filename);
+		Writer.Reset();
+		return false;
+	}
+
+	TArray<uint8> Header;
+	FMemoryWriter HeaderWriter(Header);
+	uint32 Magic = CombatReplay::Magic;
+	uint32 Version = CombatReplay::Version;
+	HeaderWriter << Magic << Version;
+	Writer->Submit(MoveTemp(Header));
+
+	FrameBuffer.Reset();
+	FrameWriter.Seek(0);
+	FrameBuffer.AddZeroed(CombatReplay::FrameHeaderSize);
+	FrameWriter.Seek(CombatReplay::FrameHeaderSize);
+	RecordedIndices.Reset();
+	Recorded.Reset();
+	NameIds.Reset();
+	NextCharacterId = 0;
+	NextNameId = 0;
+	RecordingStartTime = GetWorld()->GetTimeSeconds();
+	bForceKeyframe = true;
+	NumFramesRecorded = 0;
+	NumFramesDropped = 0;
+	NumBytesRecorded = 0;
+	UE_LOG(LogSlash, Display, TEXT("Combat replay recording to %s"), *Filename);
+	return true;
+}
+
+void UCombatReplaySubsystem::StopRecording()
+{
+	if (!IsRecording()) return;
+
+	RecordFrame();
+	// Waits for everything submitted to be written
+	Writer.Reset();
+	UE_LOG(LogSlash, Display, TEXT("Combat replay recorded %d frames, %lld bytes, %d frames dropped"),
+		NumFramesRecorded, NumBytesRecorded, NumFramesDropped);
+}
+
+uint16 UCombatReplaySubsystem::GetCharacterId(const ABaseCharacter* Character)
+{
+	if (!Character) return CombatReplay::NoId;
+	if (const int32* RecordedIndex = RecordedIndices.Find(Character))
+	{
+		return Recorded[*RecordedIndex].Id;
+	}
+
+	FRecordedCharacter& NewRecorded = Recorded.AddDefaulted_GetRef();
+	NewRecorded.Character = const_cast<ABaseCharacter*>(Character);
+	NewRecorded.Key = Character;
+	NewRecorded.Id = NextCharacterId++;
+	NewRecorded.EnemyState = 0;
+	if (const AEnemy* Enemy = Cast<AEnemy>(Character))
+	{
+		NewRecorded.EnemyState = static_cast<uint8>(Enemy->GetEnemyState());
+	}
+	RecordedIndices.Add(Character, Recorded.Num() - 1);
+
+	CombatReplay::ERecord Record = CombatReplay::ERecord::DeclareCharacter;
+	FString Name = Character->GetName();
+	uint8 bEnemy = Character->IsA<AEnemy>();
+	FrameWriter << Record << NewRecorded.Id << Name << bEnemy;
+	RecordCharacterState(NewRecorded);
+	return NewRecorded.Id;
+}
+
+uint16 UCombatReplaySubsystem::GetNameId(FName Name)
+{
+	if (const uint16* NameId = NameIds.Find(Name))
+	{
+		return *NameId;
+	}
+
+	uint16 NameId = NextNameId++;
+	NameIds.Add(Name, NameId);
+	CombatReplay::ERecord Record = CombatReplay::ERecord::DeclareName;
+	FString NameString = Name.ToString();
+	FrameWriter << Record << NameId << NameString;
+	return NameId;
+}
+
+void UCombatReplaySubsystem::RecordCharacterState(FRecordedCharacter& State)
+{
+	const ABaseCharacter* Character = State.Character.Get();
+	if (!Character) return;
+
+	State.Location = CombatReplay::QuantizeLocation(Character->GetActorLocation());
+	State.Yaw = FRotator::CompressAxisToShort(Character->GetActorRotation().Yaw);
+	CombatReplay::ERecord Record = CombatReplay::ERecord::Transform;
+	FrameWriter << Record << State.Id << State.Location.X << State.Location.Y << State.Location.Z << State.Yaw;
+
+	const UAttributeComponent* Attributes = Character->GetAttributes();
+	State.Health = Attributes ? Attributes->GetHealth() : 0;
+	State.Stamina = Attributes ? Attributes->GetStamina() : 0;
+	Record = CombatReplay::ERecord::Attributes;
+	FrameWriter << Record << State.Id << State.Health << State.Stamina;
+
+	if (Character->IsA<AEnemy>())
+	{
+		Record = CombatReplay::ERecord::EnemyState;
+		FrameWriter << Record << State.Id << State.EnemyState;
+	}
+}
+
+void UCombatReplaySubsystem::RecordEnemyState(const AEnemy* Enemy, EEnemyState State)
+{
+	if (!IsRecording()) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_Replay_Record);
+	SCOPE_BENCHMARK_TIMER(ReplayRecord);
+	uint16 Id = GetCharacterId(Enemy);
+	uint8 StateValue = static_cast<uint8>(State);
+	Recorded[RecordedIndices[Enemy]].EnemyState = StateValue;
+	CombatReplay::ERecord Record = CombatReplay::ERecord::EnemyState;
+	FrameWriter << Record << Id << StateValue;
+}
+
+void UCombatReplaySubsystem::RecordMontage(const ABaseCharacter* Character, const UAnimMontage* Montage, FName SectionName)
+{
+	if (!IsRecording() || !Montage) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_Replay_Record);
+	SCOPE_BENCHMARK_TIMER(ReplayRecord);
+	uint16 Id = GetCharacterId(Character);
+	uint16 MontageId = GetNameId(Montage->GetFName());
+	uint16 SectionId = GetNameId(SectionName);
+	CombatReplay::ERecord Record = CombatReplay::ERecord::Montage;
+	FrameWriter << Record << Id << MontageId << SectionId;
+}
+
+void UCombatReplaySubsystem::RecordHit(const AActor* Hitter, const AActor* Target, float Damage, const FVector& ImpactPoint)
+{
+	if (!IsRecording()) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_Replay_Record);
+	SCOPE_BENCHMARK_TIMER(ReplayRecord);
+	uint16 HitterId = GetCharacterId(Cast<ABaseCharacter>(Hitter));
+	uint16 TargetId = GetCharacterId(Cast<ABaseCharacter>(Target));
+	FIntVector Impact = CombatReplay::QuantizeLocation(ImpactPoint);
+	CombatReplay::ERecord Record = CombatReplay::ERecord::Hit;
+	FrameWriter << Record << HitterId << TargetId << Damage << Impact.X << Impact.Y << Impact.Z;
+}
+
+void UCombatReplaySubsystem::RecordFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_Replay_Record);
+	SCOPE_BENCHMARK_TIMER(ReplayRecord);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	uint8 bKeyframe = bForceKeyframe || Now - LastKeyframeTime >= CVarReplayKeyframeInterval.GetValueOnGameThread();
+	if (bKeyframe)
+	{
+		LastKeyframeTime = Now;
+		bForceKeyframe = false;
+	}
+
+	for (const TWeakObjectPtr<ABaseCharacter>& CharacterPtr : Characters)
+	{
+		const ABaseCharacter* Character = CharacterPtr.Get();
+		if (!Character) continue;
+
+		const int32* RecordedIndex = RecordedIndices.Find(Character);
+		if (!RecordedIndex)
+		{
+			// Declaring writes its full state
+			GetCharacterId(Character);
+			continue;
+		}
+		FRecordedCharacter& State = Recorded[*RecordedIndex];
+		if (bKeyframe)
+		{
+			RecordCharacterState(State);
+			continue;
+		}
+
+		// Only what changed since the last frame
+		const FIntVector Location = CombatReplay::QuantizeLocation(Character->GetActorLocation());
+		uint16 Yaw = FRotator::CompressAxisToShort(Character->GetActorRotation().Yaw);
+		if (Location != State.Location || Yaw != State.Yaw)
+		{
+			State.Location = Location;
+			State.Yaw = Yaw;
+			CombatReplay::ERecord Record = CombatReplay::ERecord::Transform;
+			FrameWriter << Record << State.Id << State.Location.X << State.Location.Y << State.Location.Z << State.Yaw;
+		}
+		if (const UAttributeComponent* Attributes = Character->GetAttributes())
+		{
+			if (!FMath::IsNearlyEqual(Attributes->GetHealth(), State.Health, CombatReplay::AttributeTolerance)
+				|| !FMath::IsNearlyEqual(Attributes->GetStamina(), State.Stamina, CombatReplay::AttributeTolerance))
+			{
+				State.Health = Attributes->GetHealth();
+				State.Stamina = Attributes->GetStamina();
+				CombatReplay::ERecord Record = CombatReplay::ERecord::Attributes;
+				FrameWriter << Record << State.Id << State.Health << State.Stamina;
+			}
+		}
+	}
+
+	// Characters removed this frame
+	for (int32 i = Recorded.Num() - 1; i >= 0; --i)
+	{
+		if (!Recorded[i].Character.IsValid())
+		{
+			RecordedIndices.Remove(Recorded[i].Key);
+			Recorded.RemoveAtSwap(i, 1, false);
+			if (Recorded.IsValidIndex(i))
+			{
+				RecordedIndices[Recorded[i].Key] = i;
+			}
+		}
+	}
+
+	// Fill in the header and hand the frame over
+	uint32 Size = FrameBuffer.Num() - CombatReplay::FrameHeaderSize;
+	float Time = Now - RecordingStartTime;
+	FrameWriter.Seek(0);
+	FrameWriter << Size << Time << bKeyframe;
+	SET_DWORD_STAT(STAT_Replay_FrameBytes, FrameBuffer.Num());
+	const int32 NumBytes = FrameBuffer.Num();
+	if (Writer->Submit(MoveTemp(FrameBuffer)))
+	{
+		++NumFramesRecorded;
+		NumBytesRecorded += NumBytes;
+	}
+	else
+	{
+		// Characters and names declared in the frame are lost with it, so everything is declared again
+		++NumFramesDropped;
+		INC_DWORD_STAT(STAT_Replay_NumDropped);
+		RecordedIndices.Reset();
+		Recorded.Reset();
+		NameIds.Reset();
+		bForceKeyframe = true;
+	}
+
+	FrameBuffer.Reset();
+	FrameBuffer.AddZeroed(CombatReplay::FrameHeaderSize);
+	FrameWriter.Seek(CombatReplay::FrameHeaderSize);
+}
+
+bool UCombatReplaySubsystem::StartPlayback(const FString& Filename)
+{
+	StopRecording();
+	StopPlayback();
+
+	if (!FFileHelper::LoadFileToArray(PlaybackData, *Filename))
+	{
+		UE_LOG(LogSlash, Error, TEXT("Combat replay could not read %s"), *Filename);
+		return false;
+	}
+
+	FMemoryReader Reader(PlaybackData);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic << Version;
+	if (Magic != CombatReplay::Magic || Version != CombatReplay::Version)
+	{
+		UE_LOG(LogSlash, Error, TEXT("%s is not a combat replay of version %u"), *Filename, CombatReplay::Version);
+		PlaybackData.Empty();
+		return false;
+	}
+
+	// Index frames, declaring every character and name up front so seeking never needs earlier frames
+	while (Reader.Tell() + CombatReplay::FrameHeaderSize <= PlaybackData.Num())
+	{
+		uint32 Size;
+		float Time;
+		uint8 bKeyframe;
+		Reader << Size << Time << bKeyframe;
+		if (Reader.Tell() + Size > PlaybackData.Num()) break;
+
+		const FReplayFrame& Frame = PlaybackFrames.Add_GetRef({ Time, bKeyframe != 0, static_cast<int32>(Reader.Tell()), static_cast<int32>(Size) });
+		if (bKeyframe)
+		{
+			Keyframes.Add(PlaybackFrames.Num() - 1);
+		}
+		ApplyFrame(Frame, true);
+		Reader.Seek(Reader.Tell() + Size);
+	}
+	if (PlaybackFrames.Num() == 0)
+	{
+		UE_LOG(LogSlash, Error, TEXT("Combat replay %s has no frames"), *Filename);
+		StopPlayback();
+		return false;
+	}
+
+	UE_LOG(LogSlash, Display, TEXT("Combat replay playing %s: %d frames, %d keyframes, %.1f seconds"),
+		*Filename, PlaybackFrames.Num(), Keyframes.Num(), GetPlaybackLength());
+	bPlaybackPaused = false;
+	Seek(0);
+	return true;
+}
+
+void UCombatReplaySubsystem::StopPlayback()
+{
+	PlaybackData.Empty();
+	PlaybackFrames.Empty();
+	Keyframes.Empty();
+	PlaybackCharacters.Empty();
+	PlaybackNames.Empty();
+	PlaybackHits.Empty();
+	NextPlaybackFrame = 0;
+	PlaybackTime = 0;
+}
+
+float UCombatReplaySubsystem::GetPlaybackLength() const
+{
+	return PlaybackFrames.Num() > 0 ? PlaybackFrames.Last().Time : 0;
+}
+
+void UCombatReplaySubsystem::Seek(float Time)
+{
+	if (!IsPlaying()) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_Replay_Playback);
+	PlaybackTime = FMath::Clamp(Time, 0.f, GetPlaybackLength());
+
+	// Restore the last keyframe at or before the time, then play forward from it
+	const int32 KeyframeIndex = Algo::UpperBoundBy(Keyframes, PlaybackTime, [this](int32 Frame) { return PlaybackFrames[Frame].Time; }) - 1;
+	NextPlaybackFrame = Keyframes.IsValidIndex(KeyframeIndex) ? Keyframes[KeyframeIndex] : 0;
+	for (FReplayCharacter& Character : PlaybackCharacters)
+	{
+		Character.bPresent = false;
+		Character.Montage = NAME_None;
+		Character.Section = NAME_None;
+	}
+	PlaybackHits.Reset();
+	while (PlaybackFrames.IsValidIndex(NextPlaybackFrame) && PlaybackFrames[NextPlaybackFrame].Time <= PlaybackTime)
+	{
+		ApplyFrame(PlaybackFrames[NextPlaybackFrame++], false);
+	}
+}
+
+void UCombatReplaySubsystem::SetPlaybackPaused(bool bPaused)
+{
+	bPlaybackPaused = bPaused;
+}
+
+void UCombatReplaySubsystem::ApplyFrame(const FReplayFrame& Frame, bool bDeclarationsOnly)
+{
+	const TArrayView<const uint8> Records(PlaybackData.GetData() + Frame.Offset, Frame.Size);
+	FMemoryReaderView Reader(Records);
+	const auto FindCharacter = [this](uint16 Id) -> FReplayCharacter*
+	{
+		return PlaybackCharacters.IsValidIndex(Id) ? &PlaybackCharacters[Id] : nullptr;
+	};
+	const auto GetName = [this](uint16 NameId) { return PlaybackNames.IsValidIndex(NameId) ? PlaybackNames[NameId] : NAME_None; };
+
+	// Keyframes hold every character present, anyone missing was removed, maybe in a frame dropped while recording
+	if (Frame.bKeyframe && !bDeclarationsOnly)
+	{
+		for (FReplayCharacter& Character : PlaybackCharacters)
+		{
+			Character.bPresent = false;
+		}
+	}
+
+	while (!Reader.AtEnd() && !Reader.IsError())
+	{
+		CombatReplay::ERecord Record;
+		uint16 Id;
+		Reader << Record << Id;
+		switch (Record)
+		{
+		case CombatReplay::ERecord::DeclareCharacter:
+		{
+			FString Name;
+			uint8 bEnemy;
+			Reader << Name << bEnemy;
+			if (Id >= PlaybackCharacters.Num())
+			{
+				PlaybackCharacters.SetNum(Id + 1);
+			}
+			PlaybackCharacters[Id].Name = MoveTemp(Name);
+			PlaybackCharacters[Id].bEnemy = bEnemy != 0;
+			break;
+		}
+		case CombatReplay::ERecord::DeclareName:
+		{
+			FString Name;
+			Reader << Name;
+			if (Id >= PlaybackNames.Num())
+			{
+				PlaybackNames.SetNum(Id + 1);
+			}
+			PlaybackNames[Id] = FName(Name);
+			break;
+		}
+		case CombatReplay::ERecord::RemoveCharacter:
+			if (FReplayCharacter* Character = FindCharacter(Id); Character && !bDeclarationsOnly)
+			{
+				Character->bPresent = false;
+			}
+			break;
+		case CombatReplay::ERecord::Transform:
+		{
+			FIntVector Location;
+			uint16 Yaw;
+			Reader << Location.X << Location.Y << Location.Z << Yaw;
+			if (FReplayCharacter* Character = FindCharacter(Id); Character && !bDeclarationsOnly)
+			{
+				Character->bPresent = true;
+				Character->Location = FVector(Location);
+				Character->Yaw = FRotator::DecompressAxisFromShort(Yaw);
+			}
+			break;
+		}
+		case CombatReplay::ERecord::Attributes:
+		{
+			float Health;
+			float Stamina;
+			Reader << Health << Stamina;
+			if (FReplayCharacter* Character = FindCharacter(Id); Character && !bDeclarationsOnly)
+			{
+				Character->Health = Health;
+				Character->Stamina = Stamina;
+			}
+			break;
+		}
+		case CombatReplay::ERecord::EnemyState:
+		{
+			uint8 State;
+			Reader << State;
+			if (FReplayCharacter* Character = FindCharacter(Id); Character && !bDeclarationsOnly)
+			{
+				Character->EnemyState = State;
+			}
+			break;
+		}
+		case CombatReplay::ERecord::Montage:
+		{
+			uint16 MontageId;
+			uint16 SectionId;
+			Reader << MontageId << SectionId;
+			if (FReplayCharacter* Character = FindCharacter(Id); Character && !bDeclarationsOnly)
+			{
+				Character->Montage = GetName(MontageId);
+				Character->Section = GetName(SectionId);
+			}
+			break;
+		}
+		case CombatReplay::ERecord::Hit:
+		{
+			uint16 TargetId;
+			float Damage;
+			FIntVector Impact;
+			Reader << TargetId << Damage << Impact.X << Impact.Y << Impact.Z;
+			if (!bDeclarationsOnly)
+			{
+				PlaybackHits.Add({ FVector(Impact), Frame.Time });
+			}
+			break;
+		}
+		default:
+			UE_LOG(LogSlash, Error, TEXT("Combat replay has an unknown record %d at %.2f seconds"), static_cast<int32>(Record), Frame.Time);
+			return;
+		}
+	}
+}
+
+int32 UCombatReplaySubsystem::GetNumPresentCharacters() const
+{
+	return Algo::CountIf(PlaybackCharacters, [](const FReplayCharacter& Character) { return Character.bPresent; });
+}
+
+void UCombatReplaySubsystem::DrawPlayback() const
+{
+	UWorld* World = GetWorld();
+	const UEnum* EnemyStateEnum = StaticEnum<EEnemyState>();
+	for (const FReplayCharacter& Character : PlaybackCharacters)
+	{
+		if (!Character.bPresent) continue;
+
+		const FColor Color = Character.Health <= 0 ? FColor::Silver : Character.bEnemy ? FColor::Red : FColor::Green;
+		const FQuat Rotation = FRotator(0, Character.Yaw, 0).Quaternion();
+		DrawDebugCapsule(World, Character.Location, 88, 34, FQuat::Identity, Color);
+		DrawDebugDirectionalArrow(World, Character.Location, Character.Location + Rotation.GetForwardVector() * 80, 20, Color);
+
+		FString Label = FString::Printf(TEXT("%s\nHealth %.0f  Stamina %.0f"), *Character.Name, Character.Health, Character.Stamina);
+		if (Character.bEnemy)
+		{
+			Label += FString::Printf(TEXT("\n%s"), *EnemyStateEnum->GetNameStringByValue(Character.EnemyState));
+		}
+		if (!Character.Montage.IsNone())
+		{
+			Label += FString::Printf(TEXT("\n%s %s"), *Character.Montage.ToString(), *Character.Section.ToString());
+		}
+		DrawDebugString(World, Character.Location + FVector(0, 0, 110), Label, nullptr, Color, -1, true);
+	}
+	for (const FReplayHit& Hit : PlaybackHits)
+	{
+		DrawDebugPoint(World, Hit.ImpactPoint, 12, FColor::Yellow);
+	}
+}
+
+void UCombatReplaySubsystem::Tick(float DeltaTime)
+{
+	if (IsRecording())
+	{
+		RecordFrame();
+	}
+	if (!IsPlaying()) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_Replay_Playback);
+	if (!bPlaybackPaused)
+	{
+		PlaybackTime = FMath::Min(PlaybackTime + DeltaTime, GetPlaybackLength());
+		while (PlaybackFrames.IsValidIndex(NextPlaybackFrame) && PlaybackFrames[NextPlaybackFrame].Time <= PlaybackTime)
+		{
+			ApplyFrame(PlaybackFrames[NextPlaybackFrame++], false);
+		}
+	}
+	// Hits stay shown for half a second
+	PlaybackHits.RemoveAll([this](const FReplayHit& Hit) { return Hit.Time < PlaybackTime - 0.5f; });
+	DrawPlayback();
+}
+
+void UCombatReplaySubsystem::DumpStats() const
+{
+	if (IsRecording())
+	{
+		UE_LOG(LogSlash, Display, TEXT("Combat replay recording: %d frames, %lld bytes, %d frames dropped, %d characters"),
+			NumFramesRecorded, NumBytesRecorded, NumFramesDropped, Recorded.Num());
+	}
+	if (IsPlaying())
+	{
+		UE_LOG(LogSlash, Display, TEXT("Combat replay playing: %.1f of %.1f seconds%s, %d of %d characters present"),
+			PlaybackTime, GetPlaybackLength(), bPlaybackPaused ? TEXT(" (paused)") : TEXT(""), GetNumPresentCharacters(), PlaybackCharacters.Num());
+	}
+}
+
+TStatId UCombatReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatReplaySubsystem, STATGROUP_Tickables);
+}
+
+bool UCombatReplaySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayRecordCommand(
+	TEXT("Slash.Replay.Record"),
+	TEXT("Record a combat replay: Slash.Replay.Record [File], by default to Saved/Replays named by the date and time."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UCombatReplaySubsystem* Replay = World ? World->GetSubsystem<UCombatReplaySubsystem>() : nullptr)
+		{
+			Replay->StartRecording(Args.Num() > 0 ? Args[0]
+				: FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Replays"), FDateTime::Now().ToString() + TEXT(".slrp")));
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayPlayCommand(
+	TEXT("Slash.Replay.Play"),
+	TEXT("Play a combat replay: Slash.Replay.Play File"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UCombatReplaySubsystem* Replay = World ? World->GetSubsystem<UCombatReplaySubsystem>() : nullptr; Replay && Args.Num() > 0)
+		{
+			Replay->StartPlayback(Args[0]);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld ReplayStopCommand(
+	TEXT("Slash.Replay.Stop"),
+	TEXT("Stop recording or playing a combat replay."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UCombatReplaySubsystem* Replay = World ? World->GetSubsystem<UCombatReplaySubsystem>() : nullptr)
+		{
+			Replay->StopRecording();
+			Replay->StopPlayback();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ReplaySeekCommand(
+	TEXT("Slash.Replay.Seek"),
+	TEXT("Jump to a time in the combat replay being played: Slash.Replay.Seek Seconds"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UCombatReplaySubsystem* Replay = World ? World->GetSubsystem<UCombatReplaySubsystem>() : nullptr; Replay && Args.Num() > 0)
+		{
+			Replay->Seek(FCString::Atof(*Args[0]));
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayPauseCommand(
+	TEXT("Slash.Replay.Pause"),
+	TEXT("Pause or resume the combat replay being played: Slash.Replay.Pause [0/1], toggling without an argument."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UCombatReplaySubsystem* Replay = World ? World->GetSubsystem<UCombatReplaySubsystem>() : nullptr)
+		{
+			Replay->SetPlaybackPaused(Args.Num() > 0 ? FCString::Atoi(*Args[0]) != 0 : !Replay->IsPlaybackPaused());
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld ReplayStatsCommand(
+	TEXT("Slash.Replay.Stats"),
+	TEXT("Log combat replay recording or playback progress."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UCombatReplaySubsystem* Replay = World ? World->GetSubsystem<UCombatReplaySubsystem>() : nullptr)
+		{
+			Replay->DumpStats();
+		}
+	}));
+
+#if WITH_DEV_AUTOMATION_TESTS
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCombatReplayDroppedFrameTest, "Slash.Replay.DroppedFrame",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCombatReplayDroppedFrameTest::RunTest(const FString& Parameters)
+{
+	using namespace CombatReplay;
+
+	// A character declared as 0, then declared again as 1 by the keyframe forced after its removal was dropped
+	TArray<uint8> Data;
+	FMemoryWriter DataWriter(Data);
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	DataWriter << FileMagic << FileVersion;
+	const auto WriteFrame = [&DataWriter](float Time, uint8 bKeyframe, uint16 Id, bool bDeclare)
+	{
+		TArray<uint8> Records;
+		FMemoryWriter RecordWriter(Records);
+		ERecord Record;
+		if (bDeclare)
+		{
+			Record = ERecord::DeclareCharacter;
+			FString Name = TEXT("Enemy");
+			uint8 bEnemy = 1;
+			RecordWriter << Record << Id << Name << bEnemy;
+		}
+		Record = ERecord::Transform;
+		FIntVector Location(FMath::RoundToInt32(Time * 100), 0, 0);
+		uint16 Yaw = 0;
+		RecordWriter << Record << Id << Location.X << Location.Y << Location.Z << Yaw;
+		uint32 Size = Records.Num();
+		DataWriter << Size << Time << bKeyframe;
+		DataWriter.Serialize(Records.GetData(), Records.Num());
+	};
+	WriteFrame(0, true, 0, true);
+	WriteFrame(0.1f, false, 0, false);
+	WriteFrame(0.2f, true, 1, true);
+	const FString Filename = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("DroppedFrame.slrp"));
+	if (!TestTrue(TEXT("Replay written"), FFileHelper::SaveArrayToFile(Data, *Filename))) return false;
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	if (UCombatReplaySubsystem* Replay = World->GetSubsystem<UCombatReplaySubsystem>();
+		TestNotNull(TEXT("Replay subsystem"), Replay) && TestTrue(TEXT("Playback started"), Replay->StartPlayback(Filename)))
+	{
+		TestEqual(TEXT("Characters present at the start"), Replay->GetNumPresentCharacters(), 1);
+		// Played on rather than sought, which restored presence from keyframes already
+		Replay->Tick(0.25f);
+		TestEqual(TEXT("Characters present after the keyframe following the drop"), Replay->GetNumPresentCharacters(), 1);
+		Replay->StopPlayback();
+	}
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	IFileManager::Get().Delete(*Filename);
+	return true;
+}
+#endif
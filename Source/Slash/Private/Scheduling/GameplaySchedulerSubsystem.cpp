@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Scheduling/GameplaySchedulerSubsystem.h"
+
+#include "Debug/SlashStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Advance"), STAT_Scheduler_Advance, STATGROUP_SlashScheduler);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Timers"), STAT_Scheduler_NumActive, STATGROUP_SlashScheduler);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Timers Fired"), STAT_Scheduler_NumFired, STATGROUP_SlashScheduler);
+
+static TAutoConsoleVariable<float> CVarSchedulerTickRate(
+	TEXT("Slash.Scheduler.TickRate"),
+	120,
+	TEXT("Ticks per second of the gameplay timing wheel, timers fire on the first tick after they are due.\n")
+	TEXT("Read when a world starts."));
+
+void UGameplaySchedulerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Wheel = FTimingWheel(1 / FMath::Max(CVarSchedulerTickRate.GetValueOnGameThread(), 1.f));
+}
+
+void UGameplaySchedulerSubsystem::Deinitialize()
+{
+	Wheel.Reset();
+	Super::Deinitialize();
+}
+
+void UGameplaySchedulerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Scheduler_Advance);
+	Wheel.Advance(DeltaTime);
+	SET_DWORD_STAT(STAT_Scheduler_NumActive, Wheel.Num());
+	SET_DWORD_STAT(STAT_Scheduler_NumFired, Wheel.GetNumFiredLastAdvance());
+}
+
+TStatId UGameplaySchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGameplaySchedulerSubsystem, STATGROUP_Tickables);
+}
+
+bool UGameplaySchedulerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
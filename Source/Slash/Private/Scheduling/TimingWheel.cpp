@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Scheduling/TimingWheel.h"
+
+#include "Slash.h"
+#include "TimerManager.h"
+#include "UObject/Package.h"
+
+FTimingWheel::FTimingWheel(float InTickSeconds)
+	: TickSeconds(FMath::Max(InTickSeconds, UE_KINDA_SMALL_NUMBER))
+{
+	for (int32& Head : SlotHeads)
+	{
+		Head = INDEX_NONE;
+	}
+}
+
+void FTimingWheel::SetTimer(FScheduledTimerHandle& InOutHandle, UObject* Object, FScheduledTimerFunction Function, float Delay)
+{
+	ClearTimer(InOutHandle);
+	if (!Function) return;
+
+	const int32 Index = FreeNodes.Num() > 0 ? FreeNodes.Pop(false) : Nodes.AddDefaulted();
+	FTimerNode& Node = Nodes[Index];
+	Node.Object = Object;
+	Node.Function = Function;
+	// Count from the start of the current tick so timers never fire early, and always wait at least one tick.
+	// Negative delays fire on the next tick, clamped before converting so they don't wrap around
+	const int64 Ticks = FMath::CeilToInt64((FMath::Max(Delay, 0.f) + Accumulator) / TickSeconds);
+	const uint64 DelayTicks = FMath::Clamp<uint64>(FMath::Max<int64>(Ticks, 1), 1, MaxDelayTicks);
+	Node.ExpireTick = CurrentTick + DelayTicks;
+	Node.State = ENodeState::Scheduled;
+	Link(Index);
+	++NumActive;
+
+	InOutHandle.Index = Index;
+	InOutHandle.Generation = Node.Generation;
+}
+
+void FTimingWheel::ClearTimer(FScheduledTimerHandle& InOutHandle)
+{
+	if (FindNode(InOutHandle))
+	{
+		if (Nodes[InOutHandle.Index].State == ENodeState::Scheduled)
+		{
+			Unlink(InOutHandle.Index);
+		}
+		// Expired nodes are skipped when fired since their generation no longer matches
+		FreeNode(InOutHandle.Index);
+	}
+	InOutHandle.Invalidate();
+}
+
+bool FTimingWheel::IsTimerActive(const FScheduledTimerHandle& Handle) const
+{
+	return FindNode(Handle) != nullptr;
+}
+
+float FTimingWheel::GetTimerRemaining(const FScheduledTimerHandle& Handle) const
+{
+	if (const FTimerNode* Node = FindNode(Handle))
+	{
+		return FMath::Max((Node->ExpireTick - CurrentTick) * TickSeconds - Accumulator, 0.f);
+	}
+	return -1;
+}
+
+void FTimingWheel::Advance(float DeltaTime)
+{
+	Accumulator += DeltaTime;
+	const int64 Steps = FMath::FloorToInt64(Accumulator / TickSeconds);
+	Accumulator -= Steps * TickSeconds;
+
+	NumFired = 0;
+	if (NumActive == 0)
+	{
+		// Nothing to cascade or fire
+		CurrentTick += Steps;
+		return;
+	}
+	for (int64 i = 0; i < Steps; ++i)
+	{
+		Step();
+	}
+	FireExpired();
+}
+
+void FTimingWheel::Reset()
+{
+	// Nodes are kept so outstanding handles stay stale instead of matching reused nodes
+	for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+	{
+		if (Nodes[Index].State != ENodeState::Free)
+		{
+			FreeNode(Index);
+		}
+	}
+	Expired.Reset();
+	for (int32& Head : SlotHeads)
+	{
+		Head = INDEX_NONE;
+	}
+}
+
+const FTimingWheel::FTimerNode* FTimingWheel::FindNode(const FScheduledTimerHandle& Handle) const
+{
+	if (Nodes.IsValidIndex(Handle.Index))
+	{
+		const FTimerNode& Node = Nodes[Handle.Index];
+		if (Node.Generation == Handle.Generation && Node.State != ENodeState::Free)
+		{
+			return &Node;
+		}
+	}
+	return nullptr;
+}
+
+void FTimingWheel::Link(int32 Index)
+{
+	FTimerNode& Node = Nodes[Index];
+	// Lowest level whose span covers the delay
+	const uint64 Delta = Node.ExpireTick - CurrentTick;
+	int32 Level = 0;
+	while (Level < NumLevels - 1 && Delta >= uint64(1) << (SlotBits * (Level + 1)))
+	{
+		++Level;
+	}
+	Node.Slot = Level * SlotsPerLevel + ((Node.ExpireTick >> (SlotBits * Level)) & (SlotsPerLevel - 1));
+
+	Node.Prev = INDEX_NONE;
+	Node.Next = SlotHeads[Node.Slot];
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = Index;
+	}
+	SlotHeads[Node.Slot] = Index;
+}
+
+void FTimingWheel::Unlink(int32 Index)
+{
+	FTimerNode& Node = Nodes[Index];
+	if (Node.Prev != INDEX_NONE)
+	{
+		Nodes[Node.Prev].Next = Node.Next;
+	}
+	else
+	{
+		SlotHeads[Node.Slot] = Node.Next;
+	}
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = Node.Prev;
+	}
+	Node.Prev = Node.Next = Node.Slot = INDEX_NONE;
+}
+
+void FTimingWheel::FreeNode(int32 Index)
+{
+	FTimerNode& Node = Nodes[Index];
+	Node.Object.Reset();
+	Node.Function = nullptr;
+	Node.State = ENodeState::Free;
+	++Node.Generation;
+	FreeNodes.Add(Index);
+	--NumActive;
+}
+
+void FTimingWheel::Step()
+{
+	++CurrentTick;
+
+	// When a level wraps, the next slot of the level above comes due and moves down
+	for (int32 Level = 1; Level < NumLevels; ++Level)
+	{
+		if ((CurrentTick & ((uint64(1) << (SlotBits * Level)) - 1)) != 0) break;
+		Cascade(Level);
+	}
+
+	// Everything left in the current bottom slot expires on this tick
+	int32& Head = SlotHeads[CurrentTick & (SlotsPerLevel - 1)];
+	for (int32 Index = Head; Index != INDEX_NONE;)
+	{
+		FTimerNode& Node = Nodes[Index];
+		const int32 Next = Node.Next;
+		Node.Prev = Node.Next = Node.Slot = INDEX_NONE;
+		Node.State = ENodeState::Expired;
+		Expired.Emplace(Index, Node.Generation);
+		Index = Next;
+	}
+	Head = INDEX_NONE;
+}
+
+void FTimingWheel::Cascade(int32 Level)
+{
+	const int32 Slot = Level * SlotsPerLevel + ((CurrentTick >> (SlotBits * Level)) & (SlotsPerLevel - 1));
+	int32 Index = SlotHeads[Slot];
+	SlotHeads[Slot] = INDEX_NONE;
+	while (Index != INDEX_NONE)
+	{
+		const int32 Next = Nodes[Index].Next;
+		Link(Index);
+		Index = Next;
+	}
+}
+
+void FTimingWheel::FireExpired()
+{
+	// Timers fired here may arm or clear others, which only ever lands on later ticks
+	for (int32 i = 0; i < Expired.Num(); ++i)
+	{
+		const int32 Index = Expired[i].Key;
+		FTimerNode& Node = Nodes[Index];
+		if (Node.Generation != Expired[i].Value || Node.State != ENodeState::Expired) continue;
+
+		const TWeakObjectPtr<UObject> Object = Node.Object;
+		const FScheduledTimerFunction Function = Node.Function;
+		// Freed first so the handle is stale and can be re-armed from inside the callback
+		FreeNode(Index);
+		if (UObject* ObjectPtr = Object.Get())
+		{
+			Function(ObjectPtr);
+			++NumFired;
+		}
+	}
+	Expired.Reset();
+}
+
+/**
+ * Microbenchmark, run with `Slash.Scheduler.Benchmark [NumTimers] [NumFrames]`
+ */
+
+static int64 GNumBenchmarkTimersFired = 0;
+
+static void OnBenchmarkTimerFired(UObject*)
+{
+	++GNumBenchmarkTimersFired;
+}
+
+static void RunTimingWheelBenchmark(const TArray<FString>& Args)
+{
+	const int32 NumTimers = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+	const int32 NumFrames = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 300;
+	constexpr float DeltaTime = 1.f / 60;
+	// Mostly longer than a frame, like attack and patrol delays, with some firing every frame
+	constexpr float MinDelay = 0.001;
+	constexpr float MaxDelay = 10;
+
+	UObject* Object = GetTransientPackage();
+	FRandomStream Random(NumTimers);
+	TArray<float> Delays;
+	Delays.SetNumUninitialized(NumTimers);
+	for (float& Delay : Delays)
+	{
+		Delay = Random.FRandRange(MinDelay, MaxDelay);
+	}
+
+	// Every timer is re-armed every frame, then the wheel advances and fires what expired
+	FTimingWheel Wheel;
+	TArray<FScheduledTimerHandle> WheelHandles;
+	WheelHandles.SetNum(NumTimers);
+	GNumBenchmarkTimersFired = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		for (int32 i = 0; i < NumTimers; ++i)
+		{
+			Wheel.SetTimer(WheelHandles[i], Object, &OnBenchmarkTimerFired, Delays[(i + Frame) % NumTimers]);
+		}
+		Wheel.Advance(DeltaTime);
+	}
+	const double WheelMs = (FPlatformTime::Seconds() - StartTime) * 1000 / NumFrames;
+	const int64 WheelFired = GNumBenchmarkTimersFired;
+
+	// FTimerManager only ticks once per engine frame, so only re-arming is timed
+	FTimerManager TimerManager;
+	TArray<FTimerHandle> TimerHandles;
+	TimerHandles.SetNum(NumTimers);
+	const FTimerDelegate Delegate = FTimerDelegate::CreateStatic(&OnBenchmarkTimerFired, Object);
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		for (int32 i = 0; i < NumTimers; ++i)
+		{
+			TimerManager.SetTimer(TimerHandles[i], Delegate, Delays[(i + Frame) % NumTimers], false);
+		}
+	}
+	const double TimerManagerMs = (FPlatformTime::Seconds() - StartTime) * 1000 / NumFrames;
+
+	UE_LOG(LogSlash, Display, TEXT("Scheduler %d timers re-armed per frame over %d frames: timing wheel %.3f ms/frame (re-arm and advance, %lld fired), FTimerManager %.3f ms/frame (re-arm only)"),
+		NumTimers, NumFrames, WheelMs, WheelFired, TimerManagerMs);
+}
+
+static FAutoConsoleCommand TimingWheelBenchmarkCommand(
+	TEXT("Slash.Scheduler.Benchmark"),
+	TEXT("Time re-arming every one of N timers each frame on the timing wheel against FTimerManager."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunTimingWheelBenchmark));
@@ -0,0 +1,308 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Spatial/SpatialHashGrid.h"
+
+#include "Slash.h"
+
+FSpatialHashGrid::FSpatialHashGrid(double InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.0))
+	, InvCellSize(1.0 / CellSize)
+{
+}
+
+int32 FSpatialHashGrid::Add(const FVector& Location, ESpatialHashCategory Category)
+{
+	check(Category != ESpatialHashCategory::None);
+
+	int32 Handle;
+	if (FreeHandles.Num() > 0)
+	{
+		Handle = FreeHandles.Pop(false);
+		Locations[Handle] = Location;
+		Categories[Handle] = Category;
+	}
+	else
+	{
+		Handle = Locations.Add(Location);
+		EntryCells.AddDefaulted();
+		BucketIndices.Add(INDEX_NONE);
+		Categories.Add(Category);
+	}
+	LinkToCell(Handle, GetCell(Location));
+	return Handle;
+}
+
+void FSpatialHashGrid::Update(int32 Handle, const FVector& Location)
+{
+	if (!IsValidHandle(Handle)) return;
+
+	Locations[Handle] = Location;
+	// Only touch the buckets when crossing cells
+	if (const FIntPoint Cell = GetCell(Location); Cell != EntryCells[Handle])
+	{
+		UnlinkFromCell(Handle);
+		LinkToCell(Handle, Cell);
+	}
+}
+
+void FSpatialHashGrid::Remove(int32 Handle)
+{
+	if (!IsValidHandle(Handle)) return;
+
+	UnlinkFromCell(Handle);
+	Categories[Handle] = ESpatialHashCategory::None;
+	FreeHandles.Add(Handle);
+}
+
+void FSpatialHashGrid::Reset()
+{
+	Locations.Reset();
+	EntryCells.Reset();
+	BucketIndices.Reset();
+	Categories.Reset();
+	FreeHandles.Reset();
+	Cells.Reset();
+}
+
+void FSpatialHashGrid::LinkToCell(int32 Handle, const FIntPoint& Cell)
+{
+	TArray<int32>& Bucket = Cells.FindOrAdd(Cell);
+	EntryCells[Handle] = Cell;
+	BucketIndices[Handle] = Bucket.Add(Handle);
+}
+
+void FSpatialHashGrid::UnlinkFromCell(int32 Handle)
+{
+	if (TArray<int32>* Bucket = Cells.Find(EntryCells[Handle]))
+	{
+		const int32 BucketIndex = BucketIndices[Handle];
+		Bucket->RemoveAtSwap(BucketIndex, 1, false);
+		// Last handle in the bucket was swapped into the removed slot
+		if (Bucket->IsValidIndex(BucketIndex))
+		{
+			BucketIndices[(*Bucket)[BucketIndex]] = BucketIndex;
+		}
+		// Empty buckets are kept around, characters tend to move back and forth between the same cells
+	}
+	BucketIndices[Handle] = INDEX_NONE;
+}
+
+template <typename VisitorType>
+void FSpatialHashGrid::ForEachInBounds(const FVector& Center, double Radius, ESpatialHashCategory CategoryMask, VisitorType&& Visitor) const
+{
+	const FIntPoint Min = GetCell(Center - FVector(Radius, Radius, 0));
+	const FIntPoint Max = GetCell(Center + FVector(Radius, Radius, 0));
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			if (const TArray<int32>* Bucket = Cells.Find(FIntPoint(X, Y)))
+			{
+				for (const int32 Handle : *Bucket)
+				{
+					if (EnumHasAnyFlags(Categories[Handle], CategoryMask))
+					{
+						Visitor(Handle);
+					}
+				}
+			}
+		}
+	}
+}
+
+void FSpatialHashGrid::QueryRadius(const FVector& Center, double Radius, TArray<int32>& OutHandles, ESpatialHashCategory CategoryMask) const
+{
+	const double RadiusSquared = FMath::Square(Radius);
+	ForEachInBounds(Center, Radius, CategoryMask, [&](int32 Handle)
+	{
+		if (FVector::DistSquared(Center, Locations[Handle]) <= RadiusSquared)
+		{
+			OutHandles.Add(Handle);
+		}
+	});
+}
+
+void FSpatialHashGrid::QueryCone(const FVector& Origin, const FVector& Direction, double Radius, double HalfAngleDegrees, TArray<int32>& OutHandles, ESpatialHashCategory CategoryMask) const
+{
+	const double RadiusSquared = FMath::Square(Radius);
+	const double CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(HalfAngleDegrees));
+	// Compare Dot >= Cos * |ToEntry| without the square root by squaring both sides, keeping track of signs
+	const double CosSquared = FMath::Square(CosHalfAngle);
+	const bool bWideCone = CosHalfAngle < 0;
+	ForEachInBounds(Origin, Radius, CategoryMask, [&](int32 Handle)
+	{
+		const FVector ToEntry = Locations[Handle] - Origin;
+		const double DistanceSquared = ToEntry.SizeSquared();
+		if (DistanceSquared > RadiusSquared) return;
+
+		const double Dot = FVector::DotProduct(Direction, ToEntry);
+		const double DotSquared = Dot * FMath::Abs(Dot);
+		const bool bInCone = bWideCone
+			? DotSquared >= -CosSquared * DistanceSquared
+			: Dot >= 0 && DotSquared >= CosSquared * DistanceSquared;
+		if (bInCone)
+		{
+			OutHandles.Add(Handle);
+		}
+	});
+}
+
+void FSpatialHashGrid::QueryNearest(const FVector& Center, int32 Count, double MaxRadius, TArray<int32>& OutHandles, ESpatialHashCategory CategoryMask) const
+{
+	if (Count <= 0) return;
+
+	// Sorted closest first, never more than Count long
+	TArray<TPair<double, int32>, TInlineAllocator<16>> Best;
+	const double MaxRadiusSquared = FMath::Square(MaxRadius);
+	const FIntPoint CenterCell = GetCell(Center);
+	const int32 MaxRing = FMath::CeilToInt32(MaxRadius * InvCellSize) + 1;
+
+	auto Consider = [&](int32 Handle)
+	{
+		const double DistanceSquared = FVector::DistSquared(Center, Locations[Handle]);
+		if (DistanceSquared > MaxRadiusSquared) return;
+		if (Best.Num() == Count && DistanceSquared >= Best.Last().Key) return;
+
+		int32 Insert = Best.Num();
+		while (Insert > 0 && Best[Insert - 1].Key > DistanceSquared)
+		{
+			--Insert;
+		}
+		if (Best.Num() == Count)
+		{
+			Best.Pop(false);
+		}
+		Best.Insert(TPair<double, int32>(DistanceSquared, Handle), Insert);
+	};
+
+	auto VisitCell = [&](int32 X, int32 Y)
+	{
+		if (const TArray<int32>* Bucket = Cells.Find(FIntPoint(X, Y)))
+		{
+			for (const int32 Handle : *Bucket)
+			{
+				if (EnumHasAnyFlags(Categories[Handle], CategoryMask))
+				{
+					Consider(Handle);
+				}
+			}
+		}
+	};
+
+	// Walk square rings of cells outwards until no closer entry can exist
+	for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+	{
+		// Anything in this ring is at least (Ring - 1) cells away from Center
+		if (Best.Num() == Count && Ring > 0 && FMath::Square((Ring - 1) * CellSize) > Best.Last().Key)
+		{
+			break;
+		}
+		if (Ring == 0)
+		{
+			VisitCell(CenterCell.X, CenterCell.Y);
+			continue;
+		}
+		for (int32 Offset = -Ring; Offset <= Ring; ++Offset)
+		{
+			VisitCell(CenterCell.X + Offset, CenterCell.Y - Ring);
+			VisitCell(CenterCell.X + Offset, CenterCell.Y + Ring);
+		}
+		for (int32 Offset = -Ring + 1; Offset <= Ring - 1; ++Offset)
+		{
+			VisitCell(CenterCell.X - Ring, CenterCell.Y + Offset);
+			VisitCell(CenterCell.X + Ring, CenterCell.Y + Offset);
+		}
+	}
+
+	for (const TPair<double, int32>& Entry : Best)
+	{
+		OutHandles.Add(Entry.Value);
+	}
+}
+
+/**
+ * Microbenchmark, run with `Slash.SpatialHash.Benchmark [NumQueries]`
+ */
+
+static void RunSpatialHashBenchmark(const TArray<FString>& Args)
+{
+	const int32 NumQueries = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000;
+	constexpr double WorldExtent = 50000;
+	constexpr double QueryRadius = 1500;
+	constexpr int32 NearestCount = 8;
+
+	for (const int32 NumActors : {100, 1000, 10000})
+	{
+		FRandomStream Random(NumActors);
+		FSpatialHashGrid Grid;
+		TArray<FVector> Points;
+		Points.Reserve(NumActors);
+		for (int32 i = 0; i < NumActors; ++i)
+		{
+			const FVector Point(Random.FRandRange(-WorldExtent, WorldExtent), Random.FRandRange(-WorldExtent, WorldExtent), Random.FRandRange(0, 500));
+			Points.Add(Point);
+			Grid.Add(Point, ESpatialHashCategory::Character);
+		}
+
+		TArray<FVector> Centers;
+		for (int32 i = 0; i < NumQueries; ++i)
+		{
+			Centers.Add(Points[Random.RandRange(0, NumActors - 1)]);
+		}
+
+		TArray<int32> Results;
+		Results.Reserve(NumActors);
+		int64 NumFound = 0;
+
+		// Baseline, square root distance against every actor like AEnemy::InTargetRange
+		double StartTime = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			Results.Reset();
+			for (int32 i = 0; i < Points.Num(); ++i)
+			{
+				if ((Points[i] - Center).Size() <= QueryRadius)
+				{
+					Results.Add(i);
+				}
+			}
+			NumFound += Results.Num();
+		}
+		const double BruteForceMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+
+		StartTime = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			Results.Reset();
+			Grid.QueryRadius(Center, QueryRadius, Results);
+			NumFound -= Results.Num();
+		}
+		const double RadiusMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+
+		StartTime = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			Results.Reset();
+			Grid.QueryCone(Center, FVector::ForwardVector, QueryRadius, 45, Results);
+		}
+		const double ConeMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+
+		StartTime = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			Results.Reset();
+			Grid.QueryNearest(Center, NearestCount, QueryRadius * 4, Results);
+		}
+		const double NearestMs = (FPlatformTime::Seconds() - StartTime) * 1000;
+
+		UE_LOG(LogSlash, Display, TEXT("SpatialHash %5d actors, %d queries: brute force %.3f ms, radius %.3f ms, cone %.3f ms, %d-nearest %.3f ms%s"),
+			NumActors, NumQueries, BruteForceMs, RadiusMs, ConeMs, NearestCount, NearestMs,
+			NumFound == 0 ? TEXT("") : TEXT(" (radius results MISMATCH brute force)"));
+	}
+}
+
+static FAutoConsoleCommand SpatialHashBenchmarkCommand(
+	TEXT("Slash.SpatialHash.Benchmark"),
+	TEXT("Time radius, cone and k-nearest spatial hash queries against a brute force scan at 100, 1k and 10k actors."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunSpatialHashBenchmark));
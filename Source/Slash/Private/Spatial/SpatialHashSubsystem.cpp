@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Spatial/SpatialHashSubsystem.h"
+
+static TAutoConsoleVariable<float> CVarSpatialHashCellSize(
+	TEXT("Slash.SpatialHash.CellSize"),
+	1000,
+	TEXT("Cell size in world units of the character spatial hash, applied when a world starts."));
+
+void USpatialHashSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Grid = FSpatialHashGrid(CVarSpatialHashCellSize.GetValueOnGameThread());
+}
+
+void USpatialHashSubsystem::Deinitialize()
+{
+	for (const TWeakObjectPtr<AActor>& Actor : Actors)
+	{
+		if (Actor.IsValid() && Actor->GetRootComponent())
+		{
+			Actor->GetRootComponent()->TransformUpdated.RemoveAll(this);
+		}
+	}
+	Actors.Reset();
+	Handles.Reset();
+	Grid.Reset();
+	Super::Deinitialize();
+}
+
+void USpatialHashSubsystem::RegisterActor(AActor* Actor, ESpatialHashCategory Category)
+{
+	if (!Actor || !Actor->GetRootComponent() || Handles.Contains(Actor)) return;
+
+	const int32 Handle = Grid.Add(Actor->GetActorLocation(), Category);
+	if (Handle >= Actors.Num())
+	{
+		Actors.SetNum(Handle + 1);
+	}
+	Actors[Handle] = Actor;
+	Handles.Add(Actor, Handle);
+	Actor->GetRootComponent()->TransformUpdated.AddUObject(this, &USpatialHashSubsystem::OnRootComponentMoved);
+}
+
+void USpatialHashSubsystem::UnregisterActor(AActor* Actor)
+{
+	int32 Handle;
+	if (!Actor || !Handles.RemoveAndCopyValue(Actor, Handle)) return;
+
+	Grid.Remove(Handle);
+	Actors[Handle].Reset();
+	if (Actor->GetRootComponent())
+	{
+		Actor->GetRootComponent()->TransformUpdated.RemoveAll(this);
+	}
+}
+
+void USpatialHashSubsystem::OnRootComponentMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (const int32* Handle = Handles.Find(UpdatedComponent->GetOwner()))
+	{
+		Grid.Update(*Handle, UpdatedComponent->GetComponentLocation());
+	}
+}
+
+void USpatialHashSubsystem::FindActorsInRadius(const FVector& Center, double Radius, TArray<AActor*>& OutActors, ESpatialHashCategory CategoryMask) const
+{
+	QueryHandles.Reset();
+	Grid.QueryRadius(Center, Radius, QueryHandles, CategoryMask);
+	ResolveActors(OutActors);
+}
+
+void USpatialHashSubsystem::FindActorsInCone(const FVector& Origin, const FVector& Direction, double Radius, double HalfAngleDegrees, TArray<AActor*>& OutActors, ESpatialHashCategory CategoryMask) const
+{
+	QueryHandles.Reset();
+	Grid.QueryCone(Origin, Direction.GetSafeNormal(), Radius, HalfAngleDegrees, QueryHandles, CategoryMask);
+	ResolveActors(OutActors);
+}
+
+void USpatialHashSubsystem::FindNearestActors(const FVector& Center, int32 Count, double MaxRadius, TArray<AActor*>& OutActors, ESpatialHashCategory CategoryMask) const
+{
+	QueryHandles.Reset();
+	Grid.QueryNearest(Center, Count, MaxRadius, QueryHandles, CategoryMask);
+	ResolveActors(OutActors);
+}
+
+void USpatialHashSubsystem::ResolveActors(TArray<AActor*>& OutActors) const
+{
+	for (const int32 Handle : QueryHandles)
+	{
+		if (AActor* Actor = Actors[Handle].Get())
+		{
+			OutActors.Add(Actor);
+		}
+	}
+}
+
+bool USpatialHashSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Spawning/EncounterSpawner.h"
+
+AEncounterSpawner::AEncounterSpawner()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>("RootComponent");
+}
+
+void AEncounterSpawner::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bStartOnBeginPlay)
+	{
+		StartEncounters();
+	}
+	else if (bPrewarmOnBeginPlay)
+	{
+		if (USpawnDirectorSubsystem* SpawnDirector = GetWorld()->GetSubsystem<USpawnDirectorSubsystem>())
+		{
+			for (const FEnemyEncounter& Encounter : Encounters)
+			{
+				SpawnDirector->QueuePrewarm(Encounter.EnemyClass, Encounter.Count);
+			}
+		}
+	}
+}
+
+void AEncounterSpawner::StartEncounters()
+{
+	USpawnDirectorSubsystem* SpawnDirector = GetWorld()->GetSubsystem<USpawnDirectorSubsystem>();
+	if (!SpawnDirector) return;
+
+	const FTransform& Transform = GetActorTransform();
+	for (FEnemyEncounter Encounter : Encounters)
+	{
+		Encounter.SpawnCenter = Transform.TransformPosition(Encounter.SpawnCenter);
+		SpawnDirector->QueueEncounter(Encounter);
+	}
+}
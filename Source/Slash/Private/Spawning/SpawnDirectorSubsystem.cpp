@@ -0,0 +1,256 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Spawning/SpawnDirectorSubsystem.h"
+
+#include "NavigationSystem.h"
+#include "Slash.h"
+#include "Components/CapsuleComponent.h"
+#include "Debug/SlashStats.h"
+#include "Enemy/AmbientEnemySubsystem.h"
+#include "Enemy/Enemy.h"
+#include "Enemy/PatrolRoute.h"
+#include "Kismet/GameplayStatics.h"
+#include "Pooling/ActorPoolSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spawn Tick"), STAT_Spawn_Tick, STATGROUP_SlashSpawn);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending Spawns"), STAT_Spawn_NumPending, STATGROUP_SlashSpawn);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spawned This Frame"), STAT_Spawn_NumSpawnedFrame, STATGROUP_SlashSpawn);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Enemies Spawned"), STAT_Spawn_NumSpawned, STATGROUP_SlashSpawn);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Class Loads"), STAT_Spawn_NumClassLoads, STATGROUP_SlashSpawn);
+
+static TAutoConsoleVariable<float> CVarSpawnBudgetMs(
+	TEXT("Slash.Spawn.BudgetMs"),
+	2,
+	TEXT("Milliseconds per frame the spawn director may spend spawning queued enemies.  At least one is spawned every frame."));
+
+namespace SpawnDirector
+{
+	/// Number of latest spawn latencies kept for percentiles
+	constexpr int32 MaxLatencies = 1024;
+}
+
+void USpawnDirectorSubsystem::Deinitialize()
+{
+	for (const TPair<FSoftObjectPath, TSharedPtr<FStreamableHandle>>& Load : ClassLoads)
+	{
+		if (Load.Value)
+		{
+			Load.Value->CancelHandle();
+		}
+	}
+	ClassLoads.Empty();
+	Pending.Empty();
+	Super::Deinitialize();
+}
+
+int32 USpawnDirectorSubsystem::QueueEncounter(const FEnemyEncounter& Encounter)
+{
+	if (Encounter.EnemyClass.IsNull() || Encounter.Count <= 0) return 0;
+
+	RequestClassLoad(Encounter.EnemyClass);
+	const double QueueTime = FPlatformTime::Seconds();
+	Pending.Reserve(Pending.Num() + Encounter.Count);
+	for (int32 i = 0; i < Encounter.Count; ++i)
+	{
+		Pending.Add({ Encounter.EnemyClass, Encounter.PatrolRoute, Encounter.SpawnCenter, Encounter.SpawnExtent, QueueTime, false, Encounter.bAmbient });
+	}
+	return Encounter.Count;
+}
+
+void USpawnDirectorSubsystem::QueuePrewarm(const TSoftClassPtr<AEnemy>& EnemyClass, int32 Count)
+{
+	if (EnemyClass.IsNull() || Count <= 0) return;
+
+	RequestClassLoad(EnemyClass);
+	const double QueueTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Pending.Add({ EnemyClass, nullptr, FVector::ZeroVector, FVector::ZeroVector, QueueTime, true, false });
+	}
+}
+
+void USpawnDirectorSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Spawn_Tick);
+	SET_DWORD_STAT(STAT_Spawn_NumClassLoads, ClassLoads.Num());
+	if (Pending.Num() == 0)
+	{
+		SET_DWORD_STAT(STAT_Spawn_NumPending, 0);
+		SET_DWORD_STAT(STAT_Spawn_NumSpawnedFrame, 0);
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Deadline = StartTime + CVarSpawnBudgetMs.GetValueOnGameThread() / 1000;
+	int32 NumSpawnedFrame = 0;
+
+	// Spawns still waiting on their class or the next frame's budget keep their order
+	int32 NumKept = 0;
+	for (int32 i = 0; i < Pending.Num(); ++i)
+	{
+		FPendingSpawn& Spawn = Pending[i];
+		const bool bOverBudget = NumSpawnedFrame > 0 && FPlatformTime::Seconds() >= Deadline;
+		UClass* Class = bOverBudget ? nullptr : Spawn.EnemyClass.Get();
+		if (Class)
+		{
+			SpawnPending(Spawn, Class);
+			++NumSpawnedFrame;
+			continue;
+		}
+		if (!bOverBudget && HasClassLoadFailed(Spawn.EnemyClass))
+		{
+			++NumFailed;
+			continue;
+		}
+		if (NumKept != i)
+		{
+			Pending[NumKept] = MoveTemp(Spawn);
+		}
+		++NumKept;
+	}
+	Pending.SetNum(NumKept, false);
+
+	if (NumSpawnedFrame > 0)
+	{
+		MaxFrameMs = FMath::Max(MaxFrameMs, (FPlatformTime::Seconds() - StartTime) * 1000);
+	}
+	SET_DWORD_STAT(STAT_Spawn_NumPending, Pending.Num());
+	SET_DWORD_STAT(STAT_Spawn_NumSpawnedFrame, NumSpawnedFrame);
+}
+
+void USpawnDirectorSubsystem::RequestClassLoad(const TSoftClassPtr<AEnemy>& EnemyClass)
+{
+	const FSoftObjectPath& Path = EnemyClass.ToSoftObjectPath();
+	if (EnemyClass.Get() || ClassLoads.Contains(Path)) return;
+	ClassLoads.Add(Path, StreamableManager.RequestAsyncLoad(Path, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority));
+}
+
+bool USpawnDirectorSubsystem::HasClassLoadFailed(const TSoftClassPtr<AEnemy>& EnemyClass) const
+{
+	const TSharedPtr<FStreamableHandle>* Load = ClassLoads.Find(EnemyClass.ToSoftObjectPath());
+	// No handle at all means the request itself failed, e.g. an invalid path
+	return !Load || !Load->IsValid() || (*Load)->HasLoadCompleted() || (*Load)->WasCanceled();
+}
+
+void USpawnDirectorSubsystem::SpawnPending(const FPendingSpawn& Spawn, UClass* Class)
+{
+	UWorld* World = GetWorld();
+	if (Spawn.bPrewarm)
+	{
+		if (UActorPoolSubsystem* ActorPool = World->GetSubsystem<UActorPoolSubsystem>())
+		{
+			ActorPool->Prewarm(Class, ActorPool->GetNumPooled(Class) + 1);
+			++NumPrewarmed;
+		}
+		return;
+	}
+
+	const FTransform Transform(FRotator(0, Random.FRandRange(-180, 180), 0), PickSpawnLocation(Spawn, Class));
+	UAmbientEnemySubsystem* AmbientEnemies = Spawn.bAmbient ? World->GetSubsystem<UAmbientEnemySubsystem>() : nullptr;
+	if (AmbientEnemies)
+	{
+		AmbientEnemies->AddEntity(Class, Transform.GetLocation(), Transform.Rotator().Yaw, Spawn.PatrolRoute.Get());
+		++NumSpawned;
+		INC_DWORD_STAT(STAT_Spawn_NumSpawned);
+		RecordLatency((FPlatformTime::Seconds() - Spawn.QueueTime) * 1000);
+		return;
+	}
+
+	AEnemy* Enemy = UActorPoolSubsystem::AcquireActor<AEnemy>(World, Class, Transform);
+	if (!Enemy)
+	{
+		++NumFailed;
+		return;
+	}
+	if (APatrolRoute* PatrolRoute = Spawn.PatrolRoute.Get())
+	{
+		Enemy->SetPatrolRoute(PatrolRoute);
+	}
+	++NumSpawned;
+	INC_DWORD_STAT(STAT_Spawn_NumSpawned);
+	RecordLatency((FPlatformTime::Seconds() - Spawn.QueueTime) * 1000);
+}
+
+FVector USpawnDirectorSubsystem::PickSpawnLocation(const FPendingSpawn& Spawn, UClass* Class) const
+{
+	const FVector Point = Spawn.SpawnCenter + FVector(
+		Random.FRandRange(-Spawn.SpawnExtent.X, Spawn.SpawnExtent.X),
+		Random.FRandRange(-Spawn.SpawnExtent.Y, Spawn.SpawnExtent.Y),
+		0);
+	const float HalfHeight = Class->GetDefaultObject<AEnemy>()->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+
+	const UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (FNavLocation NavLocation; NavigationSystem
+		&& NavigationSystem->ProjectPointToNavigation(Point, NavLocation, FVector(100, 100, Spawn.SpawnExtent.Z + HalfHeight)))
+	{
+		return NavLocation.Location + FVector(0, 0, HalfHeight);
+	}
+	return Point;
+}
+
+void USpawnDirectorSubsystem::RecordLatency(float LatencyMs)
+{
+	if (LatenciesMs.Num() < SpawnDirector::MaxLatencies)
+	{
+		LatenciesMs.Add(LatencyMs);
+	}
+	else
+	{
+		LatenciesMs[LatencyCursor] = LatencyMs;
+		LatencyCursor = (LatencyCursor + 1) % SpawnDirector::MaxLatencies;
+	}
+}
+
+void USpawnDirectorSubsystem::DumpStats() const
+{
+	TArray<float> Sorted = LatenciesMs;
+	Sorted.Sort();
+	auto Percentile = [&Sorted](float Fraction)
+	{
+		return Sorted.Num() > 0 ? Sorted[FMath::Clamp(FMath::CeilToInt32(Fraction * Sorted.Num()) - 1, 0, Sorted.Num() - 1)] : 0.f;
+	};
+	UE_LOG(LogSlash, Display, TEXT("Spawn director: %d spawned, %d prewarmed, %d failed, %d pending, longest frame %.2f ms"),
+		NumSpawned, NumPrewarmed, NumFailed, Pending.Num(), MaxFrameMs);
+	UE_LOG(LogSlash, Display, TEXT("Spawn latency over the last %d spawns: p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms"),
+		Sorted.Num(), Percentile(0.5), Percentile(0.95), Percentile(0.99), Sorted.Num() > 0 ? Sorted.Last() : 0.f);
+}
+
+TStatId USpawnDirectorSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USpawnDirectorSubsystem, STATGROUP_Tickables);
+}
+
+bool USpawnDirectorSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorld SpawnStatsCommand(
+	TEXT("Slash.Spawn.Stats"),
+	TEXT("Log spawn director counts and spawn latency percentiles."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const USpawnDirectorSubsystem* SpawnDirector = World ? World->GetSubsystem<USpawnDirectorSubsystem>() : nullptr)
+		{
+			SpawnDirector->DumpStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs SpawnEncounterCommand(
+	TEXT("Slash.Spawn.Encounter"),
+	TEXT("Queue an encounter around the player: Slash.Spawn.Encounter [Count] [Radius] [EnemyClassPath]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USpawnDirectorSubsystem* SpawnDirector = World ? World->GetSubsystem<USpawnDirectorSubsystem>() : nullptr;
+		const APawn* Player = UGameplayStatics::GetPlayerPawn(World, 0);
+		if (!SpawnDirector || !Player) return;
+
+		FEnemyEncounter Encounter;
+		Encounter.Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10;
+		const double Radius = Args.Num() > 1 ? FCString::Atod(*Args[1]) : 1500;
+		Encounter.EnemyClass = Args.Num() > 2 ? TSoftClassPtr<AEnemy>(FSoftObjectPath(Args[2])) : TSoftClassPtr<AEnemy>(AEnemy::StaticClass());
+		Encounter.SpawnCenter = Player->GetActorLocation();
+		Encounter.SpawnExtent = FVector(Radius, Radius, 200);
+		SpawnDirector->QueueEncounter(Encounter);
+	}));
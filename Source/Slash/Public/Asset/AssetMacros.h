@@ -15,4 +15,10 @@
 	TEXT(AssetPath)); AssetFile.Succeeded()) \
 	{ \
 		Callback(AssetFile.Object); \
-	}
\ No newline at end of file
+	}
+/// Load a Blueprint class from asset file path to a class variable via assignment
+#define LOAD_CLASS_TO_VARIABLE(ClassType, AssetPath, VariableToSet) if (const ConstructorHelpers::FClassFinder<ClassType> ClassFile( \
+	TEXT(AssetPath)); ClassFile.Succeeded()) \
+	{ \
+		VariableToSet = ClassFile.Class; \
+	}
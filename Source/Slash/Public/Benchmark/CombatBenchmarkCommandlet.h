@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CombatBenchmarkCommandlet.generated.h"
+
+class AEnemy;
+class ASlashCharacter;
+class AWeapon;
+class FJsonObject;
+
+/**
+ * Headless benchmark of combat at scale, for plotting how frame time grows with the number of enemies.
+ *
+ * For every enemy count in the sweep, loads the test map, spawns enemies on a grid around scripted bots
+ * which circle and swing at them, then ticks the world a fixed number of times with a fixed delta time
+ * and seed.  Writes frame time percentiles, time in AEnemy::Tick (or the batched AI standing in for it),
+ * weapon swing sweeps, character movement and animation, the number of weapon hits, and peak memory per
+ * count to a JSON file.  Bots swing at fixed times, so runs at different -DeltaTime over the same
+ * simulated time (-Ticks scaled to match) should report the same hits.
+ *
+ * With -Replay, each run is recorded as a combat replay next to the report, and the commandlet fails if
+ * recording takes more than -ReplayBudgetMs per frame for every 200 characters.
+ *
+ *   UnrealEditor-Cmd Slash.uproject -run=CombatBenchmark -nullrhi -nosound -unattended
+ *     [-Map=/Game/Maps/Minimal_Default] [-Counts=10,100,1000] [-Bots=4] [-Ticks=600] [-WarmupTicks=60]
+ *     [-DeltaTime=0.0166667] [-Seed=1] [-Replay] [-ReplayBudgetMs=0.1] [-EnemyClass=<path>] [-BotClass=<path>] [-WeaponClass=<path>] [-Output=<file>]
+ *
+ * Character movement and skeletal meshes are ticked by the benchmark itself to time them, with serial
+ * animation evaluation and every mesh animating as if on screen.
+ */
+UCLASS()
+class SLASH_API UCombatBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCombatBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FSettings
+	{
+		FString MapName = TEXT("/Game/Maps/Minimal_Default");
+		TArray<int32> EnemyCounts = { 10, 100, 1000 };
+		int32 NumBots = 4;
+		int32 NumTicks = 600;
+		int32 NumWarmupTicks = 60;
+		int32 Seed = 1;
+		float DeltaTime = 1.f / 60;
+		/// Distance between neighbouring enemies on the spawn grid
+		double EnemySpacing = 300;
+		/// Radius of the circles bots walk
+		double BotCircleRadius = 600;
+		/// Seconds between swings of each bot
+		double BotAttackInterval = 0.75;
+		/// Seconds between the swings of one bot and the next
+		double BotAttackStagger = 7.0 / 60;
+		/// Record a combat replay of each run
+		bool bRecordReplay = false;
+		/// Most game thread milliseconds per frame recording a replay may take, for every 200 characters
+		double ReplayBudgetMs = 0.1;
+		TSubclassOf<AEnemy> EnemyClass;
+		TSubclassOf<ASlashCharacter> BotClass;
+		TSubclassOf<AWeapon> WeaponClass;
+		FString OutputPath;
+	};
+
+	/// Characters spawned for one run, ticked by the benchmark
+	struct FRunActors
+	{
+		TArray<TWeakObjectPtr<AEnemy>> Enemies;
+		TArray<TWeakObjectPtr<ASlashCharacter>> Bots;
+		TArray<FVector> BotCenters;
+	};
+
+	/// Parse command line switches, returns false if classes to spawn could not be loaded
+	bool ParseSettings(const FString& Params);
+	/// Load the test map into a game world and begin play
+	UWorld* LoadWorld() const;
+	/// End play and destroy a world loaded for a run
+	void DestroyWorld(UWorld* World) const;
+	/// Run the benchmark with a number of enemies, returning its report or null if the map failed to load
+	TSharedPtr<FJsonObject> RunBenchmark(int32 NumEnemies);
+
+	void SpawnActors(UWorld* World, int32 NumEnemies, FRunActors& OutActors) const;
+	/// Spawn location on the ground near a point
+	FVector FindGroundLocation(UWorld* World, const FVector& Location, float HalfHeight) const;
+	/// Move and swing bots for a tick
+	void DriveBots(const FRunActors& Actors, int32 Tick) const;
+	/// Tick the world once, returning the time taken in milliseconds
+	double TickWorld(UWorld* World, const FRunActors& Actors) const;
+
+	FSettings Settings;
+	/// Whether a run took longer recording its replay than the budget
+	bool bReplayOverBudget = false;
+};
@@ -39,4 +39,8 @@ private:
 	/// Treasure class to spawn
 	UPROPERTY(EditAnywhere)
 	TArray<TSubclassOf<class ATreasure>> TreasureClasses;
+
+	/// Treasures of each class kept ready in the actor pool
+	UPROPERTY(EditAnywhere, Category = "Pooling")
+	int32 TreasurePrewarmCount = 2;
 };
@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Character/MontageSections.h"
+#include "Combat/CombatIdentity.h"
+#include "Debug/CombatTelemetry.h"
 #include "Interfaces/HitInterface.h"
 #include "BaseCharacter.generated.h"
 
@@ -28,8 +31,21 @@ public:
 
 	virtual void GetHit_Implementation(const FVector& ImpactPoint, AActor* Hitter) override;
 
+	UAttributeComponent* GetAttributes() const;
+	/// Whether health has run out, before or after dying
+	bool IsOutOfHealth() const;
+
+	FORCEINLINE const FCombatIdentity& GetCombatIdentity() const { return CombatIdentity; }
+	/// Combat identity of any actor, neutral for actors that aren't characters
+	static FORCEINLINE FCombatIdentity IdentityOf(const AActor* Actor)
+	{
+		const ABaseCharacter* Character = Cast<ABaseCharacter>(Actor);
+		return Character ? Character->CombatIdentity : FCombatIdentity();
+	}
+
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	/**
 	 * Weapon Hit Collision
@@ -42,9 +58,13 @@ protected:
 	FORCEINLINE virtual bool CanAttack();
 	/// Begin attack
 	virtual void Attack();
+	/// Look up the sections of the montages this character plays, from BeginPlay
+	virtual void CacheMontageSections();
 	/// Select a random section from animation montage and play it, returning the section index
 	/// returns -1 if can't play the montage
-	int32 PlayRandomMontageSection(TObjectPtr<UAnimMontage> Montage);
+	int32 PlayRandomMontageSection(const FMontageSections& Sections);
+	/// Play a section of an animation montage by index, returns false if there is no such section or animation instance
+	bool PlayMontageSection(const FMontageSections& Sections, int32 SectionIndex);
 	/// Play Attack Montage animation
 	virtual void PlayAttackMontage();
 	/// Stop Attack Montage animation
@@ -65,9 +85,15 @@ protected:
 
 	/// Handle when this enemy dies
 	virtual void Die();
+	/// Undo death and restore attributes, for characters reused from a pool
+	virtual void ResetCharacter();
 
-	/// Play the Hit React animation montage
-	void PlayHitReactMontage(const FName& SectionName);
+	/// Make this character findable by spatial queries
+	void RegisterInSpatialHash();
+	void UnregisterFromSpatialHash();
+
+	/// Play the Hit React animation montage section for a hit from a direction
+	void PlayHitReactMontage(EHitDirection Direction);
 	/// Directional hit reaction
 	void DirectionalHitReact(const FVector& ImpactPoint);
 	/// Play sound for receiving a hit
@@ -81,6 +107,19 @@ protected:
 	UPROPERTY(VisibleAnywhere)
 	TObjectPtr<UAttributeComponent> Attributes;
 
+	/// Recorder of combat replays, told about montages played
+	UPROPERTY(Transient)
+	TObjectPtr<class UCombatReplaySubsystem> ReplaySubsystem;
+
+#if SLASH_TELEMETRY
+	/// World time of the first damage taken since spawning or being reset, negative before, for telemetry
+	double FirstDamagedTime = -1;
+#endif
+
+	/// Faction and combat state, checked by combat code instead of the actor's tags
+	UPROPERTY(EditDefaultsOnly, Category = Combat)
+	FCombatIdentity CombatIdentity;
+
 	/// Current equipped weapon
 	UPROPERTY(VisibleAnywhere, Category = Combat)
 	TObjectPtr<AWeapon> EquippedWeapon;
@@ -106,6 +145,12 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = Montages)
 	TObjectPtr<UAnimMontage> DodgeMontage;
 
+	/// Sections of the montages above, see CacheMontageSections
+	FMontageSections AttackSections;
+	FMontageSections HitReactSections;
+	FMontageSections DeathSections;
+	FMontageSections DodgeSections;
+
 	/**
 	 * For Motion Warping
 	 */
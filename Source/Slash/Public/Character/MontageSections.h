@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimMontage;
+
+/**
+ * Sections of animation montages looked up once, and hit directions picked for hit react sections
+ */
+
+/// Side of a character a hit came from, relative to where it faces
+enum class EHitDirection : uint8
+{
+	Front,
+	Left,
+	Right,
+	Back,
+	MAX
+};
+
+/**
+ * Names and start times of the sections of a montage, cached when a character begins play so playing a
+ * section doesn't look it up in the montage.  Sections are played by index, starting the montage at the
+ * section's start time, see ABaseCharacter::PlayMontageSection.
+ */
+struct SLASH_API FMontageSections
+{
+	/// Montage cached, kept loaded by the character that plays it
+	UAnimMontage* Montage = nullptr;
+	TArray<FName> Names;
+	TArray<float> StartTimes;
+	/// Section played for a hit from each direction, INDEX_NONE if the montage has none named for it
+	int32 DirectionSections[static_cast<int32>(EHitDirection::MAX)] = { INDEX_NONE, INDEX_NONE, INDEX_NONE, INDEX_NONE };
+
+	/// Look up the sections of a montage, or clear them for none
+	void Cache(UAnimMontage* InMontage);
+
+	FORCEINLINE int32 Num() const { return Names.Num(); }
+	FORCEINLINE bool IsValidIndex(int32 Index) const { return Montage && Names.IsValidIndex(Index); }
+	/// Index of a section by name, INDEX_NONE if missing
+	FORCEINLINE int32 Find(FName Name) const { return Names.Find(Name); }
+	FORCEINLINE int32 GetDirectionSection(EHitDirection Direction) const { return DirectionSections[static_cast<int32>(Direction)]; }
+};
+
+namespace MontageSections
+{
+	/// Names of the hit react sections for each direction
+	extern SLASH_API const FName DirectionSectionNames[static_cast<int32>(EHitDirection::MAX)];
+
+	/**
+	 * Side a hit came from, in 90 degree quarters centred on the front, right, back and left, without trig.
+	 * ToImpact must be normalized and level with Forward.
+	 */
+	FORCEINLINE EHitDirection GetHitDirection(const FVector& Forward, const FVector& ToImpact)
+	{
+		// Boundaries at 45 and 135 degrees either side, on the sides they fell on when measured in degrees
+		const double Cos = FVector::DotProduct(Forward, ToImpact);
+		if (FVector::CrossProduct(Forward, ToImpact).Z < 0)
+		{
+			return Cos >= UE_HALF_SQRT_2 ? EHitDirection::Front : Cos >= -UE_HALF_SQRT_2 ? EHitDirection::Left : EHitDirection::Back;
+		}
+		return Cos > UE_HALF_SQRT_2 ? EHitDirection::Front : Cos > -UE_HALF_SQRT_2 ? EHitDirection::Right : EHitDirection::Back;
+	}
+}
@@ -40,6 +40,13 @@ public:
 	FORCEINLINE EActionState GetActionState() const { return ActionState; }
 	FORCEINLINE EDeathPose GetDeathPose() const { return DeathPose; }
 
+#if WITH_EDITOR || !UE_BUILD_SHIPPING
+	/// Equip a weapon without picking it up, for scripted bots such as the combat benchmark's
+	FORCEINLINE void DebugEquip(AWeapon* Weapon) { EquipWeapon(Weapon); }
+	/// Attack as if the attack input was pressed, for scripted bots
+	FORCEINLINE void DebugAttack() { Attack(); }
+#endif
+
 protected:
 	virtual void BeginPlay() override;
 
@@ -59,6 +66,7 @@ protected:
 	 * Animation Montages
 	 */
 	
+	virtual void CacheMontageSections() override;
 	void PlayEquipMontage(const FName& SectionName);
 	virtual void AttackEnd() override;
 	virtual void DodgeEnd() override;
@@ -95,8 +103,8 @@ protected:
 	TObjectPtr<UInputAction> DodgeAction;
 
 private:
-
-	void SetHUDHealth();
+	/// Attach a weapon to the right hand and arm with it
+	void EquipWeapon(AWeapon* Weapon);
 	
 	/**
 	 * States
@@ -132,6 +140,7 @@ private:
 	 */
 	UPROPERTY(EditDefaultsOnly, Category = Montages)
 	TObjectPtr<UAnimMontage> EquipMontage;
+	FMontageSections EquipSections;
 
 	/**
 	 * Overlays
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CombatIdentity.generated.h"
+
+/**
+ * Faction and combat state of characters, checked by combat code instead of actor tags
+ */
+
+/// Side a character fights for
+UENUM(BlueprintType)
+enum class ECombatFaction : uint8
+{
+	/// Not a character, or fighting for no one.  Hurts and is hurt by everyone
+	Neutral,
+	Player,
+	Enemy,
+	MAX UMETA(Hidden)
+};
+
+/// Combat state of a character, kept alongside the matching actor tags for Blueprints
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class ECombatFlags : uint8
+{
+	None = 0 UMETA(Hidden),
+	/// Died and not yet reset, see DeadTag
+	Dead = 1 << 0,
+	/// Enemies engage on sight, see EngageableActorTagName
+	Engageable = 1 << 1,
+};
+ENUM_CLASS_FLAGS(ECombatFlags)
+
+/// Faction and combat state of a character, small enough to check without touching the rest of the actor
+USTRUCT(BlueprintType)
+struct FCombatIdentity
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Combat)
+	ECombatFaction Faction = ECombatFaction::Neutral;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = Combat, meta = (Bitmask, BitmaskEnum = "/Script/Slash.ECombatFlags"))
+	uint8 Flags = 0;
+
+	/// Bit per faction of the factions each faction's weapons hurt, indexed by faction
+	static constexpr uint8 HostileFactions[static_cast<uint8>(ECombatFaction::MAX)] = {
+		/* Neutral */ 1 << static_cast<uint8>(ECombatFaction::Neutral) | 1 << static_cast<uint8>(ECombatFaction::Player) | 1 << static_cast<uint8>(ECombatFaction::Enemy),
+		/* Player */ 1 << static_cast<uint8>(ECombatFaction::Neutral) | 1 << static_cast<uint8>(ECombatFaction::Enemy),
+		/* Enemy */ 1 << static_cast<uint8>(ECombatFaction::Neutral) | 1 << static_cast<uint8>(ECombatFaction::Player),
+	};
+
+	/// Whether weapons of this character's faction hurt another's
+	FORCEINLINE bool CanHurt(const FCombatIdentity& Other) const
+	{
+		return (HostileFactions[static_cast<uint8>(Faction)] >> static_cast<uint8>(Other.Faction)) & 1;
+	}
+
+	FORCEINLINE bool HasFlags(ECombatFlags InFlags) const { return (Flags & static_cast<uint8>(InFlags)) == static_cast<uint8>(InFlags); }
+	FORCEINLINE bool IsDead() const { return HasFlags(ECombatFlags::Dead); }
+	FORCEINLINE bool IsEngageable() const { return HasFlags(ECombatFlags::Engageable); }
+
+	FORCEINLINE void SetFlags(ECombatFlags InFlags, bool bSet)
+	{
+		Flags = bSet ? Flags | static_cast<uint8>(InFlags) : Flags & ~static_cast<uint8>(InFlags);
+	}
+};
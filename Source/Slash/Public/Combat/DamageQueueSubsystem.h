@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "DamageQueueSubsystem.generated.h"
+
+class AWeapon;
+
+/// A weapon hit waiting to be resolved
+struct FQueuedHit
+{
+	TWeakObjectPtr<AActor> Target;
+	/// Owner of the weapon, reacted to by the target
+	TWeakObjectPtr<AActor> Hitter;
+	TWeakObjectPtr<AWeapon> Weapon;
+	TWeakObjectPtr<AController> Instigator;
+	/// Unique IDs of the target and hitter, the order hits resolve in.  Unlike names, no two live actors share one
+	uint32 TargetId;
+	uint32 HitterId;
+	/// Names of the target and hitter, for logging
+	FName TargetName;
+	FName HitterName;
+	FVector ImpactPoint;
+	float Damage;
+};
+
+/**
+ * Resolves weapon hits once per frame, instead of each hit applying damage and reactions from inside the
+ * trace that found it.
+ *
+ * Hits are queued as they are found and resolved together once every actor and subsystem has ticked, sorted
+ * by target and hitter so the outcome doesn't depend on which weapon ticked first.  Resolution runs in
+ * phases over the whole batch: damage for every hit, then one hit reaction per surviving target, then deaths
+ * (which drop souls), then field requests at every impact.  Hits on targets that were already dead when the
+ * frame began are dropped.
+ *
+ * With `Slash.Damage.Queue` off hits resolve as soon as they are queued, as do hits in worlds without the
+ * subsystem.  `Slash.Damage.LogEvents` logs every hit resolved.  Counts and times are shown in
+ * `stat SlashDamage`.
+ */
+UCLASS()
+class SLASH_API UDamageQueueSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/// Queue a weapon hit on a target, resolved at the end of the frame
+	static void QueueHit(UWorld* World, AActor* Target, AWeapon* Weapon, float Damage, const FVector& ImpactPoint);
+
+	/// Hits resolved in the latest batch
+	FORCEINLINE int32 GetNumResolved() const { return NumResolved; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// Resolve the hits queued this frame
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	/// Resolve a batch of hits in order, see class comment
+	static void ResolveHits(UWorld* World, TArray<FQueuedHit>& Hits);
+
+	TArray<FQueuedHit> Queued;
+	int32 NumResolved = 0;
+	FDelegateHandle PostActorTickHandle;
+};
@@ -6,7 +6,19 @@
 #include "Components/ActorComponent.h"
 #include "AttributeComponent.generated.h"
 
-
+class UAttributeComponent;
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnAttributeChanged, UAttributeComponent* /* Attributes */, float /* OldValue */, float /* NewValue */);
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnAttributeCountChanged, UAttributeComponent* /* Attributes */, int32 /* OldValue */, int32 /* NewValue */);
+
+/**
+ * Health, stamina, gold and souls of a character.
+ *
+ * Changes are broadcast once per frame, after the frame's gameplay: an attribute changed several times in a
+ * frame is broadcast once with its value before the first change and after the last, and not at all if it
+ * ended where it began.  The component only ticks in frames with changes to broadcast, and only notes
+ * changes while something listens.
+ */
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class SLASH_API UAttributeComponent : public UActorComponent
 {
@@ -20,26 +32,39 @@ public:
 	/// Callback to apply damage
 	void ReceiveDamage(float Damage);
 	/// Get percentage of health left
-	float GetHealthPercent();
+	float GetHealthPercent() const;
+	/// Set health, clamped to max health
+	void SetHealth(float NewHealth);
 	/// Callback to use stamina
 	void UseStamina(float Amount);
-	/// Get percentage of health left
-	float GetStaminaPercent();
-	/// Regenerate stamina
+	/// Get percentage of stamina left
+	float GetStaminaPercent() const;
+	/// Regenerate stamina, up to max stamina
 	void RegenStamina(float DeltaTime);
 
 	/// Whether entity is alive based on health and max health
 	bool IsAlive();
+	/// Restore full health and stamina and drop all gold and souls, e.g. when reused from a pool
+	void ResetAttributes();
 
 	void AddGold(int32 Amount);
 	void AddSouls(int32 Amount);
 
+	FORCEINLINE float GetHealth() const { return Health; }
 	FORCEINLINE int32 GetGold() const { return Gold; }
 	FORCEINLINE int32 GetSouls() const { return Souls; }
 	FORCEINLINE float GetDodgeCost() const { return DodgeCost; }
 	FORCEINLINE float GetStamina() const { return Stamina; }
 	FORCEINLINE bool CanDodge() const { return Stamina >= DodgeCost; }
 
+	/// Broadcast the changes of the frame so far now, instead of at the end of the frame
+	void BroadcastChanges();
+
+	FOnAttributeChanged OnHealthChanged;
+	FOnAttributeChanged OnStaminaChanged;
+	FOnAttributeCountChanged OnGoldChanged;
+	FOnAttributeCountChanged OnSoulsChanged;
+
 protected:
 	virtual void BeginPlay() override;
 
@@ -75,4 +100,18 @@ private:
 	/// Regeneration rate for stamina per second
 	UPROPERTY(VisibleAnywhere, Category = Attributes)
 	float StaminaRegenRate = 2;
+
+	/**
+	 * Change broadcasts
+	 */
+
+	/// Note an attribute changed, to broadcast at the end of the frame with the value it had before this frame
+	template <typename T>
+	void NoteChange(uint8 Attribute, T& ValueBeforeFrame, T OldValue, T NewValue);
+	/// Attributes changed this frame, see AttributeChange
+	uint8 ChangedAttributes = 0;
+	float HealthBeforeFrame = 0;
+	float StaminaBeforeFrame = 0;
+	int32 GoldBeforeFrame = 0;
+	int32 SoulsBeforeFrame = 0;
 };
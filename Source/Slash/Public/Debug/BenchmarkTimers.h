@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Time and number of calls accumulated by a scoped timer around gameplay code measured by the combat
+ * benchmark, see UCombatBenchmarkCommandlet.
+ *
+ * Unlike cycle stats these are read back directly in process, and only cost a branch while no benchmark
+ * is running.  Compiled out of shipping builds.
+ */
+struct FBenchmarkTimer
+{
+	uint64 Cycles = 0;
+	int64 Calls = 0;
+
+	FORCEINLINE void Reset() { Cycles = 0; Calls = 0; }
+	FORCEINLINE double GetMilliseconds() const { return FPlatformTime::ToMilliseconds64(Cycles); }
+};
+
+namespace SlashBenchmark
+{
+	/// Whether scoped benchmark timers are recording
+	extern SLASH_API bool bTimersEnabled;
+
+	extern SLASH_API FBenchmarkTimer EnemyTick;
+	/// Batched decisions standing in for AEnemy::Tick, see UEnemyAISubsystem
+	extern SLASH_API FBenchmarkTimer EnemyAIBatch;
+	/// Blade sweeps of weapon swings, see AWeapon
+	extern SLASH_API FBenchmarkTimer WeaponSwing;
+	/// Waiting for async weapon trace results, see UWeaponTraceSubsystem
+	extern SLASH_API FBenchmarkTimer WeaponTraceWait;
+	/// Resolving queued weapon hits, see UDamageQueueSubsystem
+	extern SLASH_API FBenchmarkTimer DamageResolve;
+	/// Recording combat replays on the game thread, see UCombatReplaySubsystem
+	extern SLASH_API FBenchmarkTimer ReplayRecord;
+	extern SLASH_API FBenchmarkTimer CharacterMovement;
+	extern SLASH_API FBenchmarkTimer Animation;
+
+	/// Actors hit by weapon swings while timers are enabled, to check hits don't change with the frame rate
+	extern SLASH_API int64 NumWeaponHits;
+
+	/// Reset every timer and counter
+	SLASH_API void ResetTimers();
+}
+
+/// Adds the time until the end of the scope to a timer, if timers are enabled
+struct FBenchmarkTimerScope
+{
+	FORCEINLINE explicit FBenchmarkTimerScope(FBenchmarkTimer& InTimer)
+		: Timer(SlashBenchmark::bTimersEnabled ? &InTimer : nullptr)
+		, StartCycles(Timer ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	FORCEINLINE ~FBenchmarkTimerScope()
+	{
+		if (Timer)
+		{
+			Timer->Cycles += FPlatformTime::Cycles64() - StartCycles;
+			++Timer->Calls;
+		}
+	}
+
+private:
+	FBenchmarkTimer* Timer;
+	uint64 StartCycles;
+};
+
+#if UE_BUILD_SHIPPING
+#define SCOPE_BENCHMARK_TIMER(TimerName)
+#else
+/// Time the rest of the scope into SlashBenchmark::TimerName while a benchmark runs
+#define SCOPE_BENCHMARK_TIMER(TimerName) const FBenchmarkTimerScope ANONYMOUS_VARIABLE(BenchmarkTimer)(SlashBenchmark::TimerName)
+#endif
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#ifndef SLASH_TELEMETRY
+#define SLASH_TELEMETRY !UE_BUILD_SHIPPING
+#endif
+
+/**
+ * Aggregated combat statistics, such as damage per hit and time to kill, gathered without logging every event.
+ *
+ * Each thread adds to its own counters and fixed-bucket histograms, so recording takes no locks and no
+ * atomic read-modify-writes.  While `Slash.Telemetry.Enabled` is on, the totals so far are written every
+ * `Slash.Telemetry.FlushInterval` seconds to Saved/Telemetry/CombatTelemetry.csv and .json by a background
+ * task, which sums every thread's counts.  While off recording costs a branch, and with SLASH_TELEMETRY 0
+ * (the default in shipping builds) it is compiled out.
+ */
+namespace SlashTelemetry
+{
+	/// Totals of events
+	enum class ECounter : uint8
+	{
+		/// Actors hit by weapon swings
+		Hits,
+		/// Weapon swings begun
+		Swings,
+		/// Characters killed
+		Deaths,
+		/// Dodges by the player
+		Dodges,
+		/// Souls picked up by the player
+		SoulsEarned,
+		/// Gold picked up by the player
+		GoldEarned,
+		MAX
+	};
+
+	/// Distributions of values, see the bucket layout of each in CombatTelemetry.cpp
+	enum class EHistogram : uint8
+	{
+		/// Damage dealt by each weapon hit
+		DamagePerHit,
+		/// Actors hit by each weapon swing
+		HitsPerSwing,
+		/// Seconds from a character's first damage to its death, keyed by class, see GetClassKey
+		TimeToKill,
+		MAX
+	};
+
+	/// Buckets of every histogram, values below and above them fall into the first and last
+	constexpr int32 NumBuckets = 16;
+	/// Most keys a histogram is split by, later keys share the last
+	constexpr int32 MaxKeys = 16;
+
+	/// Whether events are recorded, mirrors `Slash.Telemetry.Enabled`
+	extern SLASH_API bool bEnabled;
+
+	/// Add to a counter of the calling thread
+	SLASH_API void AddCount(ECounter Counter, int64 Amount);
+	/// Add a value to a histogram of the calling thread
+	SLASH_API void AddSample(EHistogram Histogram, int32 Key, double Value);
+	/// Histogram key of a class, named after it in the written files.  Game thread only
+	SLASH_API int32 GetClassKey(const UClass* Class);
+	/// Write the totals so far on a background task, unless the previous write is still going
+	SLASH_API void Flush();
+}
+
+#if SLASH_TELEMETRY
+/// Add to SlashTelemetry::ECounter::CounterName, Amount is only evaluated while telemetry is enabled
+#define SLASH_TELEMETRY_COUNT(CounterName, Amount) \
+	do { if (SlashTelemetry::bEnabled) { SlashTelemetry::AddCount(SlashTelemetry::ECounter::CounterName, (Amount)); } } while (0)
+/// Add a value to SlashTelemetry::EHistogram::HistogramName, Key and Value are only evaluated while telemetry is enabled
+#define SLASH_TELEMETRY_SAMPLE(HistogramName, Key, Value) \
+	do { if (SlashTelemetry::bEnabled) { SlashTelemetry::AddSample(SlashTelemetry::EHistogram::HistogramName, (Key), (Value)); } } while (0)
+#else
+#define SLASH_TELEMETRY_COUNT(CounterName, Amount)
+#define SLASH_TELEMETRY_SAMPLE(HistogramName, Key, Value)
+#endif
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Stats/Stats.h"
+
+/**
+ * Stat groups for profiling Slash gameplay systems, view in game with `stat <GroupName>`
+ */
+
+/// Batched enemy AI decisions, `stat SlashEnemyAI`
+DECLARE_STATS_GROUP(TEXT("SlashEnemyAI"), STATGROUP_SlashEnemyAI, STATCAT_Advanced);
+/// Enemy AI level of detail tiers, `stat SlashAILOD`
+DECLARE_STATS_GROUP(TEXT("SlashAILOD"), STATGROUP_SlashAILOD, STATCAT_Advanced);
+/// Batched enemy sight checks, `stat SlashPerception`
+DECLARE_STATS_GROUP(TEXT("SlashPerception"), STATGROUP_SlashPerception, STATCAT_Advanced);
+/// Gameplay timing wheel, `stat SlashScheduler`
+DECLARE_STATS_GROUP(TEXT("SlashScheduler"), STATGROUP_SlashScheduler, STATCAT_Advanced);
+/// Shared flow field pursuit, `stat SlashPursuit`
+DECLARE_STATS_GROUP(TEXT("SlashPursuit"), STATGROUP_SlashPursuit, STATCAT_Advanced);
+/// Actor pooling, `stat SlashPool`
+DECLARE_STATS_GROUP(TEXT("SlashPool"), STATGROUP_SlashPool, STATCAT_Advanced);
+/// Spawn director, `stat SlashSpawn`
+DECLARE_STATS_GROUP(TEXT("SlashSpawn"), STATGROUP_SlashSpawn, STATCAT_Advanced);
+/// Attack tokens handed out by the combat coordinator and combat range events, `stat SlashCombat`
+DECLARE_STATS_GROUP(TEXT("SlashCombat"), STATGROUP_SlashCombat, STATCAT_Advanced);
+/// Weapon swing sweeps and hits, `stat SlashWeapon`
+DECLARE_STATS_GROUP(TEXT("SlashWeapon"), STATGROUP_SlashWeapon, STATCAT_Advanced);
+/// Weapon hits resolved by the damage queue, `stat SlashDamage`
+DECLARE_STATS_GROUP(TEXT("SlashDamage"), STATGROUP_SlashDamage, STATCAT_Advanced);
+/// Pooled hit and pickup effects, `stat SlashFX`
+DECLARE_STATS_GROUP(TEXT("SlashFX"), STATGROUP_SlashFX, STATCAT_Advanced);
+/// Combat replay recording and playback, `stat SlashReplay`
+DECLARE_STATS_GROUP(TEXT("SlashReplay"), STATGROUP_SlashReplay, STATCAT_Advanced);
+/// Health bars drawn by the HUD, `stat SlashHUD`
+DECLARE_STATS_GROUP(TEXT("SlashHUD"), STATGROUP_SlashHUD, STATCAT_Advanced);
+/// Ambient enemy entities far from the player, `stat SlashAmbient`
+DECLARE_STATS_GROUP(TEXT("SlashAmbient"), STATGROUP_SlashAmbient, STATCAT_Advanced);
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AmbientEnemySubsystem.generated.h"
+
+class AEnemy;
+class APatrolRoute;
+enum class EEnemyState : uint8;
+
+/**
+ * Keeps far away enemies as lightweight entities instead of actors, so a map can hold thousands of them.
+ *
+ * An entity is a slot in a few packed arrays: location, patrol route and waypoint, state, health and souls.
+ * Patrolling entities walk straight between waypoints of their route in a parallel pass every frame, and
+ * pick their next waypoint on the game thread when they arrive.  Every `Slash.Ambient.UpdateInterval`
+ * seconds, entities within `Slash.Ambient.PromoteDistance` of the player are promoted to AEnemy actors from
+ * the actor pool.  Actors beyond `Slash.Ambient.DemoteDistance` that aren't in combat are demoted back and
+ * released to the pool.  Route, waypoint, health and souls carry over both ways.  Entities whose actor dies
+ * are removed.
+ *
+ * Entity and actor counts and the time spent in each pass are shown in `stat SlashAmbient` and logged with
+ * `Slash.Ambient.Stats`.  `Slash.Ambient.Spawn` adds entities around the player for testing.
+ */
+UCLASS()
+class SLASH_API UAmbientEnemySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/// Add an entity of an enemy class, promoted to an actor once the player comes close
+	void AddEntity(TSubclassOf<AEnemy> EnemyClass, const FVector& Location, float Yaw, APatrolRoute* PatrolRoute);
+
+	FORCEINLINE int32 GetNumEntities() const { return Locations.Num(); }
+	FORCEINLINE int32 GetNumActors() const { return NumActors; }
+
+	/// Log entity and actor counts and pass timings
+	void DumpStats() const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// Enemy class defaults entities of the class move by
+	struct FEntityClass
+	{
+		TSubclassOf<AEnemy> Class;
+		float Speed;
+		float WaitMin;
+		float WaitMax;
+		double PatrolRadiusSquared;
+		float HalfHeight;
+	};
+
+	/// Patrol route waypoints, copied so entities can be moved off the game thread
+	struct FEntityRoute
+	{
+		TWeakObjectPtr<APatrolRoute> Route;
+		TArray<FVector> Waypoints;
+	};
+
+	int32 FindOrAddClass(TSubclassOf<AEnemy> EnemyClass);
+	/// Index into Routes, INDEX_NONE for no route
+	int32 FindOrAddRoute(APatrolRoute* PatrolRoute);
+	void RemoveEntity(int32 Entity);
+
+	/// Walk patrolling entities towards their waypoints, in parallel
+	void MoveEntities(float DeltaTime);
+	/// Send entities that reached their waypoint on to the next one
+	void AdvanceArrivedEntities();
+	/// Promote entities near the player to actors and demote actors far from the player
+	void UpdatePromotions();
+	void Promote(int32 Entity);
+	void Demote(int32 Entity);
+	/// Ground location to spawn an entity's actor at
+	FVector FindActorLocation(int32 Entity) const;
+
+	/**
+	 * Per entity data
+	 */
+
+	TArray<FVector> Locations;
+	TArray<float> Yaws;
+	/// Index into Classes
+	TArray<int32> ClassIndices;
+	/// Index into Routes, or INDEX_NONE
+	TArray<int32> RouteIndices;
+	TArray<int32> Waypoints;
+	TArray<EEnemyState> States;
+	TArray<float> Healths;
+	TArray<int32> Souls;
+	/// Seconds left waiting at the current waypoint
+	TArray<float> WaitTimes;
+	/// Reached the current waypoint in the last move pass
+	TArray<bool> Arrived;
+	/// Within promotion range as of the last promotion pass
+	TArray<bool> InRange;
+	/// Actor standing in for each entity, null while the entity is simulated
+	TArray<TWeakObjectPtr<AEnemy>> Actors;
+
+	TArray<FEntityClass> Classes;
+	TArray<FEntityRoute> Routes;
+
+	float TimeUntilPromotionUpdate = 0;
+	int32 NumActors = 0;
+	int32 NumPromoted = 0;
+	int32 NumDemoted = 0;
+
+	/// Latest pass timings in milliseconds
+	double MoveMs = 0;
+	double ArrivalMs = 0;
+	double PromotionMs = 0;
+};
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatCoordinatorSubsystem.generated.h"
+
+class AEnemy;
+
+/**
+ * Caps how many enemies attack the same target at once by handing out attack tokens.
+ *
+ * Each target has `Slash.Combat.AttackTokensPerTarget` tokens.  An enemy in attack radius asks for one
+ * before starting its attack, and gives it back when the attack ends, it stops attacking or it dies.
+ * Enemies denied a token wait in line, circling the target, and are handed the next free token in the
+ * order they asked, so tokens rotate between every enemy around the target.
+ *
+ * Fewer simultaneous attackers means fewer attack montages, weapon collision and weapon traces at once.
+ * Tokens granted, denied and waiting are shown in `stat SlashCombat`.
+ */
+UCLASS()
+class SLASH_API UCombatCoordinatorSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Ask for a token to attack a target.  Returns true if the enemy holds one, otherwise the enemy waits
+	 * in line and AEnemy::OnAttackTokenGranted is called once a token is free
+	 */
+	bool RequestAttackToken(AEnemy* Enemy, AActor* Target);
+	/// Give up a held token or a place in line
+	void ReleaseAttackToken(AEnemy* Enemy);
+	bool HasAttackToken(const AEnemy* Enemy) const;
+
+	FORCEINLINE int32 GetNumGranted() const { return NumGranted; }
+	/// Requests not granted a token, each putting an enemy in line
+	FORCEINLINE int32 GetNumDenied() const { return NumDenied; }
+	/// Tokens granted to enemies after waiting in line, counted in GetNumGranted too
+	FORCEINLINE int32 GetNumGrantedWaiting() const { return NumGrantedWaiting; }
+	/// Most enemies holding tokens at the same time
+	FORCEINLINE int32 GetPeakAttackers() const { return PeakAttackers; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// Tokens for one target
+	struct FTargetTokens
+	{
+		TArray<TWeakObjectPtr<AEnemy>> Holders;
+		/// Enemies waiting for a token, longest waiting first
+		TArray<TWeakObjectPtr<AEnemy>> Queue;
+	};
+
+	using FGrantedEnemies = TArray<AEnemy*, TInlineAllocator<4>>;
+
+	/// Hand free tokens to enemies waiting in line
+	void GrantWaiting(FTargetTokens& Tokens, FGrantedEnemies& OutGranted);
+	/// Tell enemies they were handed a token, once token bookkeeping is done
+	static void NotifyGranted(const FGrantedEnemies& Granted);
+	/// Drop holders and waiting enemies destroyed without releasing
+	void RemoveStale(FTargetTokens& Tokens);
+	void UpdateCounters();
+
+	TMap<TObjectKey<AActor>, FTargetTokens> TargetTokens;
+	/// Target each enemy holds or waits for a token of
+	TMap<TObjectKey<AEnemy>, TObjectKey<AActor>> EnemyTargets;
+
+	int32 NumGranted = 0;
+	int32 NumDenied = 0;
+	int32 NumGrantedWaiting = 0;
+	int32 NumHolders = 0;
+	int32 NumWaiting = 0;
+	int32 PeakAttackers = 0;
+};
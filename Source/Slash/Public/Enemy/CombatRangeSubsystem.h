@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatRangeSubsystem.generated.h"
+
+class AEnemy;
+
+/// Where an enemy is relative to its combat target
+enum class ECombatRange : uint8
+{
+	/// Outside combat radius, the enemy loses interest
+	Outside,
+	/// Inside combat radius but outside attack radius
+	Combat,
+	/// Inside attack radius
+	Attack
+};
+
+/**
+ * Tells enemies when they cross their combat and attack radii around their combat target, so enemies in
+ * combat only decide what to do when their range changes instead of measuring the distance every frame.
+ *
+ * A radius is entered at its own distance but only left `Slash.Combat.RangeHysteresis` further out, so
+ * an enemy standing on the edge doesn't flip between ranges.  After each check, the enemy and its target
+ * can move as far as the distance to the nearest radius that could be crossed before the range can change,
+ * and nothing is checked again until they have:
+ *   - enemies report their own movement through transform updates of their root component
+ *   - targets, few and usually moving, have the distance they travelled summed once per frame, and the
+ *     checks of enemies watching a target wait in a heap ordered by the travelled distance they are due at
+ *
+ * Enemies and targets standing still cost nothing.  With `Slash.Combat.RangeEvents` off when a world starts,
+ * enemies measure their range every frame again.  Checks and events are shown in `stat SlashCombat`.
+ */
+UCLASS()
+class SLASH_API UCombatRangeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Watch an enemy's range to a target instead of what it watched before, returning the current range.
+	 * AEnemy::OnCombatRangeChanged is called with the range on the next tick, and whenever it changes after
+	 */
+	ECombatRange Watch(AEnemy* Enemy, AActor* Target, double AttackRadius, double CombatRadius);
+	void Unwatch(AEnemy* Enemy);
+
+	FORCEINLINE int32 GetNumWatched() const { return WatchIndices.Num(); }
+	FORCEINLINE int32 GetNumChecks() const { return NumChecks; }
+	FORCEINLINE int32 GetNumEvents() const { return NumEvents; }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// An enemy's range to its combat target
+	struct FRangeWatch
+	{
+		TObjectKey<AEnemy> Enemy;
+		TObjectKey<AActor> Target;
+		/// Component whose transform updates report the enemy's movement
+		TWeakObjectPtr<USceneComponent> RootComponent;
+		FDelegateHandle MovedHandle;
+		double AttackRadius;
+		double CombatRadius;
+		ECombatRange Range = ECombatRange::Outside;
+
+		/// Enemy location at the last check
+		FVector CheckedLocation;
+		/// Target's travelled distance at the last check
+		double CheckedOdometer = 0;
+		/// How far the enemy and target may move together after the last check before the range can change
+		double Slack = 0;
+		/// Enemy movement since the last check when its due check was last moved up
+		double RequeuedTravel = 0;
+		/// Matches the latest due check pushed for this watch, older ones are skipped
+		uint32 Generation = 0;
+		bool bQueued = false;
+		/// Report the range on the next check even if it didn't change
+		bool bNotify = false;
+	};
+
+	/// When a watch has to be checked again, by its target's travelled distance
+	struct FRangeCheck
+	{
+		double DueOdometer;
+		int32 WatchIndex;
+		uint32 Generation;
+	};
+
+	/// A target watched by one or more enemies
+	struct FWatchedTarget
+	{
+		TWeakObjectPtr<AActor> Actor;
+		FVector LastLocation;
+		/// Total distance travelled since watching started
+		double Odometer = 0;
+		/// Min-heap of due checks
+		TArray<FRangeCheck> Checks;
+		TArray<int32> WatchIndices;
+	};
+
+	using FRangeEvents = TArray<TPair<TObjectKey<AEnemy>, ECombatRange>, TInlineAllocator<16>>;
+
+	/// Measure a watch's range, schedule its next check and return whether the range changed
+	bool CheckRange(int32 WatchIndex, FWatchedTarget& WatchedTarget);
+	/// Have a watch checked on the next tick
+	void QueueCheck(int32 WatchIndex);
+	void PushCheck(FWatchedTarget& WatchedTarget, int32 WatchIndex, double DueOdometer);
+	/// Unbind and free a watch, leaving its target's list of watches to the caller
+	void ReleaseWatch(int32 WatchIndex);
+	/// Transform update of an enemy's root component
+	void OnEnemyMoved(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport, int32 WatchIndex);
+
+	TSparseArray<FRangeWatch> Watches;
+	TMap<TObjectKey<AEnemy>, int32> WatchIndices;
+	TMap<TObjectKey<AActor>, FWatchedTarget> Targets;
+	/// Watches to check on the next tick
+	TArray<int32> Queued;
+	uint32 NextGeneration = 0;
+
+	int32 NumChecks = 0;
+	int32 NumEvents = 0;
+};
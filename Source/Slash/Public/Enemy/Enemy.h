@@ -5,15 +5,24 @@
 #include "CoreMinimal.h"
 #include "EnemyTypes.h"
 #include "Character/BaseCharacter.h"
+#include "Interfaces/PoolableInterface.h"
+#include "Scheduling/TimingWheel.h"
 #include "Enemy.generated.h"
 
+class APatrolRoute;
 class ASoul;
+class FEnemyStateTree;
+class UEnemyAISubsystem;
 enum class EEnemyState : uint8;
+enum class EEnemyAIDecision : uint8;
+enum class EEnemyAILOD : uint8;
+enum class ECombatRange : uint8;
+enum class EEnemyEvent : uint8;
 class AAIController;
 class UWidgetComponent;
 
 UCLASS()
-class SLASH_API AEnemy : public ABaseCharacter
+class SLASH_API AEnemy : public ABaseCharacter, public IPoolableInterface
 {
 	GENERATED_BODY()
 
@@ -24,11 +33,34 @@ public:
 	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser) override;
 
 	virtual void GetHit_Implementation(const FVector& ImpactPoint, AActor* Hitter) override;
+
+	/// State tree deciding what enemies of this class do, see MakeStateTree
+	virtual const FEnemyStateTree& GetStateTree() const;
+	/// Evaluate the state tree for something that happened to this enemy
+	void SendStateTreeEvent(EEnemyEvent Event);
+
+	/// Act on a combat or patrol decision, from either the batched AI pass or this enemy's own tick
+	void ApplyAIDecision(EEnemyAIDecision Decision);
+	/// Scale movement, sensing and animation work to an AI level of detail tier
+	void ApplyAILOD(EEnemyAILOD LOD);
+	/// Switch between being steered by a shared pursuit field and moving to the combat target itself
+	void SetPursuitSteering(bool bSteeredByField);
+	/// Patrol a route, joining it at the closest waypoint
+	void SetPatrolRoute(APatrolRoute* Route);
+	/// Called by the combat coordinator when a waiting enemy is handed an attack token
+	void OnAttackTokenGranted();
+	/// Called by the combat range subsystem when this enemy's range to its combat target changes
+	void OnCombatRangeChanged(ECombatRange Range);
+
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+
+	FORCEINLINE EEnemyState GetEnemyState() const { return EnemyState; }
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	virtual bool CanAttack() override;
 	virtual void Attack() override;
 	virtual void AttackEnd() override;
 
@@ -39,9 +71,12 @@ protected:
 	virtual void Die() override;
 	/// Callback when actor is destroyed
 	virtual void Destroyed() override;
+	/// Return to the actor pool once the death life span is over
+	void DeathTimerFinished();
 
+	/// Perception callback when a pawn is newly seen or lost
+	void OnPerceptionChanged(APawn* Pawn, bool bSeen);
 	/// On pawn seen callback
-	UFUNCTION()
 	void OnPawnSeen(APawn* Pawn);
 
 	/// Return whether in target range of a target actor
@@ -49,31 +84,52 @@ protected:
 
 	/// Move Enemy to a target actor
 	FORCEINLINE void MoveToTarget(TObjectPtr<AActor> Target);
+	/// Move Enemy to its current patrol waypoint or patrol target
+	void MoveToPatrolGoal();
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	EEnemyState EnemyState = EEnemyState::Patrolling;
 
 private:
+	friend UEnemyAISubsystem;
+	friend FEnemyStateTree;
+	friend class UAmbientEnemySubsystem;
+
+	/// Patrol, chase, attack and death behaviour of every enemy
+	static FEnemyStateTree MakeStateTree();
+
 	void SpawnDefaultWeapon();
+	/// Join the AI, perception, scheduling and spatial subsystems of this world
+	void RegisterWithSubsystems();
+	void UnregisterFromSubsystems();
+	/// Carry over an ambient entity's patrol, health and souls after being promoted to this actor
+	void RestoreAmbientState(APatrolRoute* Route, int32 Waypoint, float Health, int32 Souls);
 	
 	/**
 	 * AI Behavior
 	 */
 
-	/// Hide health bar widget
+	/// Hide health bar
 	FORCEINLINE void HideHealthBar();
-	/// Show health bar widget
+	/// Show health bar
 	FORCEINLINE void ShowHealthBar();
-	/// Lose interest in the combat target
-	void LoseInterest();
-	/// Start patrolling action
-	void StartPatrolling();
-	/// Chase combat target
-	void ChaseTarget();
+	/// Check if the enemy's state is in the combat branch of its state tree
+	FORCEINLINE bool IsInCombat() const;
+
+	/**
+	 * State tree conditions
+	 */
+
 	/// Check if enemy is outside of its combat radius with CombatTarget
 	FORCEINLINE bool IsOutsideCombatRadius();
 	/// Check if enemy is within its attack radius of Combat Target
 	FORCEINLINE bool IsInAttackRadius();
+	bool IsOutsideAttackRadius();
+	bool HasCombatTarget();
+	/// Check if the pawn of a PawnSeen event can be engaged
+	bool IsSeenPawnEngageable();
+	/// Check if in attack radius and given an attack token for the combat target, otherwise wait in line for one
+	bool TakeAttackToken();
 	/// Check if in chasing state
 	FORCEINLINE bool IsChasing();
 	/// Check if enemy is attacking
@@ -82,23 +138,123 @@ private:
 	FORCEINLINE bool IsDead();
 	/// Check if enemy is engaged in combat
 	FORCEINLINE bool IsEngaged();
-	/// Check if combat target should change
-	FORCEINLINE void CheckCombatTarget();
+	/// Check if enemy is waiting for an attack token
+	FORCEINLINE bool IsWaiting();
 	/// Check if patrol target should change
 	FORCEINLINE void CheckPatrolTarget();
+	/// Decide what to do about the patrol target
+	EEnemyAIDecision EvaluatePatrolDecision();
+
+	/**
+	 * State tree tasks and actions
+	 */
+
+	/// Start patrolling action
+	void StartPatrolling();
+	/// Chase combat target
+	void ChaseTarget();
+	/// Hold around the combat target until given an attack token
+	void WaitForAttackToken();
+	/// Start the enemy's death, once dead
+	void BeginDeath();
+	/// Lose interest in the combat target
+	void LoseInterest();
+	/// Make the pawn of a PawnSeen event the combat target
+	void EngageSeenPawn();
+	/// Stop a swing in progress
+	void InterruptAttack();
+	/// Pick a new patrol target and wait before moving to it
+	void SelectNextPatrolTarget();
+	/// Give up an attack token or place in line for one
+	void ReleaseAttackToken();
+	void StopPursuit();
+	void StopMovement();
+	/// Step to another spot around the combat target while waiting
+	void CircleCombatTarget();
+	void ClearWaitTimer();
+	/// Location of the current patrol waypoint or patrol target, if any
+	TOptional<FVector> GetPatrolGoal() const;
+
+	/**
+	 * State changes, mirrored to the batched AI pass
+	 */
+
+	void SetEnemyState(EEnemyState State);
+	void SetCombatTarget(AActor* Target);
+	void SetPatrolTarget(AActor* Target);
+	void SetPatrolWaypoint(int32 Waypoint);
+	/// Push the current patrol goal to the batched AI pass
+	void UpdatePatrolGoal();
+
+	/// Batched AI pass this enemy is registered with
+	UPROPERTY(Transient)
+	TObjectPtr<UEnemyAISubsystem> EnemyAISubsystem;
+	/// Shared sight checks this enemy is registered with
+	UPROPERTY(Transient)
+	TObjectPtr<class UEnemyPerceptionSubsystem> PerceptionSubsystem;
+	/// Shared flow fields for chasing combat targets
+	UPROPERTY(Transient)
+	TObjectPtr<class UPursuitFieldSubsystem> PursuitSubsystem;
+	/// Attack tokens limiting how many enemies attack a target at once
+	UPROPERTY(Transient)
+	TObjectPtr<class UCombatCoordinatorSubsystem> CombatCoordinator;
+	/// Combat and attack radius events, null if enemies measure their range every frame
+	UPROPERTY(Transient)
+	TObjectPtr<class UCombatRangeSubsystem> CombatRangeSubsystem;
+	/// Range to the combat target as of the last combat range event
+	ECombatRange CombatRange;
+	/// Pawn of the PawnSeen event being evaluated
+	APawn* SeenPawn = nullptr;
+	/// Slot in the batched AI pass, INDEX_NONE if not registered
+	int32 EnemyAIIndex = INDEX_NONE;
+	/// Current AI level of detail tier
+	EEnemyAILOD AILOD;
+
+	/// Own tick interval in seconds at reduced detail, when not batched
+	UPROPERTY(EditAnywhere, Category = "AI LOD")
+	float ReducedTickInterval = 0.1;
+	/// Sensing interval multiplier at reduced detail
+	UPROPERTY(EditAnywhere, Category = "AI LOD")
+	float ReducedSensingIntervalScale = 4;
 
 
 	/**
 	 * Combat
 	 */
 
+	/// Gameplay timers this enemy's attack and patrol delays are armed on
+	UPROPERTY(Transient)
+	TObjectPtr<class UGameplaySchedulerSubsystem> Scheduler;
+	/// Arm a timer on the scheduler, or on the world's timer manager in worlds without one
+	template <void (AEnemy::*Function)()>
+	void SetEnemyTimer(FScheduledTimerHandle& Handle, FTimerHandle& FallbackHandle, float Delay);
+	void ClearEnemyTimer(FScheduledTimerHandle& Handle, FTimerHandle& FallbackHandle);
+
 	/// Timer handle for how long enemy stays in an Attacking state
-	FTimerHandle AttackTimer;
+	FScheduledTimerHandle AttackTimer;
+	FTimerHandle AttackFallbackTimer;
 	UFUNCTION()
 	void StartAttackTimer();
 	/// Cancel the patrol timer
 	void ClearAttackTimer();
 
+	/// Timer handle for moving to another spot while waiting for an attack token
+	FScheduledTimerHandle WaitTimer;
+	FTimerHandle WaitFallbackTimer;
+
+	/// Distance from the combat target to wait at, as a fraction of the attack radius
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float WaitingRadiusScale = 0.8;
+	/// Most degrees to step around the combat target at a time while waiting
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float WaitingStepAngle = 40;
+	/// Min time in seconds between steps while waiting
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float WaitingStepMin = 1;
+	/// Max time in seconds between steps while waiting
+	UPROPERTY(EditAnywhere, Category = Combat)
+	float WaitingStepMax = 2.5;
+
 	/// Minimum time in seconds of attack timer
 	UPROPERTY(EditAnywhere, Category = Combat)
 	float AttackMin = 0.4;
@@ -114,19 +270,28 @@ private:
 
 	UPROPERTY(EditAnywhere, Category = Combat)
 	float DeathLifeSpan = 8;
+	/// Timer handle for how long the dead body stays before going back to the pool
+	FScheduledTimerHandle DeathTimer;
 
 	
+	/// Health bars drawn by the HUD, shown over this enemy once damaged
+	UPROPERTY(Transient)
+	TObjectPtr<class UHealthBarSubsystem> HealthBars;
+
+
 	/**
-	 * Components
+	 * Perception
 	 */
 
-	/// Health bar widget component
-	UPROPERTY(VisibleAnywhere)
-	TObjectPtr<class UHealthBarComponent> HealthBar;
-
-	/// Pawn sensor
-	UPROPERTY(VisibleAnywhere)
-	TObjectPtr<class UPawnSensingComponent> PawnSensingComponent;
+	/// How far the enemy can see
+	UPROPERTY(EditAnywhere, Category = "AI Perception")
+	double SightRadius = 4000;
+	/// Half angle in degrees of the enemy's sight cone
+	UPROPERTY(EditAnywhere, Category = "AI Perception")
+	double PeripheralVisionAngle = 45;
+	/// Seconds between sight checks at full detail
+	UPROPERTY(EditAnywhere, Category = "AI Perception")
+	float SensingInterval = 0.5;
 
 	/// Weapon the Enemy can equip
 	UPROPERTY(EditAnywhere, Category = "Combat")
@@ -151,12 +316,18 @@ private:
 	/// Soul class to spawn on death
 	UPROPERTY(EditAnywhere, Category = "Loot")
 	TSubclassOf<ASoul> SoulClass;
+	/// Souls kept ready in the actor pool
+	UPROPERTY(EditAnywhere, Category = "Loot")
+	int32 SoulPrewarmCount = 4;
 
 	// Timer handle for wait time at patrol points
-	// FTimer is a timer that holds a callback function that executes when timer is finished
-	FTimerHandle PatrolTimer;
+	// Scheduled timers call back into the enemy when finished, see UGameplaySchedulerSubsystem
+	FScheduledTimerHandle PatrolTimer;
+	FTimerHandle PatrolFallbackTimer;
 	UFUNCTION()
 	void PatrolTimerFinished();
+	/// Wait Delay seconds before moving to the patrol goal
+	void StartPatrolTimer(float Delay);
 	/// Cancel the patrol timer
 	void ClearPatrolTimer();
 
@@ -174,6 +345,15 @@ private:
 	UPROPERTY()
 	TObjectPtr<AAIController> AIController;
 
+	/// Shared route to patrol.  Takes priority over PatrolTargets when set
+	UPROPERTY(EditInstanceOnly, Category = "AI Navigation")
+	TObjectPtr<APatrolRoute> PatrolRoute;
+
+	/// Current waypoint on PatrolRoute, INDEX_NONE before patrolling starts
+	int32 PatrolWaypoint = INDEX_NONE;
+	/// Waypoint on PatrolRoute the current leg started from
+	int32 PreviousPatrolWaypoint = INDEX_NONE;
+
 	// Current patrol target
 	UPROPERTY(EditInstanceOnly, Category = "AI Navigation")
 	TObjectPtr<AActor> PatrolTarget;
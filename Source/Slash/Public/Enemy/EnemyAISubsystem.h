@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyAISubsystem.generated.h"
+
+class AEnemy;
+enum class EEnemyState : uint8;
+
+/// Decision made for a single enemy during an AI pass
+enum class EEnemyAIDecision : uint8
+{
+	/// Nothing to do this frame
+	None,
+	/// Combat target is gone or outside of combat radius
+	LoseInterest,
+	/// Combat target is outside of attack radius
+	Chase,
+	/// Combat target is inside attack radius
+	Attack,
+	/// Reached current patrol target
+	NextPatrolTarget
+};
+
+/// How much work an enemy does, chosen by distance and visibility to the player
+enum class EEnemyAILOD : uint8
+{
+	/// Decisions every frame, full movement, sensing and animation
+	Full,
+	/// Decisions every few frames, slower sensing, animation only when rendered
+	Reduced,
+	/// No decisions, movement, sensing or animation until woken by proximity or damage
+	Dormant
+};
+
+/**
+ * Evaluates combat and patrol decisions for all enemies in one pass per frame.
+ *
+ * Enemy state is mirrored into contiguous arrays (struct-of-arrays) so the decision pass walks tightly
+ * packed data instead of chasing actor pointers, and enemies are only called into when they have to act.
+ * Enemy ticks are disabled while batching is enabled, toggle with `Slash.EnemyAI.Batched` and compare
+ * the two paths with `stat SlashEnemyAI`.
+ * Combat decisions are left to combat range events when UCombatRangeSubsystem is running.
+ *
+ * Enemies are also sorted into level of detail tiers by distance and visibility to the player, see
+ * `Slash.EnemyAI.LOD.*` and `stat SlashAILOD`.
+ */
+UCLASS()
+class SLASH_API UEnemyAISubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/// Add an enemy to the batched AI pass
+	void RegisterEnemy(AEnemy* Enemy);
+	/// Remove an enemy from the batched AI pass
+	void UnregisterEnemy(AEnemy* Enemy);
+
+	/// Mirror an enemy's state change
+	void SetEnemyState(const AEnemy* Enemy, EEnemyState State);
+	/// Mirror an enemy's combat target change
+	void SetCombatTarget(const AEnemy* Enemy, AActor* Target);
+	/// Mirror an enemy's patrol goal change, a route waypoint or patrol target location.  Null clears the goal
+	void SetPatrolGoal(const AEnemy* Enemy, const FVector* Goal);
+	/// Bring an enemy back to full detail immediately, e.g. when damaged
+	void WakeEnemy(AEnemy* Enemy);
+
+	/// Whether enemy decisions are made by this subsystem instead of each enemy's own tick
+	static bool IsBatchingEnabled();
+
+	FORCEINLINE int32 GetNumEnemies() const { return Enemies.Num(); }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// Find the shared target slot for an actor, adding one if needed.  Returns INDEX_NONE for null actors
+	int32 AcquireTarget(AActor* Target);
+	/// Release a reference to a shared target slot
+	void ReleaseTarget(int32 TargetIndex);
+	/// Point an enemy's target slot at a new actor
+	void ReplaceTarget(int32& TargetIndex, AActor* Target);
+
+	/// Copy enemy and target locations into the contiguous location arrays
+	void GatherLocations();
+	/// Decide what every enemy should do this frame, touching only the packed arrays
+	void EvaluateDecisions();
+	/// Call back into enemies that have something to do
+	void DispatchDecisions();
+	/// Pick level of detail tiers from distance and visibility to the player
+	void UpdateLODs();
+	void SetLOD(int32 Index, EEnemyAILOD LOD);
+
+	void SetEnemyTicksEnabled(bool bEnabled);
+
+	/**
+	 * Per enemy data, indexed by AEnemy::EnemyAIIndex
+	 */
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<AEnemy>> Enemies;
+	TArray<EEnemyState> States;
+	/// Whether each enemy's state is in the combat branch of its state tree
+	TArray<bool> InCombat;
+	TArray<FVector> Locations;
+	TArray<double> CombatRadiiSquared;
+	TArray<double> AttackRadiiSquared;
+	TArray<double> PatrolRadiiSquared;
+	/// Index into Targets for the combat target, or INDEX_NONE
+	TArray<int32> CombatTargetIndices;
+	/// Patrol goals never move, so their locations are stored per enemy instead of as shared targets
+	TArray<FVector> PatrolGoals;
+	TArray<bool> HasPatrolGoals;
+	TArray<EEnemyAIDecision> Decisions;
+	TArray<EEnemyAILOD> LODs;
+
+	/**
+	 * Targets shared between enemies so each target location is only read once per frame
+	 */
+
+	TArray<TWeakObjectPtr<AActor>> Targets;
+	/// Keys stay valid for lookup removal after the target actor is destroyed
+	TArray<TObjectKey<AActor>> TargetKeys;
+	TArray<FVector> TargetLocations;
+	TArray<int32> TargetRefCounts;
+	TArray<int32> FreeTargetIndices;
+	TMap<TObjectKey<AActor>, int32> TargetIndices;
+
+	/// Batching state applied to registered enemies, to detect console variable changes
+	bool bBatchingApplied = true;
+
+	/// Seconds until tiers are picked again
+	float TimeUntilLODUpdate = 0;
+	/// Staggers reduced tier decisions across frames
+	uint32 FrameCounter = 0;
+};
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyPerceptionSubsystem.generated.h"
+
+class USpatialHashSubsystem;
+
+/// Called when a sensor starts (bSeen true) or stops (bSeen false) seeing a pawn
+DECLARE_DELEGATE_TwoParams(FOnPerceptionChanged, APawn* /* Pawn */, bool /* bSeen */);
+
+/**
+ * Shared sight checks for all enemies, replacing a UPawnSensingComponent per enemy.
+ *
+ * Sensors are the enemies looking, stimuli are the pawns that can be seen.  Each frame the sensors due for
+ * an update are paired with nearby stimuli found through the spatial hash, range and cone tests run over
+ * the packed pairs in one pass, and line of sight traces are queued and issued first in first out under
+ * a fixed per frame budget (`Slash.Perception.TraceBudget`) so every sensor gets its turn.
+ *
+ * Sensors are only notified when what they see changes.
+ */
+UCLASS()
+class SLASH_API UEnemyPerceptionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/// Start sensing for a pawn.  PeripheralVisionAngle is the half angle of the sight cone in degrees
+	void RegisterSensor(APawn* Sensor, double SightRadius, double PeripheralVisionAngle, float SensingInterval, FOnPerceptionChanged OnPerceptionChanged);
+	void UnregisterSensor(APawn* Sensor);
+	/// Pause or resume sensing, e.g. for dormant enemies
+	void SetSensorEnabled(APawn* Sensor, bool bEnabled);
+	void SetSensingInterval(APawn* Sensor, float SensingInterval);
+	/// Forget that a sensor sees a pawn, so it is reported as newly seen if still in sight
+	void ForgetPawn(APawn* Sensor, APawn* Pawn);
+
+	/// Allow a pawn to be seen by sensors
+	void RegisterStimulus(APawn* Pawn);
+	void UnregisterStimulus(APawn* Pawn);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/// Stimulus slots are tracked in a 64 bit mask per sensor
+	static constexpr int32 MaxStimuli = 64;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// Count down sensing intervals and flag sensors due for an update
+	int32 UpdateDueSensors(float DeltaTime);
+	/// Pair due sensors with nearby stimuli, test range and cone, and queue line of sight traces
+	void SenseDueSensors();
+	/// Issue queued line of sight traces up to the frame budget
+	void ProcessTraces();
+	/// Mark a sensor as seeing or not seeing a stimulus, notifying on change
+	void SetSeen(int32 SensorIndex, int32 StimulusIndex, bool bSeen);
+
+	UPROPERTY(Transient)
+	TObjectPtr<USpatialHashSubsystem> SpatialHash;
+
+	/**
+	 * Per sensor data, indexed by sensor slot
+	 */
+
+	TArray<TWeakObjectPtr<APawn>> Sensors;
+	TArray<double> SightRadiiSquared;
+	/// Cosine of the peripheral vision angle times its absolute value, so cone tests need no square root
+	TArray<double> SignedCosSquared;
+	TArray<float> SensingIntervals;
+	TArray<float> TimesUntilSense;
+	TArray<bool> SensorsEnabled;
+	TArray<bool> SensorsDue;
+	/// Bit per stimulus slot currently seen
+	TArray<uint64> SeenMasks;
+	/// Bit per stimulus slot with a line of sight trace queued
+	TArray<uint64> PendingMasks;
+	TArray<FOnPerceptionChanged> Callbacks;
+	TArray<int32> SensorSpatialHandles;
+	TMap<TObjectKey<APawn>, int32> SensorIndices;
+	/// Spatial hash handle to sensor slot, for finding sensors near a stimulus
+	TMap<int32, int32> SensorsBySpatialHandle;
+	double MaxSightRadius = 0;
+
+	/**
+	 * Stimuli, indexed by stable stimulus slot
+	 */
+
+	TArray<TWeakObjectPtr<APawn>> Stimuli;
+	TArray<FVector> StimulusLocations;
+
+	/**
+	 * Sensor/stimulus pairs tested in one pass, rebuilt every update
+	 */
+
+	TArray<int32> PairSensors;
+	TArray<int32> PairStimuli;
+	TArray<FVector> PairOffsets;
+	TArray<FVector> PairForwards;
+	TArray<bool> PairPassed;
+	/// Bit per stimulus slot inside each sensor's cone this update
+	TArray<uint64> InConeMasks;
+	TArray<int32> NearbyHandles;
+
+	/// Queued line of sight trace
+	struct FPendingTrace
+	{
+		TWeakObjectPtr<APawn> Sensor;
+		int32 Stimulus;
+	};
+	/// First in first out, consumed from PendingHead
+	TArray<FPendingTrace> PendingTraces;
+	int32 PendingHead = 0;
+};
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AEnemy;
+enum class EEnemyState : uint8;
+
+/// Something that happened to an enemy.  Enemy state trees are only evaluated when one of these is sent
+enum class EEnemyEvent : uint8
+{
+	/// A pawn came into sight
+	PawnSeen,
+	/// Took damage, the combat target is whoever dealt it
+	Damaged,
+	/// Range to the combat target changed, see UCombatRangeSubsystem
+	RangeChanged,
+	/// The attack timer ran out
+	AttackTimerFinished,
+	/// The attack montage ended
+	AttackEnded,
+	/// Handed an attack token, see UCombatCoordinatorSubsystem
+	AttackTokenGranted,
+	/// Reached the current patrol goal
+	PatrolGoalReached,
+	Died,
+};
+
+/**
+ * Native state tree of enemy behaviour.
+ *
+ * Every EEnemyState is a leaf of the tree, under branches grouping states such as being in combat.  States
+ * and branches have enter and exit tasks, and transitions on an event with an optional condition, an
+ * optional action and the state to go to.  Sending an event tries the transitions of the enemy's state,
+ * then of each branch above it, and takes the first whose condition holds.  Changing state runs exit
+ * tasks up to the branch shared with the new state, then enter tasks down to it.
+ *
+ * Nothing is evaluated between events, so an enemy with nothing happening to it costs nothing.  Conditions,
+ * tasks and actions are AEnemy member functions.  Time spent evaluating each tree is shown under its name
+ * in `stat SlashEnemyAI`, next to counts of events and transitions.
+ */
+class SLASH_API FEnemyStateTree
+{
+public:
+	using FCondition = bool (AEnemy::*)();
+	using FTask = void (AEnemy::*)();
+
+	/// Index of the root branch every branch and state is under
+	static constexpr int32 Root = 0;
+
+	explicit FEnemyStateTree(FName InName);
+
+	/// Add a branch under another, returns its index
+	int32 AddBranch(FName BranchName, int32 Parent, FTask EnterTask = nullptr, FTask ExitTask = nullptr);
+	/// Add a state under a branch, returns its index
+	int32 AddState(EEnemyState State, int32 Parent, FTask EnterTask = nullptr, FTask ExitTask = nullptr);
+	/**
+	 * Add a transition to a state or branch.  Transitions are tried in the order added.  An unset Target stays
+	 * in the current state, and a Target that is the current state is only left and entered again if bReenter
+	 */
+	void AddTransition(int32 Node, EEnemyEvent Event, FCondition Condition, FTask Action, TOptional<EEnemyState> Target, bool bReenter = false);
+	/// Mark the branch whose states have a combat target, see IsInCombat
+	void SetCombatBranch(int32 Branch);
+
+	/// Evaluate transitions for an event, returns whether one was taken
+	bool SendEvent(AEnemy& Enemy, EEnemyEvent Event) const;
+	/// Whether a state is in the combat branch
+	bool IsInCombat(EEnemyState State) const;
+	FORCEINLINE FName GetName() const { return Name; }
+
+private:
+	struct FTransition
+	{
+		EEnemyEvent Event;
+		FCondition Condition;
+		FTask Action;
+		TOptional<EEnemyState> Target;
+		bool bReenter;
+	};
+
+	struct FNode
+	{
+		/// Branch name for debugging, none for states
+		FName Name;
+		int32 Parent;
+		FTask EnterTask;
+		FTask ExitTask;
+		TArray<FTransition> Transitions;
+	};
+
+	int32 AddNode(FName NodeName, int32 Parent, FTask EnterTask, FTask ExitTask);
+	int32 GetStateNode(EEnemyState State) const;
+	/// Whether a node is a branch above another, or the same node
+	bool IsUnder(int32 Node, int32 Branch) const;
+	void ChangeState(AEnemy& Enemy, EEnemyState Target, bool bReenter) const;
+
+	FName Name;
+	TArray<FNode> Nodes;
+	/// Node of each state by its value, INDEX_NONE for states not in the tree
+	TArray<int32> StateNodes;
+	int32 CombatBranch = INDEX_NONE;
+	TStatId StatId;
+};
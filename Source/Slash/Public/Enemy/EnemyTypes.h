@@ -5,7 +5,7 @@
 /// Tag indicating enemy actors
 inline static FName EnemyTag = FName("Enemy");
 
-/// Action states
+/// Action states, the leaves of the enemy state tree, see AEnemy::MakeStateTree
 UENUM(BlueprintType)
 enum class EEnemyState : uint8
 {
@@ -19,4 +19,6 @@ enum class EEnemyState : uint8
 	Attacking,
 	/// Actually engaged in combat i.e. swinging weapon
 	Engaged,
+	/// In attack radius but waiting for an attack token, circling the target
+	Waiting,
 };
\ No newline at end of file
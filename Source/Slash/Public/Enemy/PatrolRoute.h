@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "PatrolRoute.generated.h"
+
+/// How enemies on a route pick their next waypoint
+UENUM(BlueprintType)
+enum class EPatrolRouteMode : uint8
+{
+	/// Walk the waypoints in order, looping back to the first
+	Ordered,
+	/// Pick any other waypoint at random
+	Random
+};
+
+/**
+ * Waypoints many enemies can patrol, placed once in the level.
+ *
+ * Waypoints are plain locations rather than actors, and navigation paths between consecutive waypoints
+ * are found once and shared by every enemy on the route instead of each leg querying the navmesh.
+ */
+UCLASS()
+class SLASH_API APatrolRoute : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	APatrolRoute();
+
+	FORCEINLINE int32 GetNumWaypoints() const { return WorldWaypoints.Num(); }
+	FORCEINLINE bool IsValidWaypoint(int32 Waypoint) const { return WorldWaypoints.IsValidIndex(Waypoint); }
+	FORCEINLINE const FVector& GetWaypointLocation(int32 Waypoint) const { return WorldWaypoints[Waypoint]; }
+
+	/// Waypoint to patrol to after Current, or INDEX_NONE if the route is empty
+	int32 GetNextWaypoint(int32 Current) const;
+	/// Waypoint closest to a location, or INDEX_NONE if the route is empty
+	int32 GetClosestWaypoint(const FVector& Location) const;
+	/// Path for walking from one waypoint to another, found once and reused.  Null if there is no path
+	FNavPathSharedPtr MakeLegPath(int32 From, int32 To);
+
+	virtual void PostInitializeComponents() override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	/// Index of the leg between two waypoints
+	FORCEINLINE int32 GetLegIndex(int32 From, int32 To) const { return From * WorldWaypoints.Num() + To; }
+	/// Find the navigation path for a leg
+	void BakeLeg(int32 From, int32 To);
+
+	/// Waypoints relative to this actor
+	UPROPERTY(EditAnywhere, Category = "Patrol Route", meta = (MakeEditWidget = true))
+	TArray<FVector> Waypoints;
+
+	UPROPERTY(EditAnywhere, Category = "Patrol Route")
+	EPatrolRouteMode Mode = EPatrolRouteMode::Ordered;
+
+	/// Find all paths between waypoints when play begins instead of on first use
+	UPROPERTY(EditAnywhere, Category = "Patrol Route")
+	bool bBakePathsOnBeginPlay = true;
+
+	/// Waypoints in world space, cached when components are initialized
+	TArray<FVector> WorldWaypoints;
+
+	/// Baked path points per leg, indexed by GetLegIndex
+	TArray<TArray<FVector>> LegPaths;
+	/// Whether a leg's path has been looked for, even if none was found
+	TBitArray<> LegsBaked;
+};
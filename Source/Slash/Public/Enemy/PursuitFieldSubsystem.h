@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PursuitFieldSubsystem.generated.h"
+
+class AEnemy;
+
+/**
+ * Shared flow fields for enemies chasing the same target, instead of a navmesh path query per enemy.
+ *
+ * Once enough enemies chase one target (`Slash.Pursuit.MinChasers`) a grid of cells is laid around the
+ * target, each cell is projected onto the navmesh once, and distances to the target are spread over the
+ * walkable cells.  Every chasing enemy then steers towards the neighbouring cell closest to the target.
+ * As the target moves, distances are only spread again when it crosses into another cell, and the grid
+ * only scrolls once the target nears its edge, keeping the navmesh samples of the cells still covered.
+ *
+ * Enemies chasing alone, outside the grid, or on cells the target can't be reached from use a regular
+ * AAIController::MoveTo instead.  See `stat SlashPursuit`.
+ */
+UCLASS()
+class SLASH_API UPursuitFieldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/**
+	 * Start or continue chasing a target.
+	 * Returns true if the enemy is steered by a flow field, false if it should move to the target itself
+	 */
+	bool StartPursuit(AEnemy* Enemy, AActor* Target);
+	/// Stop steering an enemy, e.g. when it stops chasing
+	void StopPursuit(AEnemy* Enemy);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FChaser
+	{
+		TWeakObjectPtr<AEnemy> Enemy;
+		/// Whether the enemy is currently steered by the field rather than its own move request
+		bool bOnField = false;
+	};
+
+	/// Flow field around one chased target
+	struct FPursuitField
+	{
+		TWeakObjectPtr<AActor> Target;
+		TArray<FChaser> Chasers;
+
+		/// World cell of the target, distances are spread again when it changes
+		FIntPoint TargetCell = FIntPoint(MAX_int32, MAX_int32);
+
+		/**
+		 * Navmesh samples, indexed by Y * GridSize + X from Origin
+		 */
+
+		/// World cell of the sampled grid's minimum corner
+		FIntPoint Origin = FIntPoint::ZeroValue;
+		/// Height of the navmesh in each cell
+		TArray<float> Heights;
+		TArray<uint8> CellStates;
+
+		/**
+		 * Spread distances, indexed by Y * GridSize + X from FlowOrigin.  Kept separate from the samples
+		 * so chasers keep following the last field while a scrolled grid is being sampled
+		 */
+
+		FIntPoint FlowOrigin = FIntPoint::ZeroValue;
+		/// Path cost to the target in tenths of a cell, MAX_uint16 if unreachable
+		TArray<uint16> Distances;
+		/// Neighbour to move to, index into the neighbour offsets or MAX_uint8 for the target cell
+		TArray<uint8> FlowDirections;
+
+		/// Cells still waiting for a navmesh sample
+		int32 NumUnsampled = 0;
+		/// Where to continue looking for unsampled cells
+		int32 SampleCursor = 0;
+		/// Distances need spreading again
+		bool bDirty = true;
+	};
+
+	/// Field for a target, creating it if needed
+	FPursuitField& FindOrAddField(AActor* Target);
+	/// Move the grid so it is centred on a cell, keeping samples of cells that stay covered
+	void ScrollField(FPursuitField& Field, const FIntPoint& CenterCell) const;
+	/// Project unsampled cells onto the navmesh, returning how many were sampled
+	int32 SampleField(FPursuitField& Field, int32 Budget, float ProbeHeight) const;
+	/// Spread distances out from the target cell and pick each cell's flow direction
+	void IntegrateField(FPursuitField& Field);
+	/// Whether chasers can follow a field
+	bool IsFieldReady(const FPursuitField& Field) const;
+	/// Direction for a chaser to move in, returns false if the field can't take it to the target
+	bool GetSteeringDirection(const FPursuitField& Field, const FVector& Location, const FVector& TargetLocation, FVector& OutDirection) const;
+	/// Whether a character can step between two neighbouring sampled cells
+	bool CanStep(const FPursuitField& Field, int32 X, int32 Y, int32 Direction) const;
+	/// Switch a chaser between field steering and its own move request
+	static void SetOnField(FChaser& Chaser, bool bOnField);
+
+	FORCEINLINE FIntPoint GetWorldCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+	}
+	/// Index of a world cell in a grid starting at Origin, INDEX_NONE if outside the grid
+	FORCEINLINE int32 GetCellIndex(const FIntPoint& Origin, const FIntPoint& WorldCell) const
+	{
+		const FIntPoint Local = WorldCell - Origin;
+		return Local.X >= 0 && Local.Y >= 0 && Local.X < GridSize && Local.Y < GridSize ? Local.Y * GridSize + Local.X : INDEX_NONE;
+	}
+
+	/// Fields by target
+	TMap<TObjectKey<AActor>, FPursuitField> Fields;
+	/// Target each chasing enemy is registered under
+	TMap<TObjectKey<AEnemy>, TObjectKey<AActor>> ChaserTargets;
+
+	double CellSize = 100;
+	int32 GridSize = 48;
+
+	/// Reused between integrations, open cells ordered by distance
+	TArray<TPair<uint16, int32>> OpenCells;
+};
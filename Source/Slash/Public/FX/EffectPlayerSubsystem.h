@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EffectPlayerSubsystem.generated.h"
+
+class UFXSystemAsset;
+
+/// How readily an effect is dropped when many are playing
+enum class EEffectImportance : uint8
+{
+	/// Culled at half the cull distance
+	Low,
+	Normal,
+	/// Never culled, takes over the oldest playing instance at the concurrency limit
+	Always
+};
+
+/// Components playing one particle system or sound, reused once finished
+USTRUCT()
+struct FEffectPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TObjectPtr<UObject> Asset;
+
+	/// Every component created for the asset
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<USceneComponent>> Components;
+	/// Indices into Components playing, oldest first
+	TArray<int32> Playing;
+	/// Indices into Components finished playing
+	TArray<int32> Free;
+};
+
+/**
+ * Plays one-shot particle systems and sounds from pooled components, instead of spawning a component for
+ * every hit and pickup.
+ *
+ * Each particle system or sound has a pool of components, created as needed and reused once they finish.
+ * At most `Slash.FX.MaxPerEffect` instances of an effect play at once, effects further than
+ * `Slash.FX.CullDistance` from the camera are skipped, and at most `Slash.FX.SpawnBudget` effects start each
+ * frame, except for effects played with EEffectImportance::Always.  Cascade and Niagara systems are both
+ * supported.  Spawned, reused and culled counts are shown in `stat SlashFX` and `Slash.FX.Stats`.
+ */
+UCLASS()
+class SLASH_API UEffectPlayerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/// Play a particle system at a location, falling back to spawning it in worlds without the subsystem
+	static void PlaySystemAtLocation(const UObject* WorldContextObject, UFXSystemAsset* System, const FVector& Location,
+		EEffectImportance Importance = EEffectImportance::Normal);
+	/// Play a sound at a location, falling back to spawning it in worlds without the subsystem
+	static void PlaySoundAtLocation(const UObject* WorldContextObject, USoundBase* Sound, const FVector& Location,
+		EEffectImportance Importance = EEffectImportance::Normal);
+
+	/// Log spawned, reused and culled counts and pool sizes
+	void DumpStats() const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// Play an asset from its pool, returns false if culled
+	bool Play(UObject* Asset, const FVector& Location, EEffectImportance Importance);
+	/// Whether an effect is skipped, for distance or the frame's budget
+	bool ShouldCull(const FVector& Location, EEffectImportance Importance) const;
+	/// Create a component for an asset, registered with the world but not playing
+	USceneComponent* CreateComponent(UObject* Asset);
+	/// Start a component from the beginning at a location
+	static void StartComponent(USceneComponent* Component, const FVector& Location);
+	static void StopComponent(USceneComponent* Component);
+	static bool IsComponentPlaying(USceneComponent* Component);
+
+	UPROPERTY(Transient)
+	TArray<FEffectPool> Pools;
+	TMap<TObjectKey<UObject>, int32> PoolIndices;
+
+	/// Camera location effects are culled around, unset without a local player
+	TOptional<FVector> ViewLocation;
+	int32 NumStartedThisFrame = 0;
+
+	int64 NumSpawned = 0;
+	int64 NumReused = 0;
+	int64 NumCulled = 0;
+};
@@ -7,7 +7,7 @@
 #include "HealthBar.generated.h"
 
 /**
- * 
+ * Health bar drawn over an actor, see UHealthBarSubsystem
  */
 UCLASS()
 class SLASH_API UHealthBar : public UUserWidget
@@ -15,6 +15,8 @@ class SLASH_API UHealthBar : public UUserWidget
 	GENERATED_BODY()
 
 public:
+	void SetHealthPercent(float Percent);
+
 	UPROPERTY(meta = (BindWidget))
 	TObjectPtr<class UProgressBar> HealthBar;
 	
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HealthBarSubsystem.generated.h"
+
+class UHealthBar;
+
+/**
+ * Draws health bars over actors from a small pool of widgets shared by the HUD, instead of every enemy
+ * owning a widget component.
+ *
+ * Actors only ask for a bar once damaged.  Each frame, the bars of actors in view and within
+ * `Slash.HealthBar.MaxDistance` are ranked by distance to the camera and the nearest
+ * `Slash.HealthBar.MaxVisible` are given a widget, projected to the screen with one view projection for all
+ * of them.  Widgets are created as needed up to that limit and reused after.  Nothing is drawn until the HUD
+ * hands over the widget class with SetWidgetClass.  Counts are shown in `stat SlashHUD`.
+ */
+UCLASS()
+class SLASH_API UHealthBarSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/// Set the widget health bars are drawn with, added to the viewport of a player
+	void SetWidgetClass(APlayerController* PlayerController, TSubclassOf<UHealthBar> WidgetClass);
+
+	/// Show a health bar over an actor, or update the one shown
+	void ShowHealthBar(AActor* Actor, float Percent);
+	/// Update the health bar over an actor, if one is shown
+	void SetHealthPercent(AActor* Actor, float Percent);
+	void HideHealthBar(AActor* Actor);
+
+	FORCEINLINE int32 GetNumShown() const { return Bars.Num(); }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// Health bar of an actor, drawn when one of the nearest
+	struct FActorBar
+	{
+		TObjectKey<AActor> Key;
+		TWeakObjectPtr<AActor> Actor;
+		float Percent;
+		/// Index into Widgets, INDEX_NONE when not drawn
+		int32 Widget = INDEX_NONE;
+	};
+
+	/// Take a widget off a bar and hide it
+	void ReleaseWidget(FActorBar& Bar);
+	/// Give a bar a free widget, creating one if there is none
+	bool AssignWidget(FActorBar& Bar);
+	void RemoveBar(int32 BarIndex);
+
+	TArray<FActorBar> Bars;
+	TMap<TObjectKey<AActor>, int32> BarIndices;
+
+	/// Every widget created, hidden while free
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UHealthBar>> Widgets;
+	/// Indices into Widgets not drawing a bar
+	TArray<int32> FreeWidgets;
+
+	UPROPERTY(Transient)
+	TSubclassOf<UHealthBar> HealthBarClass;
+	TWeakObjectPtr<APlayerController> OwningPlayer;
+};
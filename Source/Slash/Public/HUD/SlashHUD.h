@@ -6,6 +6,7 @@
 #include "GameFramework/HUD.h"
 #include "SlashHUD.generated.h"
 
+class UHealthBar;
 class USlashOverlay;
 /**
  * 
@@ -16,6 +17,8 @@ class SLASH_API ASlashHUD : public AHUD
 	GENERATED_BODY()
 
 public:
+	ASlashHUD();
+
 	virtual void BeginPlay() override;
 
 	FORCEINLINE USlashOverlay* GetSlashOverlay() const { return SlashOverlay; };
@@ -26,4 +29,8 @@ private:
 
 	UPROPERTY()
 	TObjectPtr<USlashOverlay> SlashOverlay;
+
+	/// Widget health bars over damaged enemies are drawn with, see UHealthBarSubsystem
+	UPROPERTY(EditDefaultsOnly, Category = Slash)
+	TSubclassOf<UHealthBar> HealthBarClass;
 };
@@ -6,10 +6,14 @@
 #include "Blueprint/UserWidget.h"
 #include "SlashOverlay.generated.h"
 
+class UAttributeComponent;
 class UTextBlock;
 class UProgressBar;
 /**
  * Slash Character overlay
+ *
+ * Shows the attributes of the character bound with BindAttributes, updating a widget only when its attribute
+ * changes, at most once a frame.  Widget updates are counted in `stat SlashHUD`.
  */
 UCLASS()
 class SLASH_API USlashOverlay : public UUserWidget
@@ -22,7 +26,22 @@ public:
 	void SetGold(int32 Gold);
 	void SetSouls(int32 Souls);
 
+	/// Show an attribute component's values and follow its changes, instead of any bound before
+	void BindAttributes(UAttributeComponent* Attributes);
+	void UnbindAttributes();
+
+protected:
+	virtual void NativeDestruct() override;
+
 private:
+	void OnHealthChanged(UAttributeComponent* Attributes, float OldHealth, float NewHealth);
+	void OnStaminaChanged(UAttributeComponent* Attributes, float OldStamina, float NewStamina);
+	void OnGoldChanged(UAttributeComponent* Attributes, int32 OldGold, int32 NewGold);
+	void OnSoulsChanged(UAttributeComponent* Attributes, int32 OldSouls, int32 NewSouls);
+
+	/// Attributes shown, see BindAttributes
+	TWeakObjectPtr<UAttributeComponent> BoundAttributes;
+
 	UPROPERTY(meta = (BindWidget))
 	TObjectPtr<UProgressBar> HealthBar;
 
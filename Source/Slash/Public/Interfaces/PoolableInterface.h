@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "PoolableInterface.generated.h"
+
+// This class does not need to be modified.
+UINTERFACE(MinimalAPI)
+class UPoolableInterface : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Actors that can be reused by UActorPoolSubsystem instead of being destroyed and spawned again.
+ *
+ * The pool hides the actor, disables its collision and stops its tick itself, the hooks reset everything
+ * else the actor owns: attributes, state, component collision, particles, timers and registrations.
+ */
+class SLASH_API IPoolableInterface
+{
+	GENERATED_BODY()
+
+	// Add interface functions to this class. This is the class that will be inherited to implement this interface.
+public:
+	/// Taken out of the pool and placed in the world again, reset to how it was when first spawned
+	virtual void OnAcquiredFromPool() = 0;
+	/// Put back into the pool, stop everything still running
+	virtual void OnReleasedToPool() = 0;
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Interfaces/PoolableInterface.h"
 #include "Item.generated.h"
 
 class UNiagaraSystem;
@@ -11,7 +12,7 @@ class UNiagaraComponent;
 class USphereComponent;
 
 UCLASS()
-class SLASH_API AItem : public AActor
+class SLASH_API AItem : public AActor, public IPoolableInterface
 {
 	GENERATED_BODY()
 	
@@ -26,8 +27,12 @@ public:
 	AItem();
 	virtual void Tick(float DeltaTime) override;
 
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	UFUNCTION(BlueprintPure)
 	float TransformedSin();
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SwingHitRegistry.generated.h"
+
+/// How often a weapon may hit the same actor
+UENUM(BlueprintType)
+enum class EWeaponHitPolicy : uint8
+{
+	/// Once per swing
+	OncePerSwing,
+	/// Again within a swing once the rehit interval has passed
+	Interval
+};
+
+/**
+ * Actors a weapon has hit during its current swing.
+ *
+ * Hits are kept in a map by actor, stamped with the swing they belong to, so checking and recording a hit is
+ * O(1) however many actors a swing passes through.  Starting a swing only moves the swing counter on, and
+ * hits stamped with an earlier swing count as not hit, so nothing is cleared between swings.  The map is
+ * only emptied when it has grown past a small size.
+ */
+class SLASH_API FSwingHitRegistry
+{
+public:
+	/// Start a new swing, forgetting every hit.  Returns the new swing's ID
+	uint32 BeginSwing();
+	FORCEINLINE uint32 GetSwingId() const { return SwingId; }
+
+	/// Record a hit at Time in seconds if the policy allows hitting the actor again, returns whether it did
+	bool TryRegisterHit(const AActor* Actor, double Time, EWeaponHitPolicy Policy, double RehitInterval);
+	/// Whether an actor was hit during the current swing
+	bool WasHit(const AActor* Actor) const;
+
+private:
+	struct FHitRecord
+	{
+		uint32 SwingId;
+		/// Seconds the latest hit was at
+		double Time;
+	};
+
+	TMap<TObjectKey<AActor>, FHitRecord> Hits;
+	uint32 SwingId = 0;
+};
@@ -4,12 +4,20 @@
 
 #include "CoreMinimal.h"
 #include "Items/Item.h"
+#include "Items/Weapon/SwingHitRegistry.h"
 #include "Weapon.generated.h"
 
 class UBoxComponent;
 /**
  * Base Weapon class
  *
+ * While a swing's hit window is open, the blade between BoxTraceStart and BoxTraceEnd is sampled at a fixed
+ * rate of `Slash.Weapon.SwingSubstepRate` per second of swing, interpolating its pose between frames, and
+ * swept from each sample to the next.  Every actor the blade passes through is hit once per swing, or again
+ * every RehitIntervalMs with the Interval hit policy, at the same points whatever the frame rate.  Sweeps
+ * are traced in a batch with every other weapon's by UWeaponTraceSubsystem where there is one, and hits are
+ * resolved at the end of the frame by UDamageQueueSubsystem.  Sweeps and hits are shown in `stat SlashWeapon`.
+ *
  * Note: PrioritizeCategories doesn't seem to work: https://forums.unrealengine.com/t/reorder-variable-categories-in-class-defaults/66561/78
  */
 UCLASS(meta = (PrioritizeCategories ="Physics Input Collision Lighting"))
@@ -22,31 +30,42 @@ public:
 	
 	void Equip(USceneComponent* SceneComponent, FName InSocketName, TObjectPtr<AActor> OwnerActor, TObjectPtr<APawn> InstigatorActor);
 	void AttachMeshToComponent(USceneComponent* SceneComponent, FName InSocketName);
-	bool ActorSameTagAsOwner(AActor* OtherActor, FName Tag);
 
 	/// Play Equip sound effect
 	void PlayEquipSound();
 
 	FORCEINLINE TObjectPtr<UBoxComponent> GetCollisionBox() const { return CollisionBox; }
 
-	/// Dynamic ignore actors array for weapon hit collision
-	TArray<AActor*> CollisionIgnoreActors;
+	/// Open the hit window, tracing the blade until EndSwing
+	void BeginSwing();
+	/// Close the hit window, tracing the blade up to where it is now
+	void EndSwing();
+	FORCEINLINE bool IsSwinging() const { return bSwinging; }
+	/// Deal damage for the hits of a blade sweep traced for a swing, dropped if another swing has begun since
+	void ApplySweepHits(uint32 InSwingId, TArray<FHitResult>& HitResults);
 
-protected:
-	virtual void BeginPlay() override;
-	
-	/// Collision box overlaps
-	UFUNCTION()
-	void OnBoxBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	virtual void Tick(float DeltaTime) override;
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
 
 	/// Implement in BP, but trigger in C++ when weapon attacks
 	UFUNCTION(BlueprintImplementableEvent)
 	void CreateFields(const FVector& FieldLocation);
 
+protected:
+	virtual void BeginPlay() override;
+
 private:
 	/// How much damage this weapon deals
 	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
 	float Damage = 40;
+
+	/// How often the weapon may hit the same actor
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
+	EWeaponHitPolicy HitPolicy = EWeaponHitPolicy::OncePerSwing;
+	/// Milliseconds before the same actor can be hit again within a swing, with the Interval hit policy
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties", meta = (EditCondition = "HitPolicy == EWeaponHitPolicy::Interval", ClampMin = 0))
+	float RehitIntervalMs = 250;
 	
 	/// Equip sound for the weapon
 	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
@@ -56,10 +75,52 @@ private:
 	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
 	TObjectPtr<UBoxComponent> CollisionBox;
 
+	/// Put the mesh back on the weapon's root, where it was spawned, after being equipped
+	void ResetMeshAttachment();
+
 	/// Start for collision box tracing
 	UPROPERTY(VisibleAnywhere)
 	TObjectPtr<USceneComponent> BoxTraceStart;
 	/// End for collision box tracing
 	UPROPERTY(VisibleAnywhere)
 	TObjectPtr<USceneComponent> BoxTraceEnd;
+
+	/**
+	 * Swing tracing
+	 */
+
+	/// Where the blade is at one point of a swing
+	struct FBladeSample
+	{
+		FVector Start;
+		FVector End;
+	};
+
+	/// Blade where it is now
+	FBladeSample SampleBlade() const;
+	/// Sweep the blade from one sample to the next and hit everything it passes through
+	void SweepBlade(const FBladeSample& From, const FBladeSample& To);
+	/// Batched traces blade sweeps are queued on, null to trace them right away
+	UPROPERTY(Transient)
+	TObjectPtr<class UWeaponTraceSubsystem> TraceSubsystem;
+	/// Actors hit this swing.  Its swing ID also drops sweep results arriving after the next swing began
+	FSwingHitRegistry HitRegistry;
+	/// Queue damage to an actor the blade passed through, unless already hit this swing
+	void ReportHit(const FHitResult& HitResult);
+	/// Actors hit since the latest swing began, for telemetry, INDEX_NONE before the first swing
+	int32 NumSwingHits = INDEX_NONE;
+	/// Add the hits of the latest swing to telemetry, once no more of its sweeps can arrive
+	void RecordSwingHits();
+	/// Tick only mid-swing, or while floating as a pickup
+	void UpdateTickEnabled();
+
+	bool bSwinging = false;
+	/// Seconds since the swing began
+	float SwingTime = 0;
+	/// Swing time of the latest sub-step swept
+	float SampledTime = 0;
+	/// Blade at the end of the previous frame, sub-steps are interpolated from here
+	FBladeSample FrameSample;
+	/// Blade at the latest sub-step swept
+	FBladeSample SweptSample;
 };
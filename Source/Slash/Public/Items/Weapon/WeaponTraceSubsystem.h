@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WeaponTraceSubsystem.generated.h"
+
+class AWeapon;
+
+/**
+ * Traces the blade sweeps of every swinging weapon in one batch per frame, instead of each weapon tracing
+ * on the game thread as it ticks.
+ *
+ * Weapons queue their sweeps while ticking, in TG_PostUpdateWork.  Once every actor has ticked, the frame's
+ * sweeps are issued together through the world's async trace API, which runs them on worker threads
+ * alongside the end of the frame.  Results are handed back to their weapons at the start of the next world
+ * tick, in the order the sweeps were queued, so hits found in one frame resolve in the next.  Results not
+ * ready by then are waited for.
+ *
+ * With `Slash.Weapon.AsyncTraces` off, queued sweeps are traced and applied on the game thread once every
+ * actor has ticked instead, before UDamageQueueSubsystem resolves the frame's hits, for tests that need hits
+ * in the frame they happen.  Traces per frame and time spent waiting for results are shown in
+ * `stat SlashWeapon`.
+ */
+UCLASS()
+class SLASH_API UWeaponTraceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/// Queue a box sweep of a weapon's blade, see AWeapon::ApplySweepHits
+	void QueueSweep(AWeapon* Weapon, uint32 SwingId, const FVector& Start, const FVector& End, const FQuat& Rotation,
+		const FVector& HalfExtent, const FCollisionQueryParams& QueryParams);
+
+	/// Sweeps traced in the latest batch
+	FORCEINLINE int32 GetNumTraces() const { return NumTraces; }
+	/// Time the latest batch waited for async results, in milliseconds
+	FORCEINLINE double GetWaitMs() const { return WaitMs; }
+
+	/// Issue the sweeps queued this frame, or trace and apply them with async traces off.  Done once every
+	/// actor has ticked, and called by UDamageQueueSubsystem so the frame's hits are in before it resolves
+	void FlushQueuedSweeps();
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FQueuedSweep
+	{
+		TWeakObjectPtr<AWeapon> Weapon;
+		uint32 SwingId;
+		FVector Start;
+		FVector End;
+		FQuat Rotation;
+		FVector HalfExtent;
+		FCollisionQueryParams QueryParams;
+		/// Async trace, once issued
+		FTraceHandle Handle;
+	};
+
+	/// Apply the sweeps issued last frame
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	/// Issue the sweeps queued this frame
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	/// Hand the results of the sweeps issued last frame to their weapons
+	void ApplyIssuedSweeps();
+	/// Issue queued sweeps as async traces
+	void IssueQueuedSweeps();
+	/// Trace and apply queued sweeps right away
+	void TraceQueuedSweeps();
+
+	/// Sweeps queued this frame
+	TArray<FQueuedSweep> Queued;
+	/// Sweeps issued last frame, waiting for results
+	TArray<FQueuedSweep> Issued;
+
+	int32 NumTraces = 0;
+	double WaitMs = 0;
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostActorTickHandle;
+};
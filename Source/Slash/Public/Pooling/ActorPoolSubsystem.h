@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ActorPoolSubsystem.generated.h"
+
+/**
+ * Reuses actors of classes implementing IPoolableInterface instead of destroying and spawning them again.
+ *
+ * Released actors are hidden, stop colliding and ticking, and wait in a free list per class until acquired
+ * again.  Classes not implementing the interface, or released while the pool for their class is full
+ * (`Slash.Pool.MaxPerClass`), are destroyed as before.  Pools can be filled up front with Prewarm so the
+ * first acquires don't spawn either.  Hits and misses are shown in `stat SlashPool` and per class with
+ * `Slash.Pool.Dump`.
+ *
+ * Use the static AcquireActor and ReleaseActor, which fall back to spawning and destroying in worlds
+ * without a pool.
+ */
+UCLASS()
+class SLASH_API UActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/// Take a pooled actor of a class or spawn a new one, placed at Transform
+	AActor* Acquire(UClass* Class, const FTransform& Transform, AActor* Owner = nullptr, APawn* Instigator = nullptr);
+	/// Return an actor to the pool for its class, destroying it if it can't be pooled
+	void Release(AActor* Actor);
+	/// Spawn actors of a class until at least Count wait in its pool
+	void Prewarm(UClass* Class, int32 Count);
+	/// Number of actors of a class waiting in its pool
+	int32 GetNumPooled(UClass* Class) const;
+
+	/// Acquire from the world's pool, or spawn if there is none
+	template <typename ActorType>
+	static ActorType* AcquireActor(UWorld* World, TSubclassOf<ActorType> Class, const FTransform& Transform, AActor* Owner = nullptr, APawn* Instigator = nullptr)
+	{
+		return Cast<ActorType>(AcquireActor(World, *Class, Transform, Owner, Instigator));
+	}
+	static AActor* AcquireActor(UWorld* World, UClass* Class, const FTransform& Transform, AActor* Owner = nullptr, APawn* Instigator = nullptr);
+	/// Release to the actor's world pool, or destroy if there is none
+	static void ReleaseActor(AActor* Actor);
+	/// Whether an actor is waiting in a pool rather than in play
+	static bool IsPooled(const AActor* Actor);
+
+	/// Log pool sizes and hit rates per class
+	void DumpStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FClassPool
+	{
+		/// Released actors waiting to be acquired
+		TArray<TWeakObjectPtr<AActor>> Free;
+		int32 NumHits = 0;
+		int32 NumMisses = 0;
+		int32 NumReleased = 0;
+		/// Released while the pool was full
+		int32 NumOverflowed = 0;
+	};
+
+	/// Spawn a new actor for a pool, already in play
+	AActor* SpawnForPool(UClass* Class, const FTransform& Transform, AActor* Owner, APawn* Instigator) const;
+	/// Hide an actor and put it in its class pool
+	void Deactivate(AActor* Actor, FClassPool& Pool);
+
+	TMap<TObjectKey<UClass>, FClassPool> Pools;
+	/// Actors currently waiting in a pool
+	TSet<TObjectKey<AActor>> PooledActors;
+};
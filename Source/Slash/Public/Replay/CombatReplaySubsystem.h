@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+#include "Serialization/MemoryWriter.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatReplaySubsystem.generated.h"
+
+class ABaseCharacter;
+class AEnemy;
+class FRunnableThread;
+class IFileHandle;
+class UAnimMontage;
+enum class EEnemyState : uint8;
+
+/// Writes frames of a combat replay to a file on its own thread, holding at most a fixed number of bytes
+class FCombatReplayWriter : public FRunnable
+{
+public:
+	/// Open a file and start the thread, check IsOpen for success
+	FCombatReplayWriter(const FString& Filename, int64 InMaxPendingBytes);
+	virtual ~FCombatReplayWriter() override;
+
+	FORCEINLINE bool IsOpen() const { return File != nullptr; }
+	/// Hand a frame to the thread, returns false if dropped because too many bytes are waiting to be written
+	bool Submit(TArray<uint8>&& Frame);
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	void WritePending();
+
+	TUniquePtr<IFileHandle> File;
+	TQueue<TArray<uint8>, EQueueMode::Spsc> Pending;
+	std::atomic<int64> PendingBytes = 0;
+	int64 MaxPendingBytes;
+	std::atomic<bool> bStopping = false;
+	FEvent* WorkEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+};
+
+/**
+ * Records fights to a compact binary file and plays them back, to see what happened when one went wrong.
+ *
+ * While recording, every frame appends records to a buffer: transforms of characters that moved, enemy
+ * state changes, montages played, weapon hits and health and stamina changes.  At the end of the frame the
+ * buffer is handed to a writer thread, which streams it to disk.  At most `Slash.Replay.MaxPendingKB` wait
+ * to be written, frames beyond that are dropped and the next frame is a keyframe.  Every
+ * `Slash.Replay.KeyframeInterval` seconds a keyframe records the full state of every character, so playback
+ * can seek by restoring the keyframe before the target time and applying the frames after it.
+ *
+ * Playback reconstructs each character's state from the file and draws it with debug shapes: a capsule
+ * facing its direction, labelled with its name, state, health and montage, and a point for every hit.
+ * Controlled with the `Slash.Replay.*` commands.  Recording time is shown in `stat SlashReplay` and measured
+ * by the combat benchmark with -Replay.
+ *
+ * File layout: a header, then one block per frame of
+ *   uint32 size of the records | float seconds since recording began | uint8 keyframe | records
+ * and each record is a uint8 record type followed by its fields, see CombatReplay::ERecord.
+ */
+UCLASS()
+class SLASH_API UCombatReplaySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/// Track a character for recording, from BeginPlay
+	void RegisterCharacter(ABaseCharacter* Character);
+	void UnregisterCharacter(ABaseCharacter* Character);
+
+	/// Start recording to a file, stopping any recording or playback first
+	bool StartRecording(const FString& Filename);
+	void StopRecording();
+	FORCEINLINE bool IsRecording() const { return Writer.IsValid(); }
+
+	void RecordEnemyState(const AEnemy* Enemy, EEnemyState State);
+	void RecordMontage(const ABaseCharacter* Character, const UAnimMontage* Montage, FName SectionName);
+	void RecordHit(const AActor* Hitter, const AActor* Target, float Damage, const FVector& ImpactPoint);
+
+	/// Load a recording and start playing it from the beginning
+	bool StartPlayback(const FString& Filename);
+	void StopPlayback();
+	/// Jump to a number of seconds into the recording being played
+	void Seek(float Time);
+	void SetPlaybackPaused(bool bPaused);
+	FORCEINLINE bool IsPlaybackPaused() const { return bPlaybackPaused; }
+	FORCEINLINE bool IsPlaying() const { return PlaybackFrames.Num() > 0; }
+	FORCEINLINE float GetPlaybackTime() const { return PlaybackTime; }
+	/// Length in seconds of the recording being played
+	float GetPlaybackLength() const;
+	/// Characters of the recording being played present at the playback time
+	int32 GetNumPresentCharacters() const;
+
+	/// Log recording or playback progress
+	void DumpStats() const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/// State of a character as last recorded
+	struct FRecordedCharacter
+	{
+		TWeakObjectPtr<ABaseCharacter> Character;
+		TObjectKey<ABaseCharacter> Key;
+		uint16 Id;
+		FIntVector Location;
+		uint16 Yaw;
+		float Health;
+		float Stamina;
+		uint8 EnemyState;
+	};
+
+	/// State of a character reconstructed from a recording
+	struct FReplayCharacter
+	{
+		FString Name;
+		bool bEnemy = false;
+		bool bPresent = false;
+		FVector Location = FVector::ZeroVector;
+		float Yaw = 0;
+		float Health = 0;
+		float Stamina = 0;
+		uint8 EnemyState = 0;
+		FName Montage;
+		FName Section;
+	};
+
+	/// Frame of a recording being played
+	struct FReplayFrame
+	{
+		float Time;
+		bool bKeyframe;
+		/// Records of the frame in the loaded file
+		int32 Offset;
+		int32 Size;
+	};
+
+	/// Hit shown while playing
+	struct FReplayHit
+	{
+		FVector ImpactPoint;
+		float Time;
+	};
+
+	/// Poll registered characters for changes and end the frame's block
+	void RecordFrame();
+	/// Write full state of a character to the frame
+	void RecordCharacterState(FRecordedCharacter& Recorded);
+	/// Id of a character, declaring it in the frame the first time
+	uint16 GetCharacterId(const ABaseCharacter* Character);
+	/// Id of a name, declaring it in the frame the first time
+	uint16 GetNameId(FName Name);
+
+	/// Apply the records of a frame to the reconstructed characters, or only declare its characters and names
+	void ApplyFrame(const FReplayFrame& Frame, bool bDeclarationsOnly);
+	void DrawPlayback() const;
+
+	/**
+	 * Recording
+	 */
+
+	TArray<TWeakObjectPtr<ABaseCharacter>> Characters;
+	TUniquePtr<FCombatReplayWriter> Writer;
+	/// Records of the frame being recorded, after its header
+	TArray<uint8> FrameBuffer;
+	FMemoryWriter FrameWriter{ FrameBuffer };
+	TMap<TObjectKey<ABaseCharacter>, int32> RecordedIndices;
+	TArray<FRecordedCharacter> Recorded;
+	TMap<FName, uint16> NameIds;
+	/// Ids carry on after a dropped frame, so ids declared before it keep their meaning in playback
+	uint16 NextCharacterId = 0;
+	uint16 NextNameId = 0;
+	double RecordingStartTime = 0;
+	double LastKeyframeTime = 0;
+	bool bForceKeyframe = false;
+	int32 NumFramesRecorded = 0;
+	int32 NumFramesDropped = 0;
+	int64 NumBytesRecorded = 0;
+
+	/**
+	 * Playback
+	 */
+
+	TArray<uint8> PlaybackData;
+	TArray<FReplayFrame> PlaybackFrames;
+	/// Indices into PlaybackFrames of keyframes
+	TArray<int32> Keyframes;
+	TArray<FReplayCharacter> PlaybackCharacters;
+	TArray<FName> PlaybackNames;
+	TArray<FReplayHit> PlaybackHits;
+	/// Next frame to apply
+	int32 NextPlaybackFrame = 0;
+	float PlaybackTime = 0;
+	bool bPlaybackPaused = false;
+};
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Scheduling/TimingWheel.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplaySchedulerSubsystem.generated.h"
+
+/**
+ * World level timing wheel for high volume gameplay timers, such as enemy attack and patrol delays.
+ *
+ * Use instead of FTimerManager for one shot timers armed and cleared constantly by many actors.  Timers
+ * follow world time dilation and pause, resolution is set with `Slash.Scheduler.TickRate`.
+ */
+UCLASS()
+class SLASH_API UGameplaySchedulerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/// Call a member function of Object once after Delay seconds, cancelling the timer InOutHandle referred to
+	template <typename UserClass, void (UserClass::*Function)()>
+	FORCEINLINE void SetTimer(FScheduledTimerHandle& InOutHandle, UserClass* Object, float Delay)
+	{
+		Wheel.SetTimer<UserClass, Function>(InOutHandle, Object, Delay);
+	}
+	FORCEINLINE void ClearTimer(FScheduledTimerHandle& InOutHandle) { Wheel.ClearTimer(InOutHandle); }
+	FORCEINLINE bool IsTimerActive(const FScheduledTimerHandle& Handle) const { return Wheel.IsTimerActive(Handle); }
+	FORCEINLINE float GetTimerRemaining(const FScheduledTimerHandle& Handle) const { return Wheel.GetTimerRemaining(Handle); }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	FTimingWheel Wheel;
+};
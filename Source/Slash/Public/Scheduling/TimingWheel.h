@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+
+/// Handle to a timer on an FTimingWheel.  Handles of fired or cleared timers are detected as stale, so they are safe to keep and re-arm
+struct FScheduledTimerHandle
+{
+	FORCEINLINE bool IsValid() const { return Index != INDEX_NONE; }
+	FORCEINLINE void Invalidate() { Index = INDEX_NONE; }
+
+private:
+	friend class FTimingWheel;
+
+	int32 Index = INDEX_NONE;
+	uint32 Generation = 0;
+};
+
+/// Called when a timer fires with the object the timer was armed for
+using FScheduledTimerFunction = void (*)(UObject* Object);
+
+/**
+ * Hierarchical timing wheel of one shot timers.
+ *
+ * Time is quantized into ticks of a fixed length.  Timers sit in intrusive linked lists, one per wheel slot,
+ * with 4 levels of 64 slots each covering 64 times the span of the level below, so arming and cancelling
+ * are O(1) and timers only move down a level when their slot comes up.  Timer nodes are pooled and reused,
+ * and timers call a plain function with a weak object instead of a bound delegate, so re-arming a timer
+ * never allocates.  Expired timers are collected while the wheel advances and fired in one pass after.
+ */
+class SLASH_API FTimingWheel
+{
+public:
+	explicit FTimingWheel(float InTickSeconds = 1.f / 120);
+
+	/// Arm a timer to fire once after Delay seconds, cancelling the timer InOutHandle referred to
+	void SetTimer(FScheduledTimerHandle& InOutHandle, UObject* Object, FScheduledTimerFunction Function, float Delay);
+
+	/// Arm a timer to call a member function of Object once after Delay seconds
+	template <typename UserClass, void (UserClass::*Function)()>
+	FORCEINLINE void SetTimer(FScheduledTimerHandle& InOutHandle, UserClass* Object, float Delay)
+	{
+		SetTimer(InOutHandle, Object, &CallMemberFunction<UserClass, Function>, Delay);
+	}
+
+	/// Cancel a timer and invalidate its handle, does nothing for stale handles
+	void ClearTimer(FScheduledTimerHandle& InOutHandle);
+	/// Whether a timer is still waiting to fire
+	bool IsTimerActive(const FScheduledTimerHandle& Handle) const;
+	/// Seconds until a timer fires, or -1 if it is not active
+	float GetTimerRemaining(const FScheduledTimerHandle& Handle) const;
+
+	/// Move time forward and fire every timer that expired
+	void Advance(float DeltaTime);
+	/// Cancel all timers
+	void Reset();
+
+	FORCEINLINE int32 Num() const { return NumActive; }
+	FORCEINLINE int32 GetNumFiredLastAdvance() const { return NumFired; }
+	FORCEINLINE float GetTickSeconds() const { return TickSeconds; }
+
+	static constexpr int32 NumLevels = 4;
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 SlotsPerLevel = 1 << SlotBits;
+	/// Longest delay in ticks, longer delays are clamped
+	static constexpr uint64 MaxDelayTicks = (uint64(1) << (SlotBits * NumLevels)) - 1;
+
+private:
+	template <typename UserClass, void (UserClass::*Function)()>
+	static void CallMemberFunction(UObject* Object)
+	{
+		(static_cast<UserClass*>(Object)->*Function)();
+	}
+
+	enum class ENodeState : uint8
+	{
+		Free,
+		/// Waiting in a wheel slot
+		Scheduled,
+		/// Collected by Advance, waiting to fire
+		Expired
+	};
+
+	struct FTimerNode
+	{
+		TWeakObjectPtr<UObject> Object;
+		FScheduledTimerFunction Function = nullptr;
+		uint64 ExpireTick = 0;
+		/// Neighbours in the slot list
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+		/// Level * SlotsPerLevel + slot
+		int32 Slot = INDEX_NONE;
+		/// Bumped on free so stale handles can be told apart from reused nodes
+		uint32 Generation = 0;
+		ENodeState State = ENodeState::Free;
+	};
+
+	/// Node for a handle, null if the handle is invalid or stale
+	const FTimerNode* FindNode(const FScheduledTimerHandle& Handle) const;
+	/// Put a scheduled node in the slot for its expire tick
+	void Link(int32 Index);
+	/// Take a scheduled node out of its slot
+	void Unlink(int32 Index);
+	/// Return a node to the pool, invalidating handles to it
+	void FreeNode(int32 Index);
+	/// Advance the wheel by one tick, cascading higher levels and collecting expired timers
+	void Step();
+	/// Relink every node in a slot, moving them to lower levels
+	void Cascade(int32 Level);
+	/// Fire collected timers
+	void FireExpired();
+
+	float TickSeconds;
+	/// Time passed since the current tick
+	float Accumulator = 0;
+	uint64 CurrentTick = 0;
+
+	TArray<FTimerNode> Nodes;
+	TArray<int32> FreeNodes;
+	/// Head node of each slot list, INDEX_NONE if empty
+	int32 SlotHeads[NumLevels * SlotsPerLevel];
+
+	/// Collected timers with the generation they were collected at, reused between advances
+	TArray<TPair<int32, uint32>> Expired;
+
+	int32 NumActive = 0;
+	int32 NumFired = 0;
+};
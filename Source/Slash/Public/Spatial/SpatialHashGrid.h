@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// Categories entries can be filtered by in spatial queries
+enum class ESpatialHashCategory : uint32
+{
+	None = 0,
+	Character = 1 << 0,
+	Pickup = 1 << 1,
+	All = MAX_uint32
+};
+ENUM_CLASS_FLAGS(ESpatialHashCategory);
+
+/**
+ * Uniform grid of points bucketed by XY cell, for range queries without iterating every entry.
+ *
+ * Entries are referenced by integer handles which are reused after removal.  Moving an entry only touches
+ * the buckets if it crosses into another cell.  All distance tests use squared distances.
+ */
+class SLASH_API FSpatialHashGrid
+{
+public:
+	explicit FSpatialHashGrid(double InCellSize = 1000);
+
+	/// Add an entry, returning its handle
+	int32 Add(const FVector& Location, ESpatialHashCategory Category);
+	/// Move an entry
+	void Update(int32 Handle, const FVector& Location);
+	/// Remove an entry, its handle may be reused by later adds
+	void Remove(int32 Handle);
+	/// Remove all entries
+	void Reset();
+
+	FORCEINLINE bool IsValidHandle(int32 Handle) const { return Categories.IsValidIndex(Handle) && Categories[Handle] != ESpatialHashCategory::None; }
+	FORCEINLINE const FVector& GetLocation(int32 Handle) const { return Locations[Handle]; }
+	FORCEINLINE int32 Num() const { return Locations.Num() - FreeHandles.Num(); }
+	FORCEINLINE double GetCellSize() const { return CellSize; }
+
+	/**
+	 * Queries append matching handles to the output array
+	 */
+
+	/// Entries within Radius of Center
+	void QueryRadius(const FVector& Center, double Radius, TArray<int32>& OutHandles, ESpatialHashCategory CategoryMask = ESpatialHashCategory::All) const;
+	/// Entries within Radius of Origin and within HalfAngleDegrees of Direction, which must be normalized
+	void QueryCone(const FVector& Origin, const FVector& Direction, double Radius, double HalfAngleDegrees, TArray<int32>& OutHandles, ESpatialHashCategory CategoryMask = ESpatialHashCategory::All) const;
+	/// Up to Count entries closest to Center within MaxRadius, closest first
+	void QueryNearest(const FVector& Center, int32 Count, double MaxRadius, TArray<int32>& OutHandles, ESpatialHashCategory CategoryMask = ESpatialHashCategory::All) const;
+
+private:
+	FORCEINLINE FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt32(Location.X * InvCellSize), FMath::FloorToInt32(Location.Y * InvCellSize));
+	}
+
+	/// Add handle to the bucket for a cell
+	void LinkToCell(int32 Handle, const FIntPoint& Cell);
+	/// Remove handle from the bucket of its current cell
+	void UnlinkFromCell(int32 Handle);
+
+	/// Call Visitor for every handle in the cells overlapping the XY bounds of a sphere
+	template <typename VisitorType>
+	void ForEachInBounds(const FVector& Center, double Radius, ESpatialHashCategory CategoryMask, VisitorType&& Visitor) const;
+
+	double CellSize;
+	double InvCellSize;
+
+	/**
+	 * Per entry data, indexed by handle
+	 */
+
+	TArray<FVector> Locations;
+	TArray<FIntPoint> EntryCells;
+	/// Index of the entry within its cell bucket
+	TArray<int32> BucketIndices;
+	/// None for free handles
+	TArray<ESpatialHashCategory> Categories;
+	TArray<int32> FreeHandles;
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+};
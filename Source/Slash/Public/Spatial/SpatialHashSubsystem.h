@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "Spatial/SpatialHashGrid.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SpatialHashSubsystem.generated.h"
+
+/**
+ * World level spatial hash of characters and pickups.
+ *
+ * Registered actors are kept up to date from their root component's transform updates, so only actors
+ * that actually move do any work.  Use this instead of iterating actors or computing square root
+ * distances when looking for actors near a point, e.g. combat targets or lock-on candidates.
+ */
+UCLASS()
+class SLASH_API USpatialHashSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/// Start tracking an actor
+	void RegisterActor(AActor* Actor, ESpatialHashCategory Category);
+	/// Stop tracking an actor
+	void UnregisterActor(AActor* Actor);
+
+	/// Actors within Radius of Center
+	void FindActorsInRadius(const FVector& Center, double Radius, TArray<AActor*>& OutActors, ESpatialHashCategory CategoryMask = ESpatialHashCategory::All) const;
+	/// Actors within Radius of Origin and HalfAngleDegrees of Direction
+	void FindActorsInCone(const FVector& Origin, const FVector& Direction, double Radius, double HalfAngleDegrees, TArray<AActor*>& OutActors, ESpatialHashCategory CategoryMask = ESpatialHashCategory::All) const;
+	/// Up to Count actors closest to Center within MaxRadius, closest first
+	void FindNearestActors(const FVector& Center, int32 Count, double MaxRadius, TArray<AActor*>& OutActors, ESpatialHashCategory CategoryMask = ESpatialHashCategory::All) const;
+
+	FORCEINLINE const FSpatialHashGrid& GetGrid() const { return Grid; }
+	/// Actor for a grid handle, null if the actor is gone
+	FORCEINLINE AActor* GetActor(int32 Handle) const { return Actors.IsValidIndex(Handle) ? Actors[Handle].Get() : nullptr; }
+	/// Grid handle of an actor, INDEX_NONE if not registered
+	FORCEINLINE int32 GetHandle(const AActor* Actor) const { const int32* Handle = Handles.Find(Actor); return Handle ? *Handle : INDEX_NONE; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void OnRootComponentMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	/// Resolve query handles from the scratch array into actors
+	void ResolveActors(TArray<AActor*>& OutActors) const;
+
+	FSpatialHashGrid Grid;
+
+	/// Actors indexed by grid handle
+	TArray<TWeakObjectPtr<AActor>> Actors;
+	TMap<TObjectKey<AActor>, int32> Handles;
+
+	/// Reused between queries to avoid allocating
+	mutable TArray<int32> QueryHandles;
+};
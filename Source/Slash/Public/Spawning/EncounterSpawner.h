@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Spawning/SpawnDirectorSubsystem.h"
+#include "EncounterSpawner.generated.h"
+
+/**
+ * Encounters placed in the level, spawned at runtime by the spawn director instead of placing every enemy.
+ */
+UCLASS()
+class SLASH_API AEncounterSpawner : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AEncounterSpawner();
+
+	/// Queue every encounter on the spawn director
+	UFUNCTION(BlueprintCallable, Category = "Encounter")
+	void StartEncounters();
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	/// Encounters to spawn, with spawn areas relative to this actor
+	UPROPERTY(EditAnywhere, Category = "Encounter")
+	TArray<FEnemyEncounter> Encounters;
+
+	/// Start the encounters when play begins, otherwise wait for StartEncounters
+	UPROPERTY(EditAnywhere, Category = "Encounter")
+	bool bStartOnBeginPlay = true;
+
+	/// When waiting for StartEncounters, fill the actor pool with the encounters' enemies in the meantime
+	UPROPERTY(EditAnywhere, Category = "Encounter")
+	bool bPrewarmOnBeginPlay = true;
+};
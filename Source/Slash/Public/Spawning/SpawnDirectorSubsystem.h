@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SpawnDirectorSubsystem.generated.h"
+
+class AEnemy;
+class APatrolRoute;
+
+/// A group of enemies to spawn together
+USTRUCT(BlueprintType)
+struct FEnemyEncounter
+{
+	GENERATED_BODY()
+
+	/// Enemy class to spawn, loaded in the background if it isn't loaded yet
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Encounter")
+	TSoftClassPtr<AEnemy> EnemyClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Encounter", meta = (ClampMin = 1))
+	int32 Count = 1;
+
+	/// Route spawned enemies patrol, optional
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Encounter")
+	TObjectPtr<APatrolRoute> PatrolRoute;
+
+	/// Centre of the box enemies are spawned in.  World space when queued, relative to an AEncounterSpawner
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Encounter", meta = (MakeEditWidget = true))
+	FVector SpawnCenter = FVector::ZeroVector;
+
+	/// Half size of the box enemies are spawned in, spawn points are projected onto the navmesh
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Encounter")
+	FVector SpawnExtent = FVector(500, 500, 100);
+
+	/// Add enemies as ambient entities that only become actors near the player, see UAmbientEnemySubsystem
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Encounter")
+	bool bAmbient = false;
+};
+
+/**
+ * Spawns enemy encounters at runtime spread over frames, instead of every enemy in the frame it is needed.
+ *
+ * Enemy classes are loaded asynchronously when an encounter is queued, and queued enemies are spawned
+ * through the actor pool each frame until the frame's budget `Slash.Spawn.BudgetMs` is used up, with at
+ * least one spawn per frame.  Pools can be filled ahead of an encounter with QueuePrewarm, under the same
+ * budget, so the encounter itself only takes enemies out of the pool.
+ *
+ * Ambient encounters are added to UAmbientEnemySubsystem as entities instead, cheap enough for thousands.
+ *
+ * Latency from queueing to spawning is logged as percentiles with `Slash.Spawn.Stats`, see also
+ * `stat SlashSpawn`.  `Slash.Spawn.Encounter` queues an encounter around the player for testing.
+ */
+UCLASS()
+class SLASH_API USpawnDirectorSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/// Queue every enemy of an encounter, returns how many were queued
+	int32 QueueEncounter(const FEnemyEncounter& Encounter);
+	/// Queue spawning enemies of a class into the actor pool, ready for a later encounter
+	void QueuePrewarm(const TSoftClassPtr<AEnemy>& EnemyClass, int32 Count);
+	/// Enemies and prewarms still waiting to be spawned
+	FORCEINLINE int32 GetNumPending() const { return Pending.Num(); }
+
+	/// Log spawn counts and latency percentiles
+	void DumpStats() const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FPendingSpawn
+	{
+		TSoftClassPtr<AEnemy> EnemyClass;
+		TWeakObjectPtr<APatrolRoute> PatrolRoute;
+		FVector SpawnCenter;
+		FVector SpawnExtent;
+		/// When the spawn was queued, in platform seconds
+		double QueueTime;
+		/// Spawn into the actor pool rather than into play
+		bool bPrewarm;
+		/// Add as an ambient entity rather than an actor
+		bool bAmbient;
+	};
+
+	/// Start loading an enemy class unless it is loaded or loading
+	void RequestClassLoad(const TSoftClassPtr<AEnemy>& EnemyClass);
+	/// Whether a class failed to load and spawns of it should be dropped
+	bool HasClassLoadFailed(const TSoftClassPtr<AEnemy>& EnemyClass) const;
+	/// Spawn a queued enemy of a loaded class
+	void SpawnPending(const FPendingSpawn& Spawn, UClass* Class);
+	/// Random point in a spawn box, on the navmesh if there is one there
+	FVector PickSpawnLocation(const FPendingSpawn& Spawn, UClass* Class) const;
+	void RecordLatency(float LatencyMs);
+
+	/// Queued spawns, in the order they were queued
+	TArray<FPendingSpawn> Pending;
+
+	FStreamableManager StreamableManager;
+	/// Class loads, kept so classes stay loaded while the world lives
+	TMap<FSoftObjectPath, TSharedPtr<FStreamableHandle>> ClassLoads;
+
+	/// Latest spawn latencies in milliseconds, a ring buffer
+	TArray<float> LatenciesMs;
+	int32 LatencyCursor = 0;
+
+	int32 NumSpawned = 0;
+	int32 NumPrewarmed = 0;
+	int32 NumFailed = 0;
+	/// Longest time spent spawning in one frame, in milliseconds
+	double MaxFrameMs = 0;
+
+	FRandomStream Random = FRandomStream(FPlatformTime::Cycles());
+};